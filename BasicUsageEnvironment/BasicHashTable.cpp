@@ -18,6 +18,7 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 // Implementation
 
 #include "BasicHashTable.hh"
+#include "OpenAddressingHashTable.hh"
 #include "strDup.hh"
 
 #if defined(__WIN32__) || defined(_WIN32)
@@ -95,6 +96,10 @@ unsigned BasicHashTable::numEntries() const {
   return fNumEntries;
 }
 
+HashTable::Iterator* BasicHashTable::createIterator() const {
+  return new Iterator(*this);
+}
+
 BasicHashTable::Iterator::Iterator(BasicHashTable const& table)
   : fTable(table), fNextIndex(0), fNextEntry(NULL) {
 }
@@ -116,12 +121,22 @@ void* BasicHashTable::Iterator::next(char const*& key) {
 ////////// Implementation of HashTable creation functions //////////
 
 HashTable* HashTable::create(int keyType) {
+#ifdef USE_OPEN_ADDRESSING_HASH_TABLES
+  return create(keyType, True);
+#else
+  return create(keyType, False);
+#endif
+}
+
+HashTable* HashTable::create(int keyType, Boolean useOpenAddressing) {
+  if (useOpenAddressing) return new OpenAddressingHashTable(keyType);
+
   return new BasicHashTable(keyType);
 }
 
 HashTable::Iterator* HashTable::Iterator::create(HashTable const& hashTable) {
-  // "hashTable" is assumed to be a BasicHashTable
-  return new BasicHashTable::Iterator((BasicHashTable const&)hashTable);
+  // "hashTable" is one of our implementations, so knows which kind of iterator it needs:
+  return hashTable.createIterator();
 }
 
 ////////// Implementation of internal member functions //////////
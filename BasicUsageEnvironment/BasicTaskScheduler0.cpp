@@ -155,6 +155,37 @@ void BasicTaskScheduler0::triggerEvent(EventTriggerId eventTriggerId, void* clie
 }
 
 
+void BasicTaskScheduler0::handleNewlyTriggeredEvent() {
+  if (!fEventTriggersAreBeingUsed) return;
+
+  // Look for an event trigger that needs handling (making sure that we make forward progress through all possible triggers):
+  unsigned i = fLastUsedTriggerNum;
+  EventTriggerId mask = fLastUsedTriggerMask;
+
+  do {
+    i = (i+1)%MAX_NUM_EVENT_TRIGGERS;
+    mask >>= 1;
+    if (mask == 0) mask = EVENT_TRIGGER_ID_HIGH_BIT;
+
+#ifndef NO_STD_LIB
+    if (fTriggersAwaitingHandling[i].test()) {
+      fTriggersAwaitingHandling[i].clear();
+#else
+    if (fTriggersAwaitingHandling[i]) {
+      fTriggersAwaitingHandling[i] = False;
+#endif
+      if (fTriggeredEventHandlers[i] != NULL) {
+	(*fTriggeredEventHandlers[i])(fTriggeredEventClientDatas[i]);
+      }
+
+      fLastUsedTriggerMask = mask;
+      fLastUsedTriggerNum = i;
+      break;
+    }
+  } while (i != fLastUsedTriggerNum);
+}
+
+
 ////////// HandlerSet (etc.) implementation //////////
 
 HandlerDescriptor::HandlerDescriptor(HandlerDescriptor* nextHandler)
@@ -20,6 +20,7 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 #include "DelayQueue.hh"
 #include "GroupsockHelper.hh"
+#include "HashTable.hh"
 
 static const int MILLION = 1000000;
 
@@ -92,9 +93,10 @@ const DelayInterval ETERNITY(INT_MAX, MILLION-1);
 
 ///// DelayQueueEntry /////
 
+#define NOT_IN_QUEUE (~0U)
+
 DelayQueueEntry::DelayQueueEntry(DelayInterval delay, intptr_t token)
-  : fDeltaTimeRemaining(delay), fToken(token) {
-  fNext = fPrev = this;
+  : fDeltaTimeRemaining(delay), fDueTime(0), fSequenceNum(0), fHeapIndex(NOT_IN_QUEUE), fToken(token) {
 }
 
 DelayQueueEntry::~DelayQueueEntry() {
@@ -107,34 +109,48 @@ void DelayQueueEntry::handleTimeout() {
 
 ///// DelayQueue /////
 
+static int64_t toMicroseconds(Timeval const& tv) {
+  return (int64_t)tv.seconds()*MILLION + tv.useconds();
+}
+
 DelayQueue::DelayQueue()
-  : DelayQueueEntry(ETERNITY, 0) {
+  : fTimeNow(0), fNextSequenceNum(0),
+    fHeap(NULL), fNumEntries(0), fHeapSize(0),
+    fTimeToNextAlarm(ETERNITY) {
   fLastSyncTime = TimeNow();
+  fEntriesByToken = HashTable::create(ONE_WORD_HASH_KEYS);
 }
 
 DelayQueue::~DelayQueue() {
-  while (fNext != this) {
-    DelayQueueEntry* entryToRemove = fNext;
+  while (fNumEntries > 0) {
+    DelayQueueEntry* entryToRemove = fHeap[fNumEntries-1];
     removeEntry(entryToRemove);
     delete entryToRemove;
   }
+  delete[] fHeap;
+  delete fEntriesByToken;
 }
 
 void DelayQueue::addEntry(DelayQueueEntry* newEntry) {
+  if (newEntry == NULL || newEntry->fHeapIndex != NOT_IN_QUEUE) return;
   synchronize();
 
-  DelayQueueEntry* cur = head();
-  while (newEntry->fDeltaTimeRemaining >= cur->fDeltaTimeRemaining) {
-    newEntry->fDeltaTimeRemaining -= cur->fDeltaTimeRemaining;
-    cur = cur->fNext;
+  if (fNumEntries == fHeapSize) {
+    // Grow the heap:
+    unsigned newHeapSize = fHeapSize == 0 ? 64 : 2*fHeapSize;
+    DelayQueueEntry** newHeap = new DelayQueueEntry*[newHeapSize];
+    for (unsigned i = 0; i < fNumEntries; ++i) newHeap[i] = fHeap[i];
+    delete[] fHeap;
+    fHeap = newHeap;
+    fHeapSize = newHeapSize;
   }
 
-  cur->fDeltaTimeRemaining -= newEntry->fDeltaTimeRemaining;
+  newEntry->fDueTime = fTimeNow + toMicroseconds(newEntry->fDeltaTimeRemaining);
+  newEntry->fSequenceNum = fNextSequenceNum++;
+  placeEntryAt(newEntry, fNumEntries++);
+  siftUp(newEntry->fHeapIndex);
 
-  // Add "newEntry" to the queue, just before "cur":
-  newEntry->fNext = cur;
-  newEntry->fPrev = cur->fPrev;
-  cur->fPrev = newEntry->fPrev->fNext = newEntry;
+  fEntriesByToken->Add((char const*)(newEntry->token()), newEntry);
 }
 
 void DelayQueue::updateEntry(DelayQueueEntry* entry, DelayInterval newDelay) {
@@ -151,13 +167,24 @@ void DelayQueue::updateEntry(intptr_t tokenToFind, DelayInterval newDelay) {
 }
 
 void DelayQueue::removeEntry(DelayQueueEntry* entry) {
-  if (entry == NULL || entry->fNext == NULL) return;
+  if (entry == NULL || entry->fHeapIndex == NOT_IN_QUEUE) return;
+
+  unsigned index = entry->fHeapIndex;
+  entry->fHeapIndex = NOT_IN_QUEUE; // in case we should try to remove it again
+  if (fEntriesByToken->Lookup((char const*)(entry->token())) == entry) {
+    fEntriesByToken->Remove((char const*)(entry->token()));
+  }
 
-  entry->fNext->fDeltaTimeRemaining += entry->fDeltaTimeRemaining;
-  entry->fPrev->fNext = entry->fNext;
-  entry->fNext->fPrev = entry->fPrev;
-  entry->fNext = entry->fPrev = NULL;
-  // in case we should try to remove it again
+  // Move the last entry in the heap into the vacated position, and then restore the heap ordering:
+  DelayQueueEntry* lastEntry = fHeap[--fNumEntries];
+  if (index < fNumEntries) {
+    placeEntryAt(lastEntry, index);
+    if (index > 0 && entryIsEarlier(lastEntry, fHeap[(index-1)/2])) {
+      siftUp(index);
+    } else {
+      siftDown(index);
+    }
+  }
 }
 
 DelayQueueEntry* DelayQueue::removeEntry(intptr_t tokenToFind) {
@@ -167,36 +194,37 @@ DelayQueueEntry* DelayQueue::removeEntry(intptr_t tokenToFind) {
 }
 
 DelayInterval const& DelayQueue::timeToNextAlarm() {
-  if (head()->fDeltaTimeRemaining == DELAY_ZERO) return DELAY_ZERO; // a common case
+  DelayQueueEntry* first = head();
+  if (first == NULL) return ETERNITY;
+  if (first->fDueTime <= fTimeNow) return DELAY_ZERO; // a common case
 
   synchronize();
-  return head()->fDeltaTimeRemaining;
+  int64_t remaining = first->fDueTime - fTimeNow;
+  if (remaining <= 0) return DELAY_ZERO;
+
+  fTimeToNextAlarm = DelayInterval((time_base_seconds)(remaining/MILLION), (time_base_seconds)(remaining%MILLION));
+  return fTimeToNextAlarm;
 }
 
 void DelayQueue::handleAlarm() {
-  if (head()->fDeltaTimeRemaining != DELAY_ZERO) synchronize();
+  DelayQueueEntry* first = head();
+  if (first == NULL) return;
+  if (first->fDueTime > fTimeNow) synchronize();
 
-  if (head()->fDeltaTimeRemaining == DELAY_ZERO) {
+  if (first->fDueTime <= fTimeNow) {
     // This event is due to be handled:
-    DelayQueueEntry* toRemove = head();
-    removeEntry(toRemove); // do this first, in case handler accesses queue
+    removeEntry(first); // do this first, in case handler accesses queue
 
-    toRemove->handleTimeout();
+    first->handleTimeout();
   }
 }
 
 DelayQueueEntry* DelayQueue::findEntryByToken(intptr_t tokenToFind) {
-  DelayQueueEntry* cur = head();
-  while (cur != this) {
-    if (cur->token() == tokenToFind) return cur;
-    cur = cur->fNext;
-  }
-
-  return NULL;
+  return (DelayQueueEntry*)(fEntriesByToken->Lookup((char const*)tokenToFind));
 }
 
 void DelayQueue::synchronize() {
-  // First, figure out how much time has elapsed since the last sync:
+  // Figure out how much time has elapsed since the last sync:
   _EventTime timeNow = TimeNow();
   if (timeNow < fLastSyncTime) {
     // The system clock has apparently gone back in time; reset our sync time and return:
@@ -206,14 +234,43 @@ void DelayQueue::synchronize() {
   DelayInterval timeSinceLastSync = timeNow - fLastSyncTime;
   fLastSyncTime = timeNow;
 
-  // Then, adjust the delay queue for any entries whose time is up:
-  DelayQueueEntry* curEntry = head();
-  while (timeSinceLastSync >= curEntry->fDeltaTimeRemaining) {
-    timeSinceLastSync -= curEntry->fDeltaTimeRemaining;
-    curEntry->fDeltaTimeRemaining = DELAY_ZERO;
-    curEntry = curEntry->fNext;
+  fTimeNow += toMicroseconds(timeSinceLastSync);
+}
+
+Boolean DelayQueue::entryIsEarlier(DelayQueueEntry const* entry1, DelayQueueEntry const* entry2) const {
+  return entry1->fDueTime < entry2->fDueTime
+    || (entry1->fDueTime == entry2->fDueTime && entry1->fSequenceNum < entry2->fSequenceNum);
+}
+
+void DelayQueue::placeEntryAt(DelayQueueEntry* entry, unsigned index) {
+  fHeap[index] = entry;
+  entry->fHeapIndex = index;
+}
+
+void DelayQueue::siftUp(unsigned index) {
+  DelayQueueEntry* entry = fHeap[index];
+  while (index > 0) {
+    unsigned parentIndex = (index-1)/2;
+    if (!entryIsEarlier(entry, fHeap[parentIndex])) break;
+
+    placeEntryAt(fHeap[parentIndex], index);
+    index = parentIndex;
+  }
+  placeEntryAt(entry, index);
+}
+
+void DelayQueue::siftDown(unsigned index) {
+  DelayQueueEntry* entry = fHeap[index];
+  while (1) {
+    unsigned childIndex = 2*index + 1;
+    if (childIndex >= fNumEntries) break;
+    if (childIndex+1 < fNumEntries && entryIsEarlier(fHeap[childIndex+1], fHeap[childIndex])) ++childIndex;
+    if (!entryIsEarlier(fHeap[childIndex], entry)) break;
+
+    placeEntryAt(fHeap[childIndex], index);
+    index = childIndex;
   }
-  curEntry->fDeltaTimeRemaining -= timeSinceLastSync;
+  placeEntryAt(entry, index);
 }
 
 
@@ -0,0 +1,279 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2026 Live Networks, Inc.  All rights reserved.
+// Basic Usage Environment: for a simple, non-scripted, console application
+// Implementation of an "epoll()"-based task scheduler (Linux only)
+
+#include "BasicUsageEnvironment.hh"
+
+#ifdef HAVE_EPOLL_TASK_SCHEDULER
+#include <sys/epoll.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+// The maximum number of ready sockets that we ask "epoll_wait()" for in each call.
+// (Any others are reported by the next call.)
+#ifndef EPOLL_MAX_EVENTS_PER_STEP
+#define EPOLL_MAX_EVENTS_PER_STEP 64
+#endif
+
+#ifndef MILLION
+#define MILLION 1000000
+#endif
+
+// The handler for each socket.  We keep these in an array indexed by socket number,
+// so that looking up the handler for a ready socket takes constant time:
+struct EpollSocketHandler {
+  int conditionSet; // 0 iff there's no handler for this socket
+  TaskScheduler::BackgroundHandlerProc* handlerProc;
+  void* clientData;
+  int alwaysReadyIndex; // our position in "fAlwaysReadySockets", or -1 if "epoll" watches this socket
+};
+
+static u_int32_t epollEventsFor(int conditionSet) {
+  u_int32_t events = 0;
+  if (conditionSet&SOCKET_READABLE) events |= EPOLLIN;
+  if (conditionSet&SOCKET_WRITABLE) events |= EPOLLOUT;
+  if (conditionSet&SOCKET_EXCEPTION) events |= EPOLLPRI; // like "select()"s 'exception' set, this means OOB data
+  return events;
+}
+
+////////// EpollTaskScheduler //////////
+
+EpollTaskScheduler* EpollTaskScheduler::createNew(unsigned maxSchedulerGranularity) {
+  int epollFd = epoll_create1(EPOLL_CLOEXEC);
+  if (epollFd < 0) return NULL;
+
+  return new EpollTaskScheduler(epollFd, maxSchedulerGranularity);
+}
+
+EpollTaskScheduler::EpollTaskScheduler(int epollFd, unsigned maxSchedulerGranularity)
+  : fMaxSchedulerGranularity(maxSchedulerGranularity),
+    fEpollFd(epollFd), fSocketHandlers(NULL), fSocketHandlersSize(0),
+    fAlwaysReadySockets(NULL), fNumAlwaysReadySockets(0), fAlwaysReadySocketsSize(0), fNextAlwaysReadyIndex(0) {
+  if (maxSchedulerGranularity > 0) schedulerTickTask(); // ensures that we handle events frequently
+}
+
+EpollTaskScheduler::~EpollTaskScheduler() {
+  close(fEpollFd);
+  delete[] fSocketHandlers;
+  delete[] fAlwaysReadySockets;
+}
+
+void EpollTaskScheduler::schedulerTickTask(void* clientData) {
+  ((EpollTaskScheduler*)clientData)->schedulerTickTask();
+}
+
+void EpollTaskScheduler::schedulerTickTask() {
+  scheduleDelayedTask(fMaxSchedulerGranularity, schedulerTickTask, this);
+}
+
+void EpollTaskScheduler::SingleStep(unsigned maxDelayTime) {
+  DelayInterval const& timeToDelay = fDelayQueue.timeToNextAlarm();
+
+  // "epoll_wait()" takes a timeout in milliseconds.  Round up, so that we don't spin (with a 0 timeout)
+  // during the last millisecond before a delayed task becomes due.
+  // Don't make the timeout any larger than 1 million seconds (11.5 days), which also keeps it within an "int":
+  const long MAX_TIMEOUT_SEC = MILLION;
+  long timeoutSec = timeToDelay.seconds();
+  long timeoutUSec = timeToDelay.useconds();
+  if (timeoutSec > MAX_TIMEOUT_SEC) {
+    timeoutSec = MAX_TIMEOUT_SEC;
+    timeoutUSec = 0;
+  }
+  // Also check our "maxDelayTime" parameter (if it's > 0):
+  if (maxDelayTime > 0 &&
+      (timeoutSec > (long)maxDelayTime/MILLION ||
+       (timeoutSec == (long)maxDelayTime/MILLION && timeoutUSec > (long)maxDelayTime%MILLION))) {
+    timeoutSec = maxDelayTime/MILLION;
+    timeoutUSec = maxDelayTime%MILLION;
+  }
+  int timeoutMs = (int)(timeoutSec*1000 + (timeoutUSec+999)/1000);
+  if (fNumAlwaysReadySockets > 0) timeoutMs = 0; // because we already have something to handle
+
+  // Note: "events" is a local variable (rather than a member), in case a handler calls "doEventLoop()" reentrantly:
+  struct epoll_event events[EPOLL_MAX_EVENTS_PER_STEP];
+  int numReady = epoll_wait(fEpollFd, events, EPOLL_MAX_EVENTS_PER_STEP, timeoutMs);
+  if (numReady < 0) {
+    if (errno != EINTR && errno != EAGAIN) {
+      // Unexpected error - treat this as fatal:
+      perror("EpollTaskScheduler::SingleStep(): epoll_wait() fails");
+      internalError();
+    }
+    numReady = 0;
+  }
+
+  // Call the handler function for each ready socket.  Because an earlier handler may have changed (or removed)
+  // the handling for a later socket, we look up each handler again just before calling it:
+  for (int i = 0; i < numReady; ++i) {
+    int sock = events[i].data.fd;
+    EpollSocketHandler* handler = lookupSocketHandler(sock);
+    if (handler == NULL || handler->conditionSet == 0 || handler->handlerProc == NULL) continue;
+
+    u_int32_t ev = events[i].events;
+    int resultConditionSet = 0;
+    if (ev&EPOLLIN) resultConditionSet |= SOCKET_READABLE;
+    if (ev&EPOLLOUT) resultConditionSet |= SOCKET_WRITABLE;
+    if (ev&EPOLLPRI) resultConditionSet |= SOCKET_EXCEPTION;
+    // A hangup or error is reported (by epoll) whether or not we asked for it.  Report it as every condition that the
+    // handler asked for - as "select()" would - so that the handler gets to notice it.  (Otherwise, because epoll is
+    // level-triggered, the event would remain pending, and we'd spin.):
+    if (ev&(EPOLLHUP|EPOLLERR)) resultConditionSet |= handler->conditionSet;
+    resultConditionSet &= handler->conditionSet;
+    if (resultConditionSet == 0) continue;
+
+    (*handler->handlerProc)(handler->clientData, resultConditionSet);
+  }
+
+  // Then call the handler for one of the descriptors (if any) that are always ready.  (Like "BasicTaskScheduler", we
+  // handle these round-robin, one per step, so that each gets its turn.):
+  if (fNumAlwaysReadySockets > 0) {
+    if (fNextAlwaysReadyIndex >= fNumAlwaysReadySockets) fNextAlwaysReadyIndex = 0;
+    EpollSocketHandler* handler = lookupSocketHandler(fAlwaysReadySockets[fNextAlwaysReadyIndex++]);
+    int resultConditionSet = handler->conditionSet&(SOCKET_READABLE|SOCKET_WRITABLE);
+    if (resultConditionSet != 0) (*handler->handlerProc)(handler->clientData, resultConditionSet);
+  }
+
+  // Also handle any newly-triggered event (Note that we do this *after* calling socket handlers,
+  // in case the triggered event handler modifies The set of readable sockets.)
+  handleNewlyTriggeredEvent();
+
+  // Also handle any delayed event that may have come due.
+  fDelayQueue.handleAlarm();
+}
+
+void EpollTaskScheduler
+  ::setBackgroundHandling(int socketNum, int conditionSet, BackgroundHandlerProc* handlerProc, void* clientData) {
+  if (socketNum < 0) return;
+
+  EpollSocketHandler* handler = lookupSocketHandler(socketNum);
+  int oldConditionSet = handler == NULL ? 0 : handler->conditionSet;
+  if (conditionSet == 0) {
+    if (handler == NULL) return;
+    if (handler->alwaysReadyIndex >= 0) {
+      removeAlwaysReadySocket(handler);
+    } else {
+      (void)updateEpollRegistration(socketNum, oldConditionSet, 0);
+    }
+    handler->conditionSet = 0;
+    handler->handlerProc = NULL;
+    handler->clientData = NULL;
+    return;
+  }
+
+  if (handler == NULL) {
+    // Grow our array of handlers, so that it includes "socketNum":
+    int newSize = fSocketHandlersSize == 0 ? 64 : fSocketHandlersSize;
+    while (newSize <= socketNum) newSize *= 2;
+
+    EpollSocketHandler* newSocketHandlers = new EpollSocketHandler[newSize];
+    if (fSocketHandlersSize > 0) {
+      memcpy(newSocketHandlers, fSocketHandlers, fSocketHandlersSize*sizeof (EpollSocketHandler));
+    }
+    memset(&newSocketHandlers[fSocketHandlersSize], 0, (newSize - fSocketHandlersSize)*sizeof (EpollSocketHandler));
+    for (int i = fSocketHandlersSize; i < newSize; ++i) newSocketHandlers[i].alwaysReadyIndex = -1;
+    delete[] fSocketHandlers;
+    fSocketHandlers = newSocketHandlers;
+    fSocketHandlersSize = newSize;
+
+    handler = &fSocketHandlers[socketNum];
+  }
+
+  if (handler->alwaysReadyIndex < 0 && !updateEpollRegistration(socketNum, oldConditionSet, conditionSet)) {
+    // "epoll" refuses to watch some kinds of descriptor - e.g., regular files - that "select()" would report as always
+    // being ready.  Do the same for these:
+    if (errno != EPERM) return;
+    addAlwaysReadySocket(socketNum, handler);
+  }
+  handler->conditionSet = conditionSet;
+  handler->handlerProc = handlerProc;
+  handler->clientData = clientData;
+}
+
+void EpollTaskScheduler::moveSocketHandling(int oldSocketNum, int newSocketNum) {
+  if (oldSocketNum < 0 || newSocketNum < 0) return; // sanity check
+
+  EpollSocketHandler* oldHandler = lookupSocketHandler(oldSocketNum);
+  if (oldHandler == NULL || oldHandler->conditionSet == 0) return;
+
+  // Copy the handler first, because "setBackgroundHandling()" may reallocate our array:
+  EpollSocketHandler handler = *oldHandler;
+  setBackgroundHandling(oldSocketNum, 0, NULL, NULL);
+  setBackgroundHandling(newSocketNum, handler.conditionSet, handler.handlerProc, handler.clientData);
+}
+
+EpollSocketHandler* EpollTaskScheduler::lookupSocketHandler(int socketNum) {
+  if (socketNum < 0 || socketNum >= fSocketHandlersSize) return NULL;
+  return &fSocketHandlers[socketNum];
+}
+
+Boolean EpollTaskScheduler::updateEpollRegistration(int socketNum, int oldConditionSet, int newConditionSet) {
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof ev);
+  ev.events = epollEventsFor(newConditionSet);
+  ev.data.fd = socketNum;
+
+  if (newConditionSet == 0) {
+    // Note: This fails (harmlessly) if the socket has already been closed; "epoll" will have dropped it already:
+    (void)epoll_ctl(fEpollFd, EPOLL_CTL_DEL, socketNum, &ev);
+    return True;
+  }
+
+  int op = oldConditionSet == 0 ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+  if (epoll_ctl(fEpollFd, op, socketNum, &ev) == 0) return True;
+
+  // Our idea of the socket's registration might be out of date - e.g., if the socket had been closed (and its number
+  // reused) without first disabling its handling.  Try again with the other operation:
+  if (op == EPOLL_CTL_ADD && errno == EEXIST) {
+    if (epoll_ctl(fEpollFd, EPOLL_CTL_MOD, socketNum, &ev) == 0) return True;
+  } else if (op == EPOLL_CTL_MOD && errno == ENOENT) {
+    if (epoll_ctl(fEpollFd, EPOLL_CTL_ADD, socketNum, &ev) == 0) return True;
+  }
+
+  if (errno == EPERM) return False; // this kind of descriptor can't be watched by "epoll"; our caller handles this
+  fprintf(stderr, "EpollTaskScheduler::setBackgroundHandling(): epoll_ctl() failed for socket %d: %s\n",
+	  socketNum, strerror(errno));
+  return False;
+}
+
+void EpollTaskScheduler::addAlwaysReadySocket(int socketNum, EpollSocketHandler* handler) {
+  if (fNumAlwaysReadySockets == fAlwaysReadySocketsSize) {
+    int newSize = fAlwaysReadySocketsSize == 0 ? 8 : 2*fAlwaysReadySocketsSize;
+    int* newAlwaysReadySockets = new int[newSize];
+    if (fNumAlwaysReadySockets > 0) {
+      memcpy(newAlwaysReadySockets, fAlwaysReadySockets, fNumAlwaysReadySockets*sizeof (int));
+    }
+    delete[] fAlwaysReadySockets;
+    fAlwaysReadySockets = newAlwaysReadySockets;
+    fAlwaysReadySocketsSize = newSize;
+  }
+
+  handler->alwaysReadyIndex = fNumAlwaysReadySockets;
+  fAlwaysReadySockets[fNumAlwaysReadySockets++] = socketNum;
+}
+
+void EpollTaskScheduler::removeAlwaysReadySocket(EpollSocketHandler* handler) {
+  // Move the last entry into this one's place:
+  int index = handler->alwaysReadyIndex;
+  int lastSocketNum = fAlwaysReadySockets[--fNumAlwaysReadySockets];
+  fAlwaysReadySockets[index] = lastSocketNum;
+  lookupSocketHandler(lastSocketNum)->alwaysReadyIndex = index;
+
+  handler->alwaysReadyIndex = -1;
+}
+
+#endif
@@ -0,0 +1,260 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2026 Live Networks, Inc.  All rights reserved.
+// Open-addressing Hash Table implementation
+// Implementation
+
+#include "OpenAddressingHashTable.hh"
+#include "strDup.hh"
+#include <string.h>
+
+// Values of the per-slot 'control' bytes.  (A slot that holds an entry has, as its control byte,
+// the top 7 bits of the entry's hash - i.e., a value < 0x80.)
+#define SLOT_EMPTY 0x80
+#define SLOT_DELETED 0xFE
+
+#define INITIAL_NUM_SLOTS 8 // must be a power of 2
+
+OpenAddressingHashTable::OpenAddressingHashTable(int keyType)
+  : fControl(NULL), fSlots(NULL), fNumSlots(0), fMask(0),
+    fNumEntries(0), fNumDeleted(0), fFirstUsedIndex(0), fKeyType(keyType) {
+  // Figure out how much inline key storage each slot needs (rounded up so that slots stay pointer-aligned):
+  if (fKeyType == STRING_HASH_KEYS) {
+    fInlineKeySize = OPEN_ADDRESSING_HASH_TABLE_INLINE_STRING_SIZE;
+  } else if (fKeyType == ONE_WORD_HASH_KEYS) {
+    fInlineKeySize = 0;
+  } else {
+    fInlineKeySize = fKeyType*sizeof (unsigned);
+  }
+  fInlineKeySize = (fInlineKeySize + sizeof (Slot*) - 1) & ~(unsigned)(sizeof (Slot*) - 1);
+  fSlotSize = sizeof (Slot) + fInlineKeySize;
+}
+
+OpenAddressingHashTable::~OpenAddressingHashTable() {
+  for (unsigned i = 0; i < fNumSlots; ++i) {
+    if (fControl[i] < SLOT_EMPTY) deleteKey(slotAt(i));
+  }
+  delete[] fControl; delete[] fSlots;
+}
+
+void* OpenAddressingHashTable::Add(char const* key, void* value) {
+  u_int32_t hash = hashFromKey(key);
+  int index = lookupKey(key, hash);
+  if (index >= 0) {
+    // There's already an item with this key
+    Slot* slot = slotAt(index);
+    void* oldValue = slot->value;
+    slot->value = value;
+    return oldValue;
+  }
+
+  // There's no existing entry; first make sure that there'll still be enough free slots after we add one.
+  // (We keep the 'used' (entries + deleted) slots to at most 3/4 of the table, and grow the table
+  //  if it would otherwise become more than half full of entries.)
+  if (fNumSlots == 0) {
+    rebuild(INITIAL_NUM_SLOTS);
+  } else if ((fNumEntries + fNumDeleted + 1)*4 > fNumSlots*3) {
+    rebuild((fNumEntries + 1)*2 > fNumSlots ? fNumSlots*2 : fNumSlots);
+  }
+
+  unsigned freeIndex = findFreeSlot(hash);
+  if (fControl[freeIndex] == SLOT_DELETED) --fNumDeleted;
+  fControl[freeIndex] = (u_int8_t)(hash>>25);
+  ++fNumEntries;
+  if (freeIndex < fFirstUsedIndex) fFirstUsedIndex = freeIndex;
+
+  Slot* slot = slotAt(freeIndex);
+  assignKey(slot, key);
+  slot->value = value;
+
+  return NULL;
+}
+
+Boolean OpenAddressingHashTable::Remove(char const* key) {
+  int index = lookupKey(key, hashFromKey(key));
+  if (index < 0) return False; // no such entry
+
+  deleteKey(slotAt(index));
+  --fNumEntries;
+  if ((unsigned)index == fFirstUsedIndex) {
+    // Move on to the next entry (if any):
+    while (++fFirstUsedIndex < fNumSlots && fControl[fFirstUsedIndex] >= SLOT_EMPTY) {}
+  }
+
+  // If the next slot is empty, then no probe sequence continues past this slot, so it can become empty
+  // also.  Otherwise, we need to leave a 'deleted' marker, so that later lookups continue probing past it.
+  // (Either way, no other entry moves, so any iteration that's in progress remains valid.)
+  if (fControl[(index+1)&fMask] == SLOT_EMPTY) {
+    fControl[index] = SLOT_EMPTY;
+  } else {
+    fControl[index] = SLOT_DELETED;
+    ++fNumDeleted;
+  }
+
+  return True;
+}
+
+void* OpenAddressingHashTable::Lookup(char const* key) const {
+  int index = lookupKey(key, hashFromKey(key));
+  if (index < 0) return NULL; // no such entry
+
+  return slotAt(index)->value;
+}
+
+unsigned OpenAddressingHashTable::numEntries() const {
+  return fNumEntries;
+}
+
+HashTable::Iterator* OpenAddressingHashTable::createIterator() const {
+  return new Iterator(*this);
+}
+
+OpenAddressingHashTable::Iterator::Iterator(OpenAddressingHashTable const& table)
+  : fTable(table), fNextIndex(table.fFirstUsedIndex) {
+}
+
+void* OpenAddressingHashTable::Iterator::next(char const*& key) {
+  while (fNextIndex < fTable.fNumSlots) {
+    unsigned index = fNextIndex++;
+    if (fTable.fControl[index] < SLOT_EMPTY) {
+      Slot* slot = fTable.slotAt(index);
+      key = slot->key;
+      return slot->value;
+    }
+  }
+
+  return NULL;
+}
+
+////////// Implementation of internal member functions //////////
+
+static u_int32_t mix(u_int32_t h) {
+  // A 'finalizer' (from MurmurHash3), so that every input bit affects both the slot index (the low bits)
+  // and the control byte (the top 7 bits):
+  h ^= h >> 16; h *= 0x85ebca6b;
+  h ^= h >> 13; h *= 0xc2b2ae35;
+  h ^= h >> 16;
+  return h;
+}
+
+u_int32_t OpenAddressingHashTable::hashFromKey(char const* key) const {
+  u_int32_t result = 2166136261U; // FNV-1a
+
+  if (fKeyType == STRING_HASH_KEYS) {
+    for (unsigned char const* p = (unsigned char const*)key; *p != '\0'; ++p) {
+      result = (result ^ *p)*16777619U;
+    }
+  } else if (fKeyType == ONE_WORD_HASH_KEYS) {
+    u_int64_t k = (u_int64_t)(uintptr_t)key;
+    result = (u_int32_t)k ^ (u_int32_t)(k>>32);
+  } else {
+    unsigned const* k = (unsigned const*)key;
+    for (int i = 0; i < fKeyType; ++i) {
+      result = (result ^ k[i])*16777619U;
+    }
+  }
+
+  return mix(result);
+}
+
+Boolean OpenAddressingHashTable
+::keyMatches(char const* key1, char const* key2) const {
+  // The way we check the keys for a match depends upon their type:
+  if (fKeyType == STRING_HASH_KEYS) {
+    return (strcmp(key1, key2) == 0);
+  } else if (fKeyType == ONE_WORD_HASH_KEYS) {
+    return (key1 == key2);
+  } else {
+    return memcmp(key1, key2, fKeyType*sizeof (unsigned)) == 0;
+  }
+}
+
+int OpenAddressingHashTable::lookupKey(char const* key, u_int32_t hash) const {
+  if (fNumSlots == 0) return -1;
+
+  u_int8_t tag = (u_int8_t)(hash>>25);
+  for (unsigned index = hash&fMask; ; index = (index+1)&fMask) {
+    // Note: Because we never let the table fill up, an empty slot always ends this loop.
+    u_int8_t control = fControl[index];
+    if (control == SLOT_EMPTY) return -1;
+    if (control == tag && keyMatches(key, slotAt(index)->key)) return (int)index;
+  }
+}
+
+unsigned OpenAddressingHashTable::findFreeSlot(u_int32_t hash) const {
+  unsigned index = hash&fMask;
+  while (fControl[index] < SLOT_EMPTY) index = (index+1)&fMask;
+
+  return index;
+}
+
+void OpenAddressingHashTable::assignKey(Slot* slot, char const* key) {
+  // The way we assign the key depends upon its type:
+  if (fKeyType == STRING_HASH_KEYS) {
+    size_t keySize = strlen(key) + 1;
+    if (keySize <= fInlineKeySize) {
+      memcpy(inlineKeyOf(slot), key, keySize);
+      slot->key = inlineKeyOf(slot);
+    } else {
+      slot->key = strDup(key);
+    }
+  } else if (fKeyType == ONE_WORD_HASH_KEYS) {
+    slot->key = key;
+  } else {
+    memcpy(inlineKeyOf(slot), key, fKeyType*sizeof (unsigned));
+    slot->key = inlineKeyOf(slot);
+  }
+}
+
+void OpenAddressingHashTable::deleteKey(Slot* slot) {
+  // Only long string keys were allocated separately:
+  if (fKeyType == STRING_HASH_KEYS && slot->key != inlineKeyOf(slot)) {
+    delete[] (char*)slot->key;
+  }
+  slot->key = NULL;
+}
+
+void OpenAddressingHashTable::rebuild(unsigned newNumSlots) {
+  // Remember the existing table:
+  unsigned oldNumSlots = fNumSlots;
+  u_int8_t* oldControl = fControl;
+  char* oldSlots = fSlots;
+
+  // Create the new sized table:
+  fNumSlots = newNumSlots;
+  fMask = fNumSlots - 1;
+  fControl = new u_int8_t[fNumSlots];
+  memset(fControl, SLOT_EMPTY, fNumSlots);
+  fSlots = new char[fNumSlots*fSlotSize];
+  fNumDeleted = 0;
+  fFirstUsedIndex = fNumSlots;
+
+  // Move the existing entries into the new table:
+  for (unsigned i = 0; i < oldNumSlots; ++i) {
+    if (oldControl[i] >= SLOT_EMPTY) continue;
+
+    Slot* oldSlot = (Slot*)&oldSlots[i*fSlotSize];
+    unsigned newIndex = findFreeSlot(hashFromKey(oldSlot->key));
+    fControl[newIndex] = oldControl[i];
+    if (newIndex < fFirstUsedIndex) fFirstUsedIndex = newIndex;
+
+    Slot* newSlot = slotAt(newIndex);
+    memcpy(newSlot, oldSlot, fSlotSize);
+    if (fInlineKeySize > 0 && oldSlot->key == inlineKeyOf(oldSlot)) newSlot->key = inlineKeyOf(newSlot);
+  }
+
+  delete[] oldControl; delete[] oldSlots;
+}
@@ -62,6 +62,7 @@ private: // implementation of inherited pure virtual functions
   virtual void* Lookup(char const* key) const;
   // Returns 0 if not found
   virtual unsigned numEntries() const;
+  virtual HashTable::Iterator* createIterator() const;
 
 private:
   class TableEntry {
@@ -24,6 +24,10 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "BasicUsageEnvironment0.hh"
 #endif
 
+#if defined(__linux__) && !defined(NO_EPOLL)
+#define HAVE_EPOLL_TASK_SCHEDULER 1
+#endif
+
 class BasicUsageEnvironment: public BasicUsageEnvironment0 {
 public:
   static BasicUsageEnvironment* createNew(TaskScheduler& taskScheduler);
@@ -83,4 +87,50 @@ private:
 #endif
 };
 
+#ifdef HAVE_EPOLL_TASK_SCHEDULER
+// A task scheduler that uses Linux "epoll()" instead of "select()".
+// Unlike "BasicTaskScheduler", the cost of each event loop iteration depends only on the number
+// of sockets that are ready (not on the highest socket number), and there's no "FD_SETSIZE" limit.
+class EpollTaskScheduler: public BasicTaskScheduler0 {
+public:
+  static EpollTaskScheduler* createNew(unsigned maxSchedulerGranularity = 10000/*microseconds*/);
+    // Returns NULL if "epoll" is not available (in which case you can use "BasicTaskScheduler" instead).
+    // "maxSchedulerGranularity" has the same meaning as for "BasicTaskScheduler".
+  virtual ~EpollTaskScheduler();
+
+protected:
+  EpollTaskScheduler(int epollFd, unsigned maxSchedulerGranularity);
+      // called only by "createNew()"
+
+  static void schedulerTickTask(void* clientData);
+  void schedulerTickTask();
+
+protected:
+  // Redefined virtual functions:
+  virtual void SingleStep(unsigned maxDelayTime);
+
+  virtual void setBackgroundHandling(int socketNum, int conditionSet, BackgroundHandlerProc* handlerProc, void* clientData);
+  virtual void moveSocketHandling(int oldSocketNum, int newSocketNum);
+
+private:
+  struct EpollSocketHandler* lookupSocketHandler(int socketNum);
+  Boolean updateEpollRegistration(int socketNum, int oldConditionSet, int newConditionSet);
+  void addAlwaysReadySocket(int socketNum, struct EpollSocketHandler* handler);
+  void removeAlwaysReadySocket(struct EpollSocketHandler* handler);
+
+protected:
+  unsigned fMaxSchedulerGranularity;
+
+private:
+  int fEpollFd;
+  struct EpollSocketHandler* fSocketHandlers; // indexed by socket number
+  int fSocketHandlersSize;
+
+  // Descriptors that "epoll" can't watch (e.g., regular files).  Like "select()", we treat these as always ready:
+  int* fAlwaysReadySockets;
+  int fNumAlwaysReadySockets, fAlwaysReadySocketsSize;
+  int fNextAlwaysReadyIndex; // we handle these round-robin, one per "SingleStep()"
+};
+#endif
+
 #endif
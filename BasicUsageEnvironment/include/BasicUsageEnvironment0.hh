@@ -100,6 +100,9 @@ public:
 protected:
   BasicTaskScheduler0();
 
+  void handleNewlyTriggeredEvent();
+      // Called by a subclass's "SingleStep()" to handle (at most) one pending 'triggered event'
+
 protected:
   // To implement delayed operations:
   intptr_t fTokenCounter;
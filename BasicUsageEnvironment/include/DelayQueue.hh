@@ -23,6 +23,9 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #ifndef _NET_COMMON_H
 #include "NetCommon.h"
 #endif
+#ifndef _BOOLEAN_HH
+#include "Boolean.hh"
+#endif
 
 #ifdef TIME_BASE
 typedef TIME_BASE time_base_seconds;
@@ -147,16 +150,21 @@ protected: // abstract base class
 
 private:
   friend class DelayQueue;
-  DelayQueueEntry* fNext;
-  DelayQueueEntry* fPrev;
-  DelayInterval fDeltaTimeRemaining;
+  DelayInterval fDeltaTimeRemaining; // used only when the entry is added to (or updated in) a queue
+  int64_t fDueTime; // in microseconds, relative to the queue's own (monotonic) clock
+  u_int64_t fSequenceNum; // used to break ties between entries that have the same "fDueTime"
+  unsigned fHeapIndex; // our position in the queue's heap, or ~0 if we're not in a queue
 
   intptr_t fToken;
 };
 
 ///// DelayQueue /////
 
-class DelayQueue: public DelayQueueEntry {
+// A priority queue of "DelayQueueEntry"s, implemented as a binary heap (ordered by due time).
+// Adding, updating and removing an entry are O(log n), and looking up an entry by its token is O(1),
+// so the cost of scheduling a delayed task does not grow with the number of tasks already scheduled.
+// Entries that are due at the same time are handled in the order in which they were added.
+class DelayQueue {
 public:
   DelayQueue();
   virtual ~DelayQueue();
@@ -170,12 +178,28 @@ public:
   DelayInterval const& timeToNextAlarm();
   void handleAlarm();
 
+  unsigned numEntries() const { return fNumEntries; }
+
 private:
-  DelayQueueEntry* head() { return fNext; }
+  DelayQueueEntry* head() { return fNumEntries == 0 ? NULL : fHeap[0]; }
   DelayQueueEntry* findEntryByToken(intptr_t token);
-  void synchronize(); // bring the 'time remaining' fields up-to-date
+  void synchronize(); // bring "fTimeNow" up-to-date
+
+  Boolean entryIsEarlier(DelayQueueEntry const* entry1, DelayQueueEntry const* entry2) const;
+  void placeEntryAt(DelayQueueEntry* entry, unsigned index);
+  void siftUp(unsigned index);
+  void siftDown(unsigned index);
 
   _EventTime fLastSyncTime;
+  int64_t fTimeNow; // microseconds since we were created; never goes backwards
+  u_int64_t fNextSequenceNum;
+
+  DelayQueueEntry** fHeap;
+  unsigned fNumEntries;
+  unsigned fHeapSize;
+  class HashTable* fEntriesByToken;
+
+  DelayInterval fTimeToNextAlarm; // the result of the most recent call to "timeToNextAlarm()"
 };
 
 #endif
@@ -0,0 +1,112 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2026 Live Networks, Inc.  All rights reserved.
+// Open-addressing Hash Table implementation
+// C++ header
+
+#ifndef _OPEN_ADDRESSING_HASH_TABLE_HH
+#define _OPEN_ADDRESSING_HASH_TABLE_HH
+
+#ifndef _HASH_TABLE_HH
+#include "HashTable.hh"
+#endif
+#ifndef _NET_COMMON_H
+#include <NetCommon.h> // to ensure that "uintptr_t" and "u_int8_t" are defined
+#endif
+
+// A hash table that stores its entries in a single, flat array of slots (probed linearly),
+// rather than in separately-allocated chained entries (as "BasicHashTable" does).
+// Alongside the slot array is an array of one-byte 'control' values - one per slot - that holds
+// 7 bits of each entry's hash (or else marks the slot as empty or deleted), so that most
+// non-matching slots are skipped without touching (or comparing) their keys.
+//
+// Multi-word keys, and string keys shorter than OPEN_ADDRESSING_HASH_TABLE_INLINE_STRING_SIZE,
+// are stored within the slot itself, so (apart from long string keys) adding an entry
+// allocates no memory unless the table needs to grow.
+//
+// Removing an entry never moves any other entry, so - as with "BasicHashTable" - it's OK to
+// remove the entry that an iterator has just returned.  However, unlike "BasicHashTable",
+// adding an entry can move the (inline) keys of the other entries, so a key pointer returned
+// by an iterator is valid only until the next "Add()".
+
+#ifndef OPEN_ADDRESSING_HASH_TABLE_INLINE_STRING_SIZE
+#define OPEN_ADDRESSING_HASH_TABLE_INLINE_STRING_SIZE 24 // bytes, including the trailing '\0'
+#endif
+
+class OpenAddressingHashTable: public HashTable {
+public:
+  OpenAddressingHashTable(int keyType);
+  virtual ~OpenAddressingHashTable();
+
+  // Used to iterate through the members of the table:
+  class Iterator; friend class Iterator; // to make Sun's C++ compiler happy
+  class Iterator: public HashTable::Iterator {
+  public:
+    Iterator(OpenAddressingHashTable const& table);
+
+  private: // implementation of inherited pure virtual functions
+    void* next(char const*& key); // returns 0 if none
+
+  private:
+    OpenAddressingHashTable const& fTable;
+    unsigned fNextIndex; // index of the next slot to be examined
+  };
+
+private: // implementation of inherited pure virtual functions
+  virtual void* Add(char const* key, void* value);
+  // Returns the old value if different, otherwise 0
+  virtual Boolean Remove(char const* key);
+  virtual void* Lookup(char const* key) const;
+  // Returns 0 if not found
+  virtual unsigned numEntries() const;
+  virtual HashTable::Iterator* createIterator() const;
+
+private:
+  class Slot {
+  public:
+    char const* key; // points to our inline key storage (which follows us), unless it's a ONE_WORD key or a long string
+    void* value;
+  };
+
+  Slot* slotAt(unsigned index) const { return (Slot*)&fSlots[index*fSlotSize]; }
+  char* inlineKeyOf(Slot* slot) const { return (char*)(slot+1); }
+
+  u_int32_t hashFromKey(char const* key) const;
+  Boolean keyMatches(char const* key1, char const* key2) const;
+
+  int lookupKey(char const* key, u_int32_t hash) const;
+    // returns the index of the slot that holds "key", or -1 if none
+  unsigned findFreeSlot(u_int32_t hash) const;
+    // returns the index of the first empty or deleted slot along "hash"'s probe sequence
+
+  void assignKey(Slot* slot, char const* key);
+  void deleteKey(Slot* slot);
+
+  void rebuild(unsigned newNumSlots); // also discards 'deleted' markers
+
+private:
+  u_int8_t* fControl; // one byte per slot
+  char* fSlots; // "fNumSlots" slots, each "fSlotSize" bytes long
+  unsigned fNumSlots; // 0 (until the first "Add()"), or a power of 2
+  unsigned fMask; // fNumSlots - 1
+  unsigned fSlotSize, fInlineKeySize;
+  unsigned fNumEntries, fNumDeleted;
+  unsigned fFirstUsedIndex; // the first slot that holds an entry (or "fNumSlots" if none).  Iterators start here,
+      // so that repeated "RemoveNext()" calls - which we often use to empty a table - don't each rescan the table.
+  int fKeyType;
+};
+
+#endif
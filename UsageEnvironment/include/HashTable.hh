@@ -31,6 +31,12 @@ public:
   // The following must be implemented by a particular
   // implementation (subclass):
   static HashTable* create(int keyType);
+      // Creates a "BasicHashTable" (chained entries), unless we were built with
+      // "USE_OPEN_ADDRESSING_HASH_TABLES" defined, in which case it's the same as:
+  static HashTable* create(int keyType, Boolean useOpenAddressing);
+      // If "useOpenAddressing" is True, creates an "OpenAddressingHashTable" - which is usually faster,
+      // especially for large tables - but note that a key returned by an iterator over such a table is
+      // valid only until the next "Add()".
   
   virtual void* Add(char const* key, void* value) = 0;
   // Returns the old value if different, otherwise 0
@@ -66,6 +72,9 @@ public:
   
 protected:
   HashTable(); // abstract base class
+
+  friend class Iterator;
+  virtual Iterator* createIterator() const = 0; // used to implement "Iterator::create()"
 };
 
 // Warning: The following are deliberately the same as in
@@ -25,6 +25,14 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #endif
 #include <stdio.h>
 
+#if defined(__linux__) && !defined(NO_SENDMMSG)
+#define USE_SENDMMSG 1
+#include <netinet/udp.h>
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103 // from <linux/udp.h>, for older C libraries
+#endif
+#endif
+
 ////////// library version constants //////////
 
 extern char const* const groupsockLibraryVersionStr = GROUPSOCK_LIBRARY_VERSION_STRING;
@@ -47,14 +55,21 @@ OutputSocket::~OutputSocket() {
 
 Boolean OutputSocket::write(struct sockaddr_storage const& addressAndPort, u_int8_t ttl,
 			    unsigned char* buffer, unsigned bufferSize) {
-  if ((unsigned)ttl == fLastSentTTL) {
-    // Optimization: Don't do a 'set TTL' system call again
-    if (!writeSocket(env(), socketNum(), addressAndPort, buffer, bufferSize)) return False;
-  } else {
-    if (!writeSocket(env(), socketNum(), addressAndPort, ttl, buffer, bufferSize)) return False;
-    fLastSentTTL = (unsigned)ttl;
-  }
+  if (!prepareToWrite(addressAndPort, ttl)) return False;
+  if (!writeSocket(env(), socketNum(), addressAndPort, buffer, bufferSize)) return False;
+
+  return noteWriteDone(addressAndPort);
+}
+
+Boolean OutputSocket::prepareToWrite(struct sockaddr_storage const& addressAndPort, u_int8_t ttl) {
+  if ((unsigned)ttl == fLastSentTTL) return True; // Optimization: Don't do a 'set TTL' system call again
+
+  if (!setSocketTTL(env(), socketNum(), addressAndPort, ttl)) return False;
+  fLastSentTTL = (unsigned)ttl;
+  return True;
+}
 
+Boolean OutputSocket::noteWriteDone(struct sockaddr_storage const& addressAndPort) {
   if (sourcePortNum() == 0) {
     // Now that we've sent a packet, we can find out what the
     // kernel chose as our ephemeral source port number:
@@ -91,17 +106,83 @@ destRecord::~destRecord() {
 }
 
 
+///////// BatchedOutputQueue //////////
+
+#define GROUPSOCK_MAX_BATCHED_PACKETS 64
+    // the queue is flushed automatically once it holds this many packets
+#define GROUPSOCK_MAX_GSO_SEGMENTS 64
+#define GROUPSOCK_MAX_GSO_BYTES 65000
+    // limits on a single "UDP_SEGMENT" send (a UDP datagram can't be larger than 64 KBytes)
+
+class BatchedOutputQueue {
+public:
+  BatchedOutputQueue(int socketNum);
+  virtual ~BatchedOutputQueue();
+
+  void enqueue(unsigned char const* buffer, unsigned bufferSize);
+  void reset() { fNumPackets = 0; }
+
+  unsigned numPackets() const { return fNumPackets; }
+  Boolean isFull() const { return fNumPackets == GROUPSOCK_MAX_BATCHED_PACKETS; }
+  unsigned char* packetData(unsigned i) const { return fPacketData[i]; }
+  unsigned packetSize(unsigned i) const { return fPacketSize[i]; }
+
+  Boolean gsoIsUsable() const { return fGSOIsUsable; }
+  void setGSOIsUsable(Boolean gsoIsUsable) { fGSOIsUsable = gsoIsUsable; }
+
+private:
+  unsigned fNumPackets;
+  unsigned char* fPacketData[GROUPSOCK_MAX_BATCHED_PACKETS];
+  unsigned fPacketSize[GROUPSOCK_MAX_BATCHED_PACKETS];
+  unsigned fPacketBufferSize[GROUPSOCK_MAX_BATCHED_PACKETS];
+  Boolean fGSOIsUsable;
+};
+
+BatchedOutputQueue::BatchedOutputQueue(int socketNum)
+  : fNumPackets(0), fGSOIsUsable(False) {
+  for (unsigned i = 0; i < GROUPSOCK_MAX_BATCHED_PACKETS; ++i) {
+    fPacketData[i] = NULL;
+    fPacketSize[i] = fPacketBufferSize[i] = 0;
+  }
+
+#ifdef USE_SENDMMSG
+  // Check whether the kernel supports UDP GSO.  (Kernels that predate it (< 4.18) would silently ignore the
+  // "UDP_SEGMENT" control message - sending one large datagram - so we must not use it there.)
+  int gsoSize;
+  SOCKLEN_T gsoSizeSize = sizeof gsoSize;
+  fGSOIsUsable = getsockopt(socketNum, IPPROTO_UDP, UDP_SEGMENT, &gsoSize, &gsoSizeSize) == 0;
+#endif
+}
+
+BatchedOutputQueue::~BatchedOutputQueue() {
+  for (unsigned i = 0; i < GROUPSOCK_MAX_BATCHED_PACKETS; ++i) delete[] fPacketData[i];
+}
+
+void BatchedOutputQueue::enqueue(unsigned char const* buffer, unsigned bufferSize) {
+  if (bufferSize > fPacketBufferSize[fNumPackets]) {
+    // This packet slot is too small; reallocate it:
+    delete[] fPacketData[fNumPackets];
+    fPacketData[fNumPackets] = new unsigned char[bufferSize];
+    fPacketBufferSize[fNumPackets] = bufferSize;
+  }
+  memmove(fPacketData[fNumPackets], buffer, bufferSize);
+  fPacketSize[fNumPackets] = bufferSize;
+  ++fNumPackets;
+}
+
+
 ///////// Groupsock //////////
 
 NetInterfaceTrafficStats Groupsock::statsIncoming;
 NetInterfaceTrafficStats Groupsock::statsOutgoing;
+NetInterfaceBatchStats Groupsock::statsBatchedOutgoing;
 
 // Constructor for a source-independent multicast group
 Groupsock::Groupsock(UsageEnvironment& env, struct sockaddr_storage const& groupAddr,
 		     Port port, u_int8_t ttl)
   : OutputSocket(env, port, groupAddr.ss_family),
     fDests(new destRecord(groupAddr, port, ttl, 0, NULL)),
-    fIncomingGroupEId(groupAddr, port.num(), ttl) {
+    fIncomingGroupEId(groupAddr, port.num(), ttl), fBatchedOutput(False), fBatchedOutputQueue(NULL) {
   if (!socketJoinGroup(env, socketNum(), groupAddr)) {
     if (DebugLevel >= 1) {
       env << *this << ": failed to join group: "
@@ -126,7 +207,7 @@ Groupsock::Groupsock(UsageEnvironment& env, struct sockaddr_storage const& group
 		     Port port)
   : OutputSocket(env, port, groupAddr.ss_family),
     fDests(new destRecord(groupAddr, port, 255, 0, NULL)),
-    fIncomingGroupEId(groupAddr, sourceFilterAddr, port.num()) {
+    fIncomingGroupEId(groupAddr, sourceFilterAddr, port.num()), fBatchedOutput(False), fBatchedOutputQueue(NULL) {
   // First try a SSM join.  If that fails, try a regular join:
   if (!socketJoinGroupSSM(env, socketNum(), groupAddr, sourceFilterAddr)) {
     if (DebugLevel >= 3) {
@@ -146,6 +227,8 @@ Groupsock::Groupsock(UsageEnvironment& env, struct sockaddr_storage const& group
 }
 
 Groupsock::~Groupsock() {
+  setBatchedOutput(False); // sends any packets that are still queued
+
   if (isSSM()) {
     if (!socketLeaveGroupSSM(env(), socketNum(), groupAddress(), sourceFilterAddress())) {
       socketLeaveGroup(env(), socketNum(), groupAddress());
@@ -155,6 +238,7 @@ Groupsock::~Groupsock() {
   }
 
   delete fDests;
+  delete fBatchedOutputQueue;
 
   if (DebugLevel >= 2) env() << *this << ": deleting\n";
 }
@@ -169,6 +253,7 @@ destRecord* Groupsock
 void
 Groupsock::changeDestinationParameters(struct sockaddr_storage const& newDestAddr,
 				       Port newDestPort, int newDestTTL, unsigned sessionId) {
+  flushBatchedOutput(env()); // the queued packets were meant for the current destinations
   destRecord* dest;
   for (dest = fDests; dest != NULL && dest->fSessionId != sessionId; dest = dest->fNext) {}
 
@@ -239,11 +324,13 @@ void Groupsock::addDestination(struct sockaddr_storage const& addr, Port const&
 }
 
 void Groupsock::removeDestination(unsigned sessionId) {
+  flushBatchedOutput(env()); // the queued packets were meant for the current destinations
   // Default implementation:
   removeDestinationFrom(fDests, sessionId);
 }
 
 void Groupsock::removeAllDestinations() {
+  flushBatchedOutput(env()); // the queued packets were meant for the current destinations
   delete fDests; fDests = NULL;
 }
 
@@ -259,6 +346,13 @@ void Groupsock::multicastSendOnly() {
 }
 
 Boolean Groupsock::output(UsageEnvironment& env, unsigned char* buffer, unsigned bufferSize) {
+  if (fBatchedOutput && fDests != NULL) {
+    // Just queue the packet; it'll get sent (along with any others) by "flushBatchedOutput()":
+    fBatchedOutputQueue->enqueue(buffer, bufferSize);
+    if (fBatchedOutputQueue->isFull()) return flushBatchedOutput(env);
+    return True;
+  }
+
   do {
     // First, do the datagram send, to each destination:
     Boolean writeSuccess = True;
@@ -286,6 +380,152 @@ Boolean Groupsock::output(UsageEnvironment& env, unsigned char* buffer, unsigned
   return False;
 }
 
+void Groupsock::setBatchedOutput(Boolean batchedOutput) {
+  if (batchedOutput) {
+#ifdef USE_SENDMMSG
+    // (We keep the queue - and its packet buffers - around until we're deleted, because batched output
+    // is often enabled and disabled repeatedly.)
+    if (fBatchedOutputQueue == NULL) fBatchedOutputQueue = new BatchedOutputQueue(socketNum());
+    fBatchedOutput = True;
+#endif
+  } else if (fBatchedOutput) {
+    flushBatchedOutput(env());
+    fBatchedOutput = False;
+  }
+}
+
+Boolean Groupsock::flushBatchedOutput(UsageEnvironment& env) {
+  if (!fBatchedOutput || fBatchedOutputQueue->numPackets() == 0) return True;
+
+  Boolean success = True;
+  unsigned numDestinations = 0, numSystemCalls = 0;
+  for (destRecord* dests = fDests; dests != NULL; dests = dests->fNext) {
+    ++numDestinations;
+    if (!sendBatchedOutputTo(env, dests, numSystemCalls)) {
+      success = False;
+      break;
+    }
+  }
+
+  unsigned const numPackets = fBatchedOutputQueue->numPackets();
+  if (success) {
+    for (unsigned i = 0; i < numPackets; ++i) {
+      statsOutgoing.countPacket(fBatchedOutputQueue->packetSize(i));
+      statsGroupOutgoing.countPacket(fBatchedOutputQueue->packetSize(i));
+    }
+    statsBatchedOutgoing.countBatch(numPackets*numDestinations, numSystemCalls);
+    statsGroupBatchedOutgoing.countBatch(numPackets*numDestinations, numSystemCalls);
+
+    if (DebugLevel >= 3) {
+      env << *this << ": wrote " << numPackets << " queued packets to " << numDestinations
+	  << " destination(s), using " << numSystemCalls << " system call(s)\n";
+    }
+  }
+  fBatchedOutputQueue->reset();
+  if (success) return True;
+
+  if (DebugLevel >= 0) { // this is a fatal error
+    UsageEnvironment::MsgString msg = strDup(env.getResultMsg());
+    env.setResultMsg("Groupsock batched write failed: ", msg);
+    delete[] (char*)msg;
+  }
+  return False;
+}
+
+Boolean Groupsock
+::sendBatchedOutputTo(UsageEnvironment& env, destRecord* dest, unsigned& numSystemCalls) {
+#ifdef USE_SENDMMSG
+  struct sockaddr_storage const& destAddr = dest->fGroupEId.groupAddress();
+  if (!prepareToWrite(destAddr, dest->fGroupEId.ttl())) return False;
+
+  BatchedOutputQueue& queue = *fBatchedOutputQueue;
+  unsigned const numPackets = queue.numPackets();
+  struct mmsghdr messages[GROUPSOCK_MAX_BATCHED_PACKETS];
+  struct iovec iovecs[GROUPSOCK_MAX_BATCHED_PACKETS];
+  union {
+    struct cmsghdr align;
+    char buf[CMSG_SPACE(sizeof (u_int16_t))];
+  } controls[GROUPSOCK_MAX_BATCHED_PACKETS];
+
+  // Build one message for each packet - or, if we can use GSO, for each run of same-sized packets (the last of which
+  // may be shorter):
+  unsigned numMessages = 0;
+  for (unsigned i = 0; i < numPackets; ) {
+    unsigned const segmentSize = queue.packetSize(i);
+    unsigned runLength = 1, runSize = segmentSize;
+    if (queue.gsoIsUsable()) {
+      while (i + runLength < numPackets && runLength < GROUPSOCK_MAX_GSO_SEGMENTS) {
+	unsigned nextSize = queue.packetSize(i + runLength);
+	if (nextSize > segmentSize || runSize + nextSize > GROUPSOCK_MAX_GSO_BYTES) break;
+
+	runSize += nextSize;
+	++runLength;
+	if (nextSize < segmentSize) break; // only the last segment may be shorter
+      }
+    }
+
+    struct msghdr& msg = messages[numMessages].msg_hdr;
+    memset(&msg, 0, sizeof msg);
+    msg.msg_name = (void*)&destAddr;
+    msg.msg_namelen = addressSize(destAddr);
+    msg.msg_iov = &iovecs[i];
+    msg.msg_iovlen = runLength;
+    for (unsigned j = i; j < i + runLength; ++j) {
+      iovecs[j].iov_base = queue.packetData(j);
+      iovecs[j].iov_len = queue.packetSize(j);
+    }
+    if (runLength > 1) {
+      msg.msg_control = controls[numMessages].buf;
+      msg.msg_controllen = sizeof controls[numMessages].buf;
+      struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+      cmsg->cmsg_level = IPPROTO_UDP;
+      cmsg->cmsg_type = UDP_SEGMENT;
+      cmsg->cmsg_len = CMSG_LEN(sizeof (u_int16_t));
+      u_int16_t gsoSize = (u_int16_t)segmentSize;
+      memcpy(CMSG_DATA(cmsg), &gsoSize, sizeof gsoSize);
+    }
+
+    ++numMessages;
+    i += runLength;
+  }
+
+  // Then send the messages:
+  unsigned numMessagesSent = 0;
+  while (numMessagesSent < numMessages) {
+    int result = sendmmsg(socketNum(), &messages[numMessagesSent], numMessages - numMessagesSent, MSG_NOSIGNAL);
+    ++numSystemCalls;
+    if (result > 0) {
+      numMessagesSent += result;
+      continue;
+    }
+
+    struct msghdr& msg = messages[numMessagesSent].msg_hdr;
+    int err = env.getErrno();
+    if (msg.msg_iovlen > 1 && (err == EIO || err == EINVAL || err == EOPNOTSUPP)) {
+      // The kernel (or the network interface) can't do GSO for this message after all.  Stop using GSO on this socket,
+      // and send each of the message's segments separately instead:
+      queue.setGSOIsUsable(False);
+      for (unsigned j = 0; j < msg.msg_iovlen; ++j) {
+	if (!writeSocket(env, socketNum(), destAddr, (unsigned char*)msg.msg_iov[j].iov_base, msg.msg_iov[j].iov_len)) {
+	  return False;
+	}
+	++numSystemCalls;
+      }
+      ++numMessagesSent;
+      continue;
+    }
+
+    env.setResultErrMsg("sendmmsg() error: ");
+    return False;
+  }
+
+  return noteWriteDone(destAddr);
+#else
+  // Batched output isn't used on this platform:
+  return True;
+#endif
+}
+
 Boolean Groupsock::handleRead(unsigned char* buffer, unsigned bufferMaxSize,
 			      unsigned& bytesRead,
 			      struct sockaddr_storage& fromAddressAndPort) {
@@ -319,6 +559,38 @@ Boolean Groupsock::handleRead(unsigned char* buffer, unsigned bufferMaxSize,
   return True;
 }
 
+int Groupsock::handleReadBatch(unsigned numBuffers, unsigned char* const* buffers, unsigned const* bufferMaxSizes,
+			       unsigned* bytesRead, struct sockaddr_storage* fromAddressesAndPorts) {
+  int numPacketsRead = readSocketBatch(env(), socketNum(), numBuffers,
+				       buffers, bufferMaxSizes, bytesRead, fromAddressesAndPorts);
+  if (numPacketsRead < 0) {
+    if (DebugLevel >= 0) { // this is a fatal error
+      UsageEnvironment::MsgString msg = strDup(env().getResultMsg());
+      env().setResultMsg("Groupsock read failed: ", msg);
+      delete[] (char*)msg;
+    }
+    return -1;
+  }
+
+  for (int i = 0; i < numPacketsRead; ++i) {
+    // If we're a SSM group, make sure the source address matches:
+    if (isSSM() && !(fromAddressesAndPorts[i] == sourceFilterAddress())) {
+      bytesRead[i] = 0;
+      continue;
+    }
+
+    if (!wasLoopedBackFromUs(env(), fromAddressesAndPorts[i])) {
+      statsIncoming.countPacket(bytesRead[i]);
+      statsGroupIncoming.countPacket(bytesRead[i]);
+    }
+  }
+  if (DebugLevel >= 3) {
+    env() << *this << ": read " << numPacketsRead << " packets at once\n";
+  }
+
+  return numPacketsRead;
+}
+
 Boolean Groupsock::wasLoopedBackFromUs(UsageEnvironment& env,
 				       struct sockaddr_storage const& fromAddressAndPort) {
   if (fromAddressAndPort.ss_family != AF_INET) return False; // later update for IPv6
@@ -70,12 +70,23 @@ NoReuse::~NoReuse() {
   reclaimGroupsockPriv(fEnv);
 }
 
+ReusePort::ReusePort(UsageEnvironment& env)
+  : fEnv(env) {
+  groupsockPriv(fEnv)->reusePortForTCPFlag = 1;
+}
+
+ReusePort::~ReusePort() {
+  groupsockPriv(fEnv)->reusePortForTCPFlag = 0;
+  reclaimGroupsockPriv(fEnv);
+}
+
 
 _groupsockPriv* groupsockPriv(UsageEnvironment& env) {
   if (env.groupsockPriv == NULL) { // We need to create it
     _groupsockPriv* result = new _groupsockPriv;
     result->socketTable = NULL;
     result->reuseFlag = 1; // default value => allow reuse of socket numbers
+    result->reusePortForTCPFlag = 0; // default value
     env.groupsockPriv = result;
   }
   return (_groupsockPriv*)(env.groupsockPriv);
@@ -83,7 +94,8 @@ _groupsockPriv* groupsockPriv(UsageEnvironment& env) {
 
 void reclaimGroupsockPriv(UsageEnvironment& env) {
   _groupsockPriv* priv = (_groupsockPriv*)(env.groupsockPriv);
-  if (priv->socketTable == NULL && priv->reuseFlag == 1/*default value*/) {
+  if (priv->socketTable == NULL && priv->reuseFlag == 1/*default value*/
+      && priv->reusePortForTCPFlag == 0/*default value*/) {
     // We can delete the structure (to save space); it will get created again, if needed:
     delete priv;
     env.groupsockPriv = NULL;
@@ -327,6 +339,7 @@ int setupStreamSocket(UsageEnvironment& env, Port port, int domain,
 #endif
 
   int reuseFlag = groupsockPriv(env)->reuseFlag;
+  int reusePortForTCPFlag = groupsockPriv(env)->reusePortForTCPFlag;
   reclaimGroupsockPriv(env);
   if (setsockopt(newSocket, SOL_SOCKET, SO_REUSEADDR,
 		 (const char*)&reuseFlag, sizeof reuseFlag) < 0) {
@@ -338,20 +351,24 @@ int setupStreamSocket(UsageEnvironment& env, Port port, int domain,
   // SO_REUSEPORT doesn't really make sense for TCP sockets, so we
   // normally don't set them.  However, if you really want to do this
   // #define REUSE_FOR_TCP
+  // (or, for individual sockets, use a "ReusePort" object - e.g., to share a server port between threads).
 #ifdef REUSE_FOR_TCP
+  reusePortForTCPFlag = reuseFlag;
+#endif
+  if (reusePortForTCPFlag) {
 #if defined(__WIN32__) || defined(_WIN32)
-  // Windoze doesn't properly handle SO_REUSEPORT
+    // Windoze doesn't properly handle SO_REUSEPORT
 #else
 #ifdef SO_REUSEPORT
-  if (setsockopt(newSocket, SOL_SOCKET, SO_REUSEPORT,
-		 (const char*)&reuseFlag, sizeof reuseFlag) < 0) {
-    socketErr(env, "setsockopt(SO_REUSEPORT) error: ");
-    closeSocket(newSocket);
-    return -1;
-  }
-#endif
+    if (setsockopt(newSocket, SOL_SOCKET, SO_REUSEPORT,
+		   (const char*)&reusePortForTCPFlag, sizeof reusePortForTCPFlag) < 0) {
+      socketErr(env, "setsockopt(SO_REUSEPORT) error: ");
+      closeSocket(newSocket);
+      return -1;
+    }
 #endif
 #endif
+  }
 
   if (domain == AF_INET) {
     // Note: Windoze requires binding, even if the port number is 0
@@ -445,11 +462,68 @@ int readSocket(UsageEnvironment& env,
   return bytesRead;
 }
 
+#if defined(__linux__) && !defined(NO_RECVMMSG)
+#define MAX_DATAGRAMS_PER_BATCHED_READ 64
+#endif
+
+int readSocketBatch(UsageEnvironment& env,
+		    int socket, unsigned numBuffers,
+		    unsigned char* const* buffers, unsigned const* bufferSizes,
+		    unsigned* bytesRead, struct sockaddr_storage* fromAddresses) {
+  if (numBuffers == 0) return 0;
+#ifdef MAX_DATAGRAMS_PER_BATCHED_READ
+  if (numBuffers > MAX_DATAGRAMS_PER_BATCHED_READ) numBuffers = MAX_DATAGRAMS_PER_BATCHED_READ;
+
+  struct mmsghdr messages[MAX_DATAGRAMS_PER_BATCHED_READ];
+  struct iovec iovecs[MAX_DATAGRAMS_PER_BATCHED_READ];
+  memset(messages, 0, numBuffers*sizeof messages[0]);
+  for (unsigned i = 0; i < numBuffers; ++i) {
+    iovecs[i].iov_base = buffers[i];
+    iovecs[i].iov_len = bufferSizes[i];
+    messages[i].msg_hdr.msg_name = &fromAddresses[i];
+    messages[i].msg_hdr.msg_namelen = sizeof fromAddresses[i];
+    messages[i].msg_hdr.msg_iov = &iovecs[i];
+    messages[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  int numRead = recvmmsg(socket, messages, numBuffers, MSG_DONTWAIT, NULL);
+  if (numRead < 0) {
+    // As in "readSocket()", treat some errors as if no data had been read:
+    int err = env.getErrno();
+    if (err == EAGAIN || err == EWOULDBLOCK
+	|| err == 111 /*ECONNREFUSED (Linux)*/ || err == 113 /*EHOSTUNREACH (Linux)*/) {
+      return 0;
+    }
+    socketErr(env, "recvmmsg() error: ");
+    return -1;
+  }
+
+  for (int i = 0; i < numRead; ++i) bytesRead[i] = messages[i].msg_len;
+  return numRead;
+#else
+  int numBytesRead = readSocket(env, socket, buffers[0], bufferSizes[0], fromAddresses[0]);
+  if (numBytesRead < 0) return -1;
+  if (numBytesRead == 0) return 0;
+
+  bytesRead[0] = (unsigned)numBytesRead;
+  return 1;
+#endif
+}
+
 Boolean writeSocket(UsageEnvironment& env,
 		    int socket, struct sockaddr_storage const& addressAndPort,
 		    u_int8_t ttlArg,
 		    unsigned char* buffer, unsigned bufferSize) {
-  // Before sending, set the socket's TTL (IPv4 only):
+  // Before sending, set the socket's TTL:
+  if (!setSocketTTL(env, socket, addressAndPort, ttlArg)) return False;
+  
+  return writeSocket(env, socket, addressAndPort, buffer, bufferSize);
+}
+
+Boolean setSocketTTL(UsageEnvironment& env,
+		     int socket, struct sockaddr_storage const& addressAndPort,
+		     u_int8_t ttlArg) {
+  // (IPv4 only)
   if (addressAndPort.ss_family == AF_INET) {
 #if defined(__WIN32__) || defined(_WIN32)
 #define TTL_TYPE int
@@ -463,8 +537,8 @@ Boolean writeSocket(UsageEnvironment& env,
       return False;
     }
   }
-  
-  return writeSocket(env, socket, addressAndPort, buffer, bufferSize);
+
+  return True;
 }
 
 Boolean writeSocket(UsageEnvironment& env,
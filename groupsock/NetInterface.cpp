@@ -129,3 +129,15 @@ void NetInterfaceTrafficStats::countPacket(unsigned packetSize) {
 Boolean NetInterfaceTrafficStats::haveSeenTraffic() const {
   return fTotNumPackets != 0.0;
 }
+
+
+////////// NetInterfaceBatchStats //////////
+
+NetInterfaceBatchStats::NetInterfaceBatchStats() {
+  fTotNumDatagrams = fTotNumSystemCalls = 0.0;
+}
+
+void NetInterfaceBatchStats::countBatch(unsigned numDatagrams, unsigned numSystemCalls) {
+  fTotNumDatagrams += numDatagrams;
+  fTotNumSystemCalls += numSystemCalls;
+}
@@ -49,6 +49,10 @@ protected:
 
   portNumBits sourcePortNum() const {return fSourcePort.num();}
 
+  // Used by subclasses that send without using "write()":
+  Boolean prepareToWrite(struct sockaddr_storage const& addressAndPort, u_int8_t ttl);
+  Boolean noteWriteDone(struct sockaddr_storage const& addressAndPort);
+
 private: // redefined virtual function
   virtual Boolean handleRead(unsigned char* buffer, unsigned bufferMaxSize,
 			     unsigned& bytesRead,
@@ -59,6 +63,8 @@ private:
   unsigned fLastSentTTL;
 };
 
+class BatchedOutputQueue; // defined and used only in "Groupsock.cpp"
+
 class destRecord {
 public:
   destRecord(struct sockaddr_storage const& addr, Port const& port, u_int8_t ttl, unsigned sessionId,
@@ -128,14 +134,32 @@ public:
 
   virtual Boolean output(UsageEnvironment& env, unsigned char* buffer, unsigned bufferSize);
 
+  // Batched output: While this is enabled, "output()" merely copies each packet into a queue; the queued packets
+  // are then sent - to every destination - by "flushBatchedOutput()", using as few system calls as possible
+  // ("sendmmsg()" and, where the kernel supports it, UDP generic segmentation offload ("UDP_SEGMENT")).
+  // Whoever enables batched output must call "flushBatchedOutput()" (or disable batched output) before returning to
+  // the event loop.
+  // (The queue is also flushed automatically whenever it fills up, or the set of destinations changes.)
+  // Batched output is currently implemented only for Linux; elsewhere, "setBatchedOutput()" has no effect.
+  void setBatchedOutput(Boolean batchedOutput);
+  Boolean batchedOutput() const { return fBatchedOutput; }
+  Boolean flushBatchedOutput(UsageEnvironment& env);
+
   static NetInterfaceTrafficStats statsIncoming;
   static NetInterfaceTrafficStats statsOutgoing;
+  static NetInterfaceBatchStats statsBatchedOutgoing;
   NetInterfaceTrafficStats statsGroupIncoming; // *not* static
   NetInterfaceTrafficStats statsGroupOutgoing; // *not* static
+  NetInterfaceBatchStats statsGroupBatchedOutgoing; // *not* static
 
   Boolean wasLoopedBackFromUs(UsageEnvironment& env,
 			      struct sockaddr_storage const& fromAddressAndPort);
 
+  int handleReadBatch(unsigned numBuffers, unsigned char* const* buffers, unsigned const* bufferMaxSizes,
+		      unsigned* bytesRead, struct sockaddr_storage* fromAddressesAndPorts);
+      // Like "handleRead()", but reads up to "numBuffers" waiting packets at once (see "readSocketBatch()").
+      // Returns the number of packets read, or -1 on error.  (A packet that we should ignore gets "bytesRead" 0.)
+
 public: // redefined virtual functions
   virtual Boolean handleRead(unsigned char* buffer, unsigned bufferMaxSize,
 			     unsigned& bytesRead,
@@ -147,10 +171,13 @@ protected:
 private:
   void removeDestinationFrom(destRecord*& dests, unsigned sessionId);
     // used to implement (the public) "removeDestination()", and "changeDestinationParameters()"
+  Boolean sendBatchedOutputTo(UsageEnvironment& env, destRecord* dest, unsigned& numSystemCalls);
 protected:
   destRecord* fDests;
 private:
   GroupEId fIncomingGroupEId;
+  Boolean fBatchedOutput;
+  BatchedOutputQueue* fBatchedOutputQueue;
 };
 
 UsageEnvironment& operator<<(UsageEnvironment& s, const Groupsock& g);
@@ -37,6 +37,14 @@ int readSocket(UsageEnvironment& env,
 	       int socket, unsigned char* buffer, unsigned bufferSize,
 	       struct sockaddr_storage& fromAddress /*set only if we're a datagram socket*/);
 
+int readSocketBatch(UsageEnvironment& env,
+		    int socket, unsigned numBuffers,
+		    unsigned char* const* buffers, unsigned const* bufferSizes,
+		    unsigned* bytesRead, struct sockaddr_storage* fromAddresses);
+    // Reads up to "numBuffers" datagrams - without blocking - using a single "recvmmsg()" system call (where
+    // available; otherwise, reads just one datagram).
+    // Returns the number of datagrams read (0 if none were waiting), or -1 on error.
+
 Boolean writeSocket(UsageEnvironment& env,
 		    int socket, struct sockaddr_storage const& addressAndPort,
 		    u_int8_t ttlArg,
@@ -47,6 +55,11 @@ Boolean writeSocket(UsageEnvironment& env,
 		    unsigned char* buffer, unsigned bufferSize);
     // An optimized version of "writeSocket" that omits the "setsockopt()" call to set the TTL.
 
+Boolean setSocketTTL(UsageEnvironment& env,
+		     int socket, struct sockaddr_storage const& addressAndPort,
+		     u_int8_t ttlArg);
+    // Sets the (multicast) TTL that "socket" uses when sending to "addressAndPort"
+
 void ignoreSigPipeOnSocket(int socketNum);
 
 unsigned getSendBufferSize(UsageEnvironment& env, int socket);
@@ -143,12 +156,29 @@ private:
   UsageEnvironment& fEnv;
 };
 
+// Conversely, TCP (stream) sockets are normally created *without* the SO_REUSEPORT flag.
+// If you want several server sockets - e.g., each used by a separate thread, with its own
+// "UsageEnvironment" - to accept() connections on the same port, then enclose their creation code with:
+//          {
+//            ReusePort dummy(env);
+//            ...
+//          }
+class ReusePort {
+public:
+  ReusePort(UsageEnvironment& env);
+  ~ReusePort();
+
+private:
+  UsageEnvironment& fEnv;
+};
+
 
 // Define the "UsageEnvironment"-specific "groupsockPriv" structure:
 
 struct _groupsockPriv { // There should be only one of these allocated
   HashTable* socketTable;
   int reuseFlag;
+  int reusePortForTCPFlag;
 };
 _groupsockPriv* groupsockPriv(UsageEnvironment& env); // allocates it if necessary
 void reclaimGroupsockPriv(UsageEnvironment& env);
@@ -106,4 +106,21 @@ private:
   float fTotNumBytes;
 };
 
+// Statistics for sends that were done in batches (using a single system call to send several datagrams):
+class NetInterfaceBatchStats {
+public:
+  NetInterfaceBatchStats();
+
+  void countBatch(unsigned numDatagrams, unsigned numSystemCalls);
+
+  float totNumDatagrams() const {return fTotNumDatagrams;}
+  float totNumSystemCalls() const {return fTotNumSystemCalls;}
+  float totNumSystemCallsSaved() const {return fTotNumDatagrams - fTotNumSystemCalls;}
+      // compared to sending each datagram with its own "sendto()"
+
+private:
+  float fTotNumDatagrams;
+  float fTotNumSystemCalls;
+};
+
 #endif
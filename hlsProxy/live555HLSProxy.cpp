@@ -16,10 +16,13 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 // Copyright (c) 1996-2026, Live Networks, Inc.  All rights reserved
 // A program that acts as a proxy for a RTSP stream, converting it into a sequence of
 // HLS (HTTP Live Streaming) segments, plus a ".m3u8" file that can be accessed via a web browser.
+// (Alternatively, the segments are kept in memory, and served - along with the ".m3u8" playlist - by a
+// built-in HTTP server.)
 // main program
 
 #include "liveMedia.hh"
 #include "BasicUsageEnvironment.hh"
+#include "GroupsockHelper.hh" // for "ourIPv4Address()"
 
 #define RTSP_CLIENT_VERBOSITY_LEVEL 0 // set to 1 for more verbose output from the "RTSPClient"
 #define OUR_HLS_SEGMENTATION_DURATION 6 /*seconds*/
@@ -45,10 +48,14 @@ HandlerServerForREGISTERCommand* handlerServerForREGISTERCommand;
 char* usernameForREGISTER = NULL;
 char* passwordForREGISTER = NULL;
 UserAuthenticationDatabase* authDBForREGISTER = NULL;
+portNumBits hlsHTTPServerPortNum = 0; // if non-zero, we serve the segments from memory, using a built-in HTTP server
+HLSSegmentStore* hlsSegmentStore = NULL;
+RTSPServer* hlsHTTPServer = NULL;
 
 void usage() {
-  *env << "usage:\t" << programName << " [-u <username> <password>] [-t|-T <http-port>] <input-RTSP-url> <HLS-prefix>\n";
-  *env << "   or:\t" << programName << " -R [<port-num>] [-U <username-for-REGISTER> <password-for-REGISTER>] <HLS-prefix>\n";
+  *env << "usage:\t" << programName << " [-u <username> <password>] [-t|-T <http-port>] [-H <hls-http-port>] <input-RTSP-url> <HLS-prefix>\n";
+  *env << "   or:\t" << programName << " -R [<port-num>] [-U <username-for-REGISTER> <password-for-REGISTER>] [-H <hls-http-port>] <HLS-prefix>\n";
+  *env << "\t(With -H, the segments are kept in memory, and served - along with \"<HLS-prefix>.m3u8\" - over HTTP on <hls-http-port>.)\n";
   exit(1);
 }
 
@@ -118,6 +125,18 @@ int main(int argc, char** argv) {
 	break;
       }
 
+      case 'H': { // serve the HLS stream (from memory) using our own HTTP server, on the specified port
+	if (argc > 3 && argv[2][0] != '-'
+	    && sscanf(argv[2], "%hu", &hlsHTTPServerPortNum) == 1 && hlsHTTPServerPortNum > 0) {
+	  ++argv; --argc;
+	  break;
+	}
+
+	// If we get here, the option was specified incorrectly:
+	usage();
+	break;
+      }
+
       case 'U': { // specify a username and password to be used to authentication an incoming "REGISTER" command (for use with -R)
 	if (argc < 4) usage(); // there's no argv[3] (for the "password")
 	usernameForREGISTER = argv[2];	
@@ -139,6 +158,18 @@ int main(int argc, char** argv) {
     ++argv; --argc;
   }
 	  
+  if (hlsHTTPServerPortNum != 0) {
+    // Create a store for our segments, and a server that serves them over HTTP.  (The server is a "RTSPServer" -
+    // with no streams of its own - that serves the store's contents on its HTTP port.)
+    hlsSegmentStore = HLSSegmentStore::createNew(*env, OUR_HLS_REWIND_DURATION);
+    hlsHTTPServer = RTSPServer::createNew(*env, 0/*choose any RTSP port*/);
+    if (hlsHTTPServer == NULL || !hlsHTTPServer->setUpTunnelingOverHTTP(hlsHTTPServerPortNum)) {
+      *env << "Failed to create a HTTP server on port " << hlsHTTPServerPortNum << ": " << env->getResultMsg() << "\n";
+      exit(1);
+    }
+    hlsHTTPServer->setHLSSegmentStore(hlsSegmentStore);
+  }
+
   // Create (or arrange to create) our RTSP client object:
   if (createHandlerServerForREGISTERCommand) {
     if (argc != 2) usage();
@@ -380,8 +411,9 @@ void startPlayingSession(RTSPClient* rtspClient) {
   // (This will prepare the data sink to receive data; the actual flow of data from the client won't start happening until later,
   // after we've sent a RTSP "PLAY" command.)
 
-  MediaSink* sink
-    = HLSSegmenter::createNew(*env, OUR_HLS_SEGMENTATION_DURATION, hlsPrefix, segmentationCallback);
+  MediaSink* sink = hlsSegmentStore != NULL
+    ? HLSSegmenter::createNew(*env, OUR_HLS_SEGMENTATION_DURATION, *hlsSegmentStore, hlsPrefix, segmentationCallback)
+    : HLSSegmenter::createNew(*env, OUR_HLS_SEGMENTATION_DURATION, hlsPrefix, segmentationCallback);
 
   // Start playing the sink object:
   *env << "Beginning to read...\n";
@@ -425,6 +457,19 @@ char* ourM3U8FileName = NULL;
 
 void segmentationCallback(void* /*clientData*/,
 			  char const* segmentFileName, double segmentDuration) {
+  if (hlsSegmentStore != NULL) {
+    // Our segment store keeps track of the segments (and generates the playlist) itself:
+    fprintf(stderr, "Stored segment \"%s\" (duration: %f seconds)\n", segmentFileName, segmentDuration);
+
+    static Boolean isFirstTime = True;
+    if (isFirstTime) {
+      fprintf(stderr, "The stream can now be played from the URL \"http://%s:%u/%s.m3u8\".\007\n",
+	      AddressString(ourIPv4Address(*env)).val(), hlsHTTPServer->httpServerPortNum(), hlsPrefix);
+      isFirstTime = False;
+    }
+    return;
+  }
+
   // Begin by updating our list of segments:
   SegmentRecord* newSegment = new SegmentRecord(segmentFileName, segmentDuration);
   if (tail != NULL) {
@@ -82,10 +82,13 @@ void Authenticator::setRealmAndRandomNonce(char const* realm) {
   struct {
     struct timeval timestamp;
     unsigned counter;
+    void const* threadTag; // distinguishes threads that might compute a nonce at the same time
   } seedData;
+  memset(&seedData, 0, sizeof seedData); // including any padding, which gets hashed too
   gettimeofday(&seedData.timestamp, NULL);
-  static unsigned counter = 0;
+  static thread_local unsigned counter = 0;
   seedData.counter = ++counter;
+  seedData.threadTag = &counter;
 
   // Use MD5 to compute a 'random' nonce from this seed data:
   char nonceBuf[33];
@@ -23,6 +23,7 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include <fcntl.h>
 #endif
 #include "FileSink.hh"
+#include "StreamReplicator.hh"
 #include "GroupsockHelper.hh"
 #include "OutputFile.hh"
 
@@ -30,7 +31,8 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 FileSink::FileSink(UsageEnvironment& env, FILE* fid, unsigned bufferSize,
 		   char const* perFrameFileNamePrefix)
-  : MediaSink(env), fOutFid(fid), fBufferSize(bufferSize), fSamePresentationTimeCounter(0) {
+  : MediaSink(env), fOutFid(fid), fBufferSize(bufferSize), fSamePresentationTimeCounter(0),
+    fReplicator(NULL) {
   fBuffer = new unsigned char[bufferSize];
   if (perFrameFileNamePrefix != NULL) {
     fPerFrameFileNamePrefix = strDup(perFrameFileNamePrefix);
@@ -74,6 +76,14 @@ FileSink* FileSink::createNew(UsageEnvironment& env, char const* fileName,
 Boolean FileSink::continuePlaying() {
   if (fSource == NULL) return False;
 
+  if (fReplicator != NULL) {
+    // Our source delivers frame views, so it doesn't need a buffer:
+    fSource->getNextFrame(NULL, 0,
+			  afterGettingFrame, this,
+			  onSourceClosure, this);
+    return True;
+  }
+
   fSource->getNextFrame(fBuffer, fBufferSize,
 			afterGettingFrame, this,
 			onSourceClosure, this);
@@ -127,13 +137,20 @@ void FileSink::addData(unsigned char const* data, unsigned dataSize,
 void FileSink::afterGettingFrame(unsigned frameSize,
 				 unsigned numTruncatedBytes,
 				 struct timeval presentationTime) {
-  if (numTruncatedBytes > 0) {
+  if (fReplicator != NULL) {
+    StreamReplicatorFrame* frame = fReplicator->takeDeliveredFrame(fSource);
+    if (frame != NULL) {
+      addData(frame->data(), frame->frameSize(), presentationTime);
+      frame->decrementReferenceCount();
+    }
+    // (Any truncation happened in the replicator's shared frame, whose size we don't control.)
+  } else if (numTruncatedBytes > 0) {
     envir() << "FileSink::afterGettingFrame(): The input frame data was too large for our buffer size ("
 	    << fBufferSize << ").  "
             << numTruncatedBytes << " bytes of trailing data was dropped!  Correct this by increasing the \"bufferSize\" parameter in the \"createNew()\" call to at least "
             << fBufferSize + numTruncatedBytes << "\n";
   }
-  addData(fBuffer, frameSize, presentationTime);
+  if (fReplicator == NULL) addData(fBuffer, frameSize, presentationTime);
 
   if (fOutFid == NULL || fflush(fOutFid) == EOF) {
     // The output file has closed.  Handle this the same way as if the input source had closed:
@@ -75,6 +75,7 @@ void GenericMediaServer
 void GenericMediaServer::removeServerMediaSession(ServerMediaSession* serverMediaSession) {
   if (serverMediaSession == NULL) return;
   
+  noteServerMediaSessionRemoval(serverMediaSession);
   fServerMediaSessions->Remove(serverMediaSession->streamName());
   if (serverMediaSession->referenceCount() == 0) {
     Medium::close(serverMediaSession);
@@ -83,6 +84,10 @@ void GenericMediaServer::removeServerMediaSession(ServerMediaSession* serverMedi
   }
 }
 
+void GenericMediaServer::noteServerMediaSessionRemoval(ServerMediaSession* /*serverMediaSession*/) {
+  // default implementation: do nothing
+}
+
 void GenericMediaServer::removeServerMediaSession(char const* streamName) {
   lookupServerMediaSession(streamName, &GenericMediaServer::removeServerMediaSession);
 }
@@ -259,7 +264,12 @@ void GenericMediaServer
 
 ////////// GenericMediaServer::ClientConnection implementation //////////
 
+#ifndef NO_STD_LIB
+static std::atomic<u_int32_t> lastClientConnectionId(0); // identifies each connection (can wrap around)
+    // (atomic, because servers in separate threads - e.g., in a "RTSPServerWorkerGroup" - share it)
+#else
 static u_int32_t lastClientConnectionId = 0; // identifies each connection (can wrap around)
+#endif
 
 GenericMediaServer::ClientConnection
 ::ClientConnection(GenericMediaServer& ourServer,
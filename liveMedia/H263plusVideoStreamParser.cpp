@@ -37,7 +37,6 @@ H263plusVideoStreamParser::H263plusVideoStreamParser(
                                 fnextTR(0),
                                 fcurrentPT(0)
 {
-   memset(fStates, 0, sizeof(fStates));
    memset(&fNextInfo, 0, sizeof(fNextInfo));
    memset(&fCurrentInfo, 0, sizeof(fCurrentInfo));
    memset(&fMaxBitrateCtx, 0, sizeof(fMaxBitrateCtx));
@@ -165,7 +164,6 @@ unsigned H263plusVideoStreamParser::parse(u_int64_t & currentDuration)
 ///////////////////////////////////////////////////////////////////////////////
 int H263plusVideoStreamParser::parseH263Frame( )
 {
-   char     row = 0;
    u_int8_t * bufferIndex = fTo;
    // The buffer end which will allow the loop to leave place for
    // the additionalBytesNeeded
@@ -175,32 +173,25 @@ int H263plusVideoStreamParser::parseH263Frame( )
    bufferIndex += H263_REQUIRE_HEADER_SIZE_BYTES;
 
 
-   // The state table and the following loop implements a state machine enabling
-   // us to read bytes from the file until (and inclusing) the requested
-   // start code (00 00 8X) is found
+   // Read data from file into the output buffer until (and including) the
+   // next start code (00 00 8X), or until the end of file has been reached.
+   u_int8_t const* ptr;
+   unsigned numBytes;
+   Boolean foundStartCode;
+   do {
+      foundStartCode = findStartCode(ptr, numBytes, 0xFC, 0x80);
+      if (foundStartCode) numBytes += H263_STARTCODE_SIZE_BYTES;
 
-   // Initialize the states array, if it hasn't been initialized yet...
-   if (!fStates[0][0]) {
-      // One 00 was read
-      fStates[0][0] = 1;
-      // Two sequential 0x00 ware read
-      fStates[1][0] = fStates[2][0] = 2;
-      // A full start code was read
-      fStates[2][128] = fStates[2][129] = fStates[2][130] = fStates[2][131] = -1;
-   }
+      if (numBytes > (unsigned)(bufferEnd - bufferIndex)) {
+         fprintf(stderr, "%s: Buffer too small (%ld)\n",
+            "h263reader:", bufferEnd - fTo + ADDITIONAL_BYTES_NEEDED);
+         return 0;
+      }
+      getBytes(bufferIndex, numBytes);
+      bufferIndex += numBytes;
 
-   // Read data from file into the output buffer until either a start code
-   // is found, or the end of file has been reached.
-   do {
-      *bufferIndex = get1Byte();
-   } while ((bufferIndex < bufferEnd) &&                    // We have place in the buffer
-            ((row = fStates[(unsigned char)row][*(bufferIndex++)]) != -1)); // Start code was not found
-
-   if (row != -1) {
-      fprintf(stderr, "%s: Buffer too small (%ld)\n",
-         "h263reader:", bufferEnd - fTo + ADDITIONAL_BYTES_NEEDED);
-      return 0;
-   }
+      if (!foundStartCode) (void)test4Bytes(); // fewer than 4 bytes now remain, so this causes more data to be read
+   } while (!foundStartCode);
 
    // Cool ... now we have a start code
    // Now we just have to read the additionalBytesNeeded
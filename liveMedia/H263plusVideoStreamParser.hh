@@ -116,7 +116,6 @@ private:
    H263INFO       fNextInfo;       // Holds information about the next frame
    H263INFO       fCurrentInfo;    // Holds information about the current frame
    MaxBitrate_CTX fMaxBitrateCtx;  // Context for the GetMaxBitrate function
-   char           fStates[3][256];
    u_int8_t       fNextHeader[H263_REQUIRE_HEADER_SIZE_BYTES];
 
   u_int32_t fnextTR;   // The next frame's presentation time in TR units
@@ -128,10 +128,23 @@ Boolean H264or5VideoRTPSink::continuePlaying() {
 }
 
 void H264or5VideoRTPSink::doSpecialFrameHandling(unsigned /*fragmentationOffset*/,
-						 unsigned char* /*frameStart*/,
-						 unsigned /*numBytesInFrame*/,
+						 unsigned char* frameStart,
+						 unsigned numBytesInFrame,
 						 struct timeval framePresentationTime,
 						 unsigned /*numRemainingBytes*/) {
+  // Note whether this packet contains (all or part of) a parameter set or key frame NAL unit,
+  // so that - when streaming over TCP to a slow receiver - it's among the last to be dropped.
+  // (For a fragment, "frameStart" points to the FU indicator, and the NAL unit type is in the FU header.)
+  if (numBytesInFrame >= (fHNumber == 264 ? 2 : 3)) {
+    u_int8_t nal_unit_type = H264or5NALUnitType(fHNumber, frameStart[0]);
+    if (fHNumber == 264 && nal_unit_type == 28/*FU-A*/) {
+      nal_unit_type = frameStart[1]&0x1F;
+    } else if (fHNumber == 265 && nal_unit_type == 49/*FU*/) {
+      nal_unit_type = frameStart[2]&0x3F;
+    }
+    if (isH264or5KeyNALUnit(fHNumber, nal_unit_type)) setKeyDataInPacket();
+  }
+
   // Set the RTP 'M' (marker) bit iff
   // 1/ The most recently delivered fragment was the end of (or the only fragment of) an NAL unit, and
   // 2/ This NAL unit was the last NAL unit of an 'access unit' (i.e. video frame).
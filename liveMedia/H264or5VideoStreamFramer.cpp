@@ -1051,27 +1051,26 @@ unsigned H264or5VideoStreamParser::parse() {
 	fFirstByteOfNALUnit = next4Bytes>>24;
 	fHaveSeenFirstByteOfNALUnit = True;
       }
-      while (next4Bytes != 0x00000001 && (next4Bytes&0xFFFFFF00) != 0x00000100) {
-	// We save at least some of "next4Bytes".
-	if ((unsigned)(next4Bytes&0xFF) > 1) {
-	  // Common case: 0x00000001 or 0x000001 definitely doesn't begin anywhere in "next4Bytes", so we save all of it:
-	  save4Bytes(next4Bytes);
-	  skipBytes(4);
-	} else {
-	  // Save the first byte, and continue testing the rest:
-	  saveByte(next4Bytes>>24);
-	  skipBytes(1);
-	}
+      // Look for the next 0x000001, within the data that we've already read.  Until we find it, we save
+      // (in bulk) everything except the last few bytes, and read more data:
+      unsigned char const* ptr;
+      unsigned numBytes;
+      while (!findStartCode(ptr, numBytes)) {
+	saveBytes(ptr, numBytes);
+	skipBytes(numBytes);
 	setParseState(); // ensures forward progress
-	next4Bytes = test4Bytes();
+	(void)test4Bytes(); // fewer than 4 bytes now remain, so this causes more data to be read
       }
-      // Assert: next4Bytes starts with 0x00000001 or 0x000001, and we've saved all previous bytes (forming a complete NAL unit).
-      // Skip over these remaining bytes, up until the start of the next NAL unit:
-      if (next4Bytes == 0x00000001) {
-	skipBytes(4);
-      } else {
-	skipBytes(3);
+      // "ptr[numBytes]" begins a 0x000001.  If it's preceded by a 0 byte, then it's part of a 0x00000001 instead:
+      unsigned startCodeSize = 3;
+      if (numBytes > 0 && ptr[numBytes-1] == 0) {
+	--numBytes;
+	startCodeSize = 4;
       }
+      // Save everything before the start code (forming a complete NAL unit), then skip over the start code,
+      // up until the start of the next NAL unit:
+      saveBytes(ptr, numBytes);
+      skipBytes(numBytes + startCodeSize);
     }
 
     fHaveSeenFirstByteOfNALUnit = False; // for the next NAL unit that we'll parse
@@ -1209,6 +1208,21 @@ unsigned H264or5VideoStreamParser::parse() {
   }
 }
 
+u_int8_t H264or5NALUnitType(int hNumber, u_int8_t firstNALUnitHeaderByte) {
+  return hNumber == 264 ? firstNALUnitHeaderByte&0x1F : (firstNALUnitHeaderByte&0x7E)>>1;
+}
+
+Boolean isH264or5ParameterSet(int hNumber, u_int8_t nal_unit_type) {
+  return hNumber == 264
+    ? (nal_unit_type == 7/*SPS*/ || nal_unit_type == 8/*PPS*/)
+    : (nal_unit_type >= 32 && nal_unit_type <= 34)/*VPS,SPS,PPS*/;
+}
+
+Boolean isH264or5KeyNALUnit(int hNumber, u_int8_t nal_unit_type) {
+  return isH264or5ParameterSet(hNumber, nal_unit_type)
+    || (hNumber == 264 ? nal_unit_type == 5/*IDR*/ : (nal_unit_type >= 16 && nal_unit_type <= 21)/*IRAP*/);
+}
+
 unsigned removeH264or5EmulationBytes(u_int8_t* to, unsigned toMaxSize,
                                      u_int8_t const* from, unsigned fromSize) {
   unsigned toSize = 0;
@@ -0,0 +1,175 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2026 Live Networks, Inc.  All rights reserved.
+// An in-memory store of HLS (Apple's "HTTP Live Streaming") segments - for one or more streams -
+// that a "RTSPServer" can serve directly over HTTP.
+// Implementation
+
+#include "HLSSegmentStore.hh"
+
+////////// HLSSegment implementation //////////
+
+HLSSegment::HLSSegment(char const* streamName, unsigned sequenceNumber,
+		       unsigned char* data, unsigned size, double duration)
+  : fNext(NULL), fSequenceNumber(sequenceNumber), fData(data), fSize(size), fDuration(duration),
+    fReferenceCount(1) { // the store's reference
+  // Name the segment the same way that "HLSSegmenter" names its segment files:
+  fName = new char[strlen(streamName) + 20/*more than enough*/];
+  sprintf(fName, "%s%03u.ts", streamName, sequenceNumber);
+}
+
+HLSSegment::~HLSSegment() {
+  delete[] fData;
+  delete[] fName;
+}
+
+void HLSSegment::decrementReferenceCount() {
+  if (fReferenceCount == 0) return; // should not happen
+  if (--fReferenceCount == 0) delete this;
+}
+
+
+////////// HLSSegmentStore::StreamState definition //////////
+
+class HLSSegmentStore::StreamState {
+public:
+  StreamState()
+    : fHead(NULL), fTail(NULL), fNumSegments(0), fTotalDuration(0.0),
+      fNextSequenceNumber(1), fTargetDuration(1) {
+  }
+
+  HLSSegment* fHead; // the oldest segment in our window
+  HLSSegment* fTail; // the newest segment in our window
+  unsigned fNumSegments;
+  double fTotalDuration;
+  unsigned fNextSequenceNumber;
+  unsigned fTargetDuration; // the longest (rounded) segment duration that we've seen.  (It never decreases.)
+};
+
+
+////////// HLSSegmentStore implementation //////////
+
+HLSSegmentStore* HLSSegmentStore::createNew(UsageEnvironment& env, unsigned windowDuration) {
+  return new HLSSegmentStore(env, windowDuration);
+}
+
+HLSSegmentStore::HLSSegmentStore(UsageEnvironment& env, unsigned windowDuration)
+  : Medium(env),
+    fWindowDuration(windowDuration),
+    fStreams(HashTable::create(STRING_HASH_KEYS)), fSegments(HashTable::create(STRING_HASH_KEYS)) {
+}
+
+HLSSegmentStore::~HLSSegmentStore() {
+  StreamState* stream;
+  while ((stream = (StreamState*)fStreams->RemoveNext()) != NULL) {
+    while (stream->fHead != NULL) removeOldestSegment(stream);
+    delete stream;
+  }
+  delete fStreams;
+  delete fSegments;
+}
+
+HLSSegment* HLSSegmentStore
+::addSegment(char const* streamName, unsigned char* data, unsigned size, double duration) {
+  StreamState* stream = (StreamState*)(fStreams->Lookup(streamName));
+  if (stream == NULL) {
+    stream = new StreamState;
+    fStreams->Add(streamName, stream);
+  }
+
+  HLSSegment* segment = new HLSSegment(streamName, stream->fNextSequenceNumber++, data, size, duration);
+  if (stream->fTail != NULL) {
+    stream->fTail->fNext = segment;
+  } else {
+    stream->fHead = segment;
+  }
+  stream->fTail = segment;
+  ++stream->fNumSegments;
+  stream->fTotalDuration += duration;
+  fSegments->Add(segment->name(), segment);
+
+  // The playlist's "#EXT-X-TARGETDURATION" must be at least each segment's (rounded) duration:
+  unsigned roundedDuration = (unsigned)(duration + 0.5);
+  if (roundedDuration > stream->fTargetDuration) stream->fTargetDuration = roundedDuration;
+
+  // Then remove segments from the start of the window (but never the newest one), until the window is short enough:
+  while (stream->fTotalDuration > fWindowDuration && stream->fHead != stream->fTail) {
+    removeOldestSegment(stream);
+  }
+
+  return segment;
+}
+
+void HLSSegmentStore::removeStream(char const* streamName) {
+  StreamState* stream = (StreamState*)(fStreams->Lookup(streamName));
+  if (stream == NULL) return;
+
+  fStreams->Remove(streamName);
+  while (stream->fHead != NULL) removeOldestSegment(stream);
+  delete stream;
+}
+
+char* HLSSegmentStore::generatePlaylist(char const* streamName) {
+  StreamState* stream = (StreamState*)(fStreams->Lookup(streamName));
+  if (stream == NULL || stream->fHead == NULL) return NULL;
+
+  // Figure out how much space we need:
+  unsigned const maxSegmentLineSize = 40 + strlen(streamName) + 20; // "#EXTINF" line + segment name line
+  unsigned const playlistMaxSize = 200 + stream->fNumSegments*maxSegmentLineSize;
+  char* playlist = new char[playlistMaxSize];
+
+  // Write the header:
+  char* ptr = playlist;
+  ptr += snprintf(ptr, playlistMaxSize,
+		  "#EXTM3U\n"
+		  "#EXT-X-VERSION:3\n"
+		  "#EXT-X-INDEPENDENT-SEGMENTS\n"
+		  "#EXT-X-TARGETDURATION:%u\n"
+		  "#EXT-X-MEDIA-SEQUENCE:%u\n",
+		  stream->fTargetDuration,
+		  stream->fHead->sequenceNumber());
+
+  // Then the list of segments:
+  for (HLSSegment* segment = stream->fHead; segment != NULL; segment = segment->fNext) {
+    ptr += snprintf(ptr, playlistMaxSize - (ptr - playlist),
+		    "#EXTINF:%f,\n"
+		    "%s\n",
+		    segment->duration(),
+		    segment->name());
+  }
+
+  return playlist;
+}
+
+HLSSegment* HLSSegmentStore::lookupSegment(char const* segmentName) {
+  HLSSegment* segment = (HLSSegment*)(fSegments->Lookup(segmentName));
+  if (segment != NULL) segment->incrementReferenceCount();
+
+  return segment;
+}
+
+void HLSSegmentStore::removeOldestSegment(StreamState* stream) {
+  HLSSegment* segment = stream->fHead;
+  stream->fHead = segment->fNext;
+  if (stream->fHead == NULL) stream->fTail = NULL;
+  segment->fNext = NULL;
+  --stream->fNumSegments;
+  stream->fTotalDuration -= segment->duration();
+
+  fSegments->Remove(segment->name());
+  segment->decrementReferenceCount(); // the store's reference
+}
@@ -16,7 +16,7 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 // "liveMedia"
 // Copyright (c) 1996-2026 Live Networks, Inc.  All rights reserved.
 // A media sink that takes - as input - a MPEG Transport Stream, and outputs a series
-// of MPEG Transport Stream files, each representing a segment of the input stream,
+// of MPEG Transport Stream files (or in-memory "HLSSegment"s), each representing a segment of the input stream,
 // suitable for HLS (Apple's "HTTP Live Streaming").
 // Implementation
 
@@ -31,17 +31,28 @@ HLSSegmenter* HLSSegmenter
 ::createNew(UsageEnvironment& env,
 	    unsigned segmentationDuration, char const* fileNamePrefix,
 	    onEndOfSegmentFunc* onEndOfSegmentFunc, void* onEndOfSegmentClientData) {
-  return new HLSSegmenter(env, segmentationDuration, fileNamePrefix,
+  return new HLSSegmenter(env, segmentationDuration, fileNamePrefix, NULL,
+			  onEndOfSegmentFunc, onEndOfSegmentClientData);
+}
+
+HLSSegmenter* HLSSegmenter
+::createNew(UsageEnvironment& env,
+	    unsigned segmentationDuration,
+	    HLSSegmentStore& segmentStore, char const* streamName,
+	    onEndOfSegmentFunc* onEndOfSegmentFunc, void* onEndOfSegmentClientData) {
+  return new HLSSegmenter(env, segmentationDuration, streamName, &segmentStore,
 			  onEndOfSegmentFunc, onEndOfSegmentClientData);
 }
 
 HLSSegmenter::HLSSegmenter(UsageEnvironment& env,
 			   unsigned segmentationDuration, char const* fileNamePrefix,
+			   HLSSegmentStore* segmentStore,
 			   onEndOfSegmentFunc* onEndOfSegmentFunc, void* onEndOfSegmentClientData)
   : MediaSink(env),
-    fSegmentationDuration(segmentationDuration), fFileNamePrefix(fileNamePrefix),
+    fSegmentationDuration(segmentationDuration), fFileNamePrefix(fileNamePrefix), fSegmentStore(segmentStore),
     fOnEndOfSegmentFunc(onEndOfSegmentFunc), fOnEndOfSegmentClientData(onEndOfSegmentClientData),
-    fHaveConfiguredUpstreamSource(False), fCurrentSegmentCounter(1), fOutFid(NULL) {
+    fHaveConfiguredUpstreamSource(False), fCurrentSegmentCounter(1), fOutFid(NULL),
+    fSegmentData(NULL), fSegmentDataSize(0), fSegmentDataMaxSize(0) {
   // Allocate enough space for the segment file name:
   fOutputSegmentFileName = new char[strlen(fileNamePrefix) + 20/*more than enough*/];
 
@@ -49,6 +60,7 @@ HLSSegmenter::HLSSegmenter(UsageEnvironment& env,
   fOutputFileBuffer = new unsigned char[OUTPUT_FILE_BUFFER_SIZE];
 }
 HLSSegmenter::~HLSSegmenter() {
+  delete[] fSegmentData;
   delete[] fOutputFileBuffer;
   delete[] fOutputSegmentFileName;
 }
@@ -59,13 +71,28 @@ void HLSSegmenter::ourEndOfSegmentHandler(void* clientData, double segmentDurati
 
 void HLSSegmenter::ourEndOfSegmentHandler(double segmentDuration) {
   // Note the end of the current segment:
+  char const* segmentName = endCurrentSegment(segmentDuration);
   if (fOnEndOfSegmentFunc != NULL) {
-    (*fOnEndOfSegmentFunc)(fOnEndOfSegmentClientData, fOutputSegmentFileName, segmentDuration);
+    (*fOnEndOfSegmentFunc)(fOnEndOfSegmentClientData, segmentName, segmentDuration);
   }
 
   // Begin the next segment:
   ++fCurrentSegmentCounter;
-  openNextOutputSegment();
+  if (fSegmentStore == NULL) openNextOutputSegment();
+}
+
+char const* HLSSegmenter::endCurrentSegment(double segmentDuration) {
+  if (fSegmentStore == NULL) return fOutputSegmentFileName; // the file gets closed when we open the next one
+
+  // Hand the segment's data over to the store (which takes ownership of it):
+  HLSSegment* segment = fSegmentStore->addSegment(fFileNamePrefix, fSegmentData, fSegmentDataSize, segmentDuration);
+
+  // The next segment will probably be about the same size as this one, so start with a buffer that's a little bigger:
+  fSegmentDataMaxSize = fSegmentDataSize + fSegmentDataSize/8 + OUTPUT_FILE_BUFFER_SIZE;
+  fSegmentData = new unsigned char[fSegmentDataMaxSize];
+  fSegmentDataSize = 0;
+
+  return segment->name();
 }
 
 Boolean HLSSegmenter::openNextOutputSegment() {
@@ -89,8 +116,21 @@ void HLSSegmenter::afterGettingFrame(unsigned frameSize, unsigned numTruncatedBy
     fprintf(stderr, "HLSSegmenter::afterGettingFrame(frameSize %d, numTruncatedBytes %d)\n", frameSize, numTruncatedBytes);
   }
 
-  // Write the data to our output segment file:
-  fwrite(fOutputFileBuffer, 1, frameSize, fOutFid);
+  if (fSegmentStore != NULL) {
+    // Append the data to our current (in-memory) segment, first enlarging its buffer if necessary:
+    if (fSegmentDataSize + frameSize > fSegmentDataMaxSize) {
+      unsigned newMaxSize = 2*fSegmentDataMaxSize + frameSize;
+      unsigned char* newSegmentData = new unsigned char[newMaxSize];
+      memmove(newSegmentData, fSegmentData, fSegmentDataSize);
+      delete[] fSegmentData;
+      fSegmentData = newSegmentData; fSegmentDataMaxSize = newMaxSize;
+    }
+    memmove(&fSegmentData[fSegmentDataSize], fOutputFileBuffer, frameSize);
+    fSegmentDataSize += frameSize;
+  } else {
+    // Write the data to our output segment file:
+    fwrite(fOutputFileBuffer, 1, frameSize, fOutFid);
+  }
 
   // Then try getting the next frame:
   continuePlaying();
@@ -102,12 +142,15 @@ void HLSSegmenter::ourOnSourceClosure(void* clientData) {
 
 void HLSSegmenter::ourOnSourceClosure() {
   // Note the end of the final segment (currently being written):
-  if (fOnEndOfSegmentFunc != NULL) {
+  if (fSegmentStore != NULL ? fSegmentDataSize > 0 : fOnEndOfSegmentFunc != NULL) {
     // We know that the source is a "MPEG2TransportStreamMultiplexor":
     MPEG2TransportStreamMultiplexor* multiplexorSource = (MPEG2TransportStreamMultiplexor*)fSource;
     double segmentDuration = multiplexorSource->currentSegmentDuration();
 
-    (*fOnEndOfSegmentFunc)(fOnEndOfSegmentClientData, fOutputSegmentFileName, segmentDuration);
+    char const* segmentName = endCurrentSegment(segmentDuration);
+    if (fOnEndOfSegmentFunc != NULL) {
+      (*fOnEndOfSegmentFunc)(fOnEndOfSegmentClientData, segmentName, segmentDuration);
+    }
   }
 
   // Handle the closure for real:
@@ -131,7 +174,7 @@ Boolean HLSSegmenter::continuePlaying() {
 
     fHaveConfiguredUpstreamSource = True; // from now on
   }
-  if (fOutFid == NULL && !openNextOutputSegment()) return False;
+  if (fSegmentStore == NULL && fOutFid == NULL && !openNextOutputSegment()) return False;
 
   fSource->getNextFrame(fOutputFileBuffer, OUTPUT_FILE_BUFFER_SIZE,
 			afterGettingFrame, this,
@@ -108,7 +108,7 @@ Boolean MPEG2TransportStreamParser::parse() {
       } while (get1Byte() != TRANSPORT_SYNC_BYTE);
 
       // Parse and process each (remaining 187 bytes of a) 'Transport Stream Packet' at a time.
-      // (Because these are a lot smaller than the "StreamParser" BANK_SIZE, we don't save
+      // (Because these are a lot smaller than the "StreamParser" bank, we don't save
       //  parser state in the middle of processing each such 'Transport Stream Packet'.
       //  Therefore, processing of each 'Transport Stream Packet' needs to be idempotent.)
 
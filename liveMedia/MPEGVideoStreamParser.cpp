@@ -43,3 +43,40 @@ void MPEGVideoStreamParser::registerReadInterest(unsigned char* to,
   fLimit = to + maxSize;
   fNumTruncatedBytes = fSavedNumTruncatedBytes = 0;
 }
+
+void MPEGVideoStreamParser::toNextCode(u_int32_t& curWord, Boolean saveData) {
+  // On return, "curWord" will be the sync word (0x000001xx), and the parse position will be just after it.
+  if (saveData) saveByte(curWord>>24);
+  curWord = (curWord<<8)|get1Byte();
+  if ((curWord&0xFFFFFF00) == 0x00000100) return;
+
+  // A sync word might begin within the last 3 bytes of "curWord" (which we've already read).  Check these first:
+  unsigned numBytesToShift = 0;
+  if ((curWord&0x00FFFFFF) == 0x00000001) {
+    numBytesToShift = 1;
+  } else if ((curWord&0x0000FFFF) == 0 && test1Byte() == 0x01) {
+    numBytesToShift = 2;
+  } else if ((curWord&0x000000FF) == 0 && test2Bytes() == 0x0001) {
+    numBytesToShift = 3;
+  }
+  if (numBytesToShift > 0) {
+    while (numBytesToShift-- > 0) {
+      if (saveData) saveByte(curWord>>24);
+      curWord = (curWord<<8)|get1Byte();
+    }
+    return;
+  }
+
+  // Otherwise, the sync word lies completely within data that we haven't yet parsed, so search for it there:
+  if (saveData) save4Bytes(curWord);
+  unsigned char const* ptr;
+  unsigned numBytes;
+  while (!findStartCode(ptr, numBytes)) {
+    if (saveData) saveBytes(ptr, numBytes);
+    skipBytes(numBytes);
+    (void)test4Bytes(); // fewer than 4 bytes now remain, so this causes more data to be read
+  }
+  if (saveData) saveBytes(ptr, numBytes);
+  skipBytes(numBytes);
+  curWord = get4Bytes();
+}
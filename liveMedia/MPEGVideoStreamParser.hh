@@ -70,38 +70,23 @@ protected:
     *fTo++ = word>>24; *fTo++ = word>>16; *fTo++ = word>>8; *fTo++ = word;
   }
 
-  // Save data until we see a sync word (0x000001xx):
-  void saveToNextCode(u_int32_t& curWord) {
-    saveByte(curWord>>24);
-    curWord = (curWord<<8)|get1Byte();
-    while ((curWord&0xFFFFFF00) != 0x00000100) {
-      if ((unsigned)(curWord&0xFF) > 1) {
-	// a sync word definitely doesn't begin anywhere in "curWord"
-	save4Bytes(curWord);
-	curWord = get4Bytes();
-      } else {
-	// a sync word might begin in "curWord", although not at its start
-	saveByte(curWord>>24);
-	unsigned char newByte = get1Byte();
-	curWord = (curWord<<8)|newByte;
-      }
-    }
+  void saveBytes(unsigned char const* from, unsigned numBytes) {
+    unsigned numBytesToSave = fTo < fLimit ? (unsigned)(fLimit - fTo) : 0;
+    if (numBytesToSave > numBytes) numBytesToSave = numBytes;
+
+    memmove(fTo, from, numBytesToSave);
+    fTo += numBytesToSave;
+    fNumTruncatedBytes += numBytes - numBytesToSave; // if there wasn't enough space left
   }
 
+  // Save data until we see a sync word (0x000001xx):
+  void saveToNextCode(u_int32_t& curWord) { toNextCode(curWord, True); }
+
   // Skip data until we see a sync word (0x000001xx):
-  void skipToNextCode(u_int32_t& curWord) {
-    curWord = (curWord<<8)|get1Byte();
-    while ((curWord&0xFFFFFF00) != 0x00000100) {
-      if ((unsigned)(curWord&0xFF) > 1) {
-	// a sync word definitely doesn't begin anywhere in "curWord"
-	curWord = get4Bytes();
-      } else {
-	// a sync word might begin in "curWord", although not at its start
-	unsigned char newByte = get1Byte();
-	curWord = (curWord<<8)|newByte;
-      }
-    }
-  }
+  void skipToNextCode(u_int32_t& curWord) { toNextCode(curWord, False); }
+
+private:
+  void toNextCode(u_int32_t& curWord, Boolean saveData);
 
 protected:
   MPEGVideoStreamFramer* fUsingSource;
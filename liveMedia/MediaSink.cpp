@@ -114,12 +114,13 @@ unsigned OutPacketBuffer::maxSize = 2000000; // by default
 
 OutPacketBuffer
 ::OutPacketBuffer(unsigned preferredPacketSize, unsigned maxPacketSize, unsigned maxBufferSize)
-  : fPreferred(preferredPacketSize), fMax(maxPacketSize),
+  : fPreferred(preferredPacketSize), fMax(maxPacketSize), fTrailerSize(0),
     fOverflowDataSize(0) {
   if (maxBufferSize == 0) maxBufferSize = maxSize;
   unsigned maxNumPackets = (maxBufferSize + (maxPacketSize-1))/maxPacketSize;
   fLimit = maxNumPackets*maxPacketSize;
-  fBuf = new unsigned char[fLimit];
+  fBuf = new unsigned char[fLimit + OUT_PACKET_BUFFER_MAX_TRAILER_SIZE];
+      // Packet (and overflow) data never goes past "fLimit", so there's always room for a trailer
   resetPacketStart();
   resetOffset();
   resetOverflowData();
@@ -182,6 +183,13 @@ u_int32_t OutPacketBuffer::extractWord(unsigned fromPosition) {
   return ntohl(nWord);
 }
 
+Boolean OutPacketBuffer::setTrailerSize(unsigned trailerSize) {
+  if (trailerSize > OUT_PACKET_BUFFER_MAX_TRAILER_SIZE || trailerSize >= fMax) return False;
+
+  fTrailerSize = trailerSize;
+  return True;
+}
+
 void OutPacketBuffer::skipBytes(unsigned numBytes) {
   if (numBytes > totalBytesAvailable()) {
     numBytes = totalBytesAvailable();
@@ -52,11 +52,18 @@ MultiFramedRTPSink::MultiFramedRTPSink(UsageEnvironment& env,
   : RTPSink(env, rtpGS, rtpPayloadType, rtpTimestampFrequency,
 	    rtpPayloadFormatName, numChannels),
     fOutBuf(NULL), fCurFragmentationOffset(0), fPreviousFrameEndedFragmentation(False),
+    fCurPacketHasKeyData(False),
+    fIsSendingBurst(False), fSendNextPacketImmediately(False),
+    fSinkWasDeletedFlag(NULL), fBatchedOutputGroupsock(NULL),
     fOnSendErrorFunc(NULL), fOnSendErrorData(NULL) {
   setPacketSizes((RTP_PAYLOAD_PREFERRED_SIZE), (RTP_PAYLOAD_MAX_SIZE));
 }
 
 MultiFramedRTPSink::~MultiFramedRTPSink() {
+  // If we're being deleted in the middle of a burst (e.g., from within a send error handler), tell "sendBurst()":
+  if (fSinkWasDeletedFlag != NULL) *fSinkWasDeletedFlag = True;
+  endBatchedOutput();
+
   delete fOutBuf;
 }
 
@@ -154,13 +161,14 @@ void MultiFramedRTPSink::setFramePadding(unsigned numPaddingBytes) {
 }
 
 Boolean MultiFramedRTPSink::continuePlaying() {
-  // Send the first packet.
+  // Send the first packet(s).
   // (This will also schedule any future sends.)
-  buildAndSendPacket(True);
+  sendBurst(True);
   return True;
 }
 
 void MultiFramedRTPSink::stopPlaying() {
+  endBatchedOutput();
   fOutBuf->resetPacketStart();
   fOutBuf->resetOffset();
   fOutBuf->resetOverflowData();
@@ -173,6 +181,10 @@ void MultiFramedRTPSink::buildAndSendPacket(Boolean isFirstPacket) {
   nextTask() = NULL;
   fIsFirstPacket = isFirstPacket;
 
+  // Leave room at the end of the packet for any (SRTP) trailer.  (We do this for each packet, because SRTP
+  // might have been set up after we were created.)
+  fOutBuf->setTrailerSize(packetTrailerSize());
+
   // Set up the RTP header:
   unsigned rtpHdr = 0x80000000; // RTP version 2; marker ('M') bit not set (by default; it can be set later)
   rtpHdr |= (fRTPPayloadType<<16);
@@ -196,6 +208,7 @@ void MultiFramedRTPSink::buildAndSendPacket(Boolean isFirstPacket) {
   fTotalFrameSpecificHeaderSizes = 0;
   fNoFramesLeft = False;
   fNumFramesUsedSoFar = 0;
+  fCurPacketHasKeyData = False;
   packFrame();
 }
 
@@ -231,8 +244,20 @@ void MultiFramedRTPSink
 		    struct timeval presentationTime,
 		    unsigned durationInMicroseconds) {
   MultiFramedRTPSink* sink = (MultiFramedRTPSink*)clientData;
+  if (sink->fIsSendingBurst) {
+    sink->afterGettingFrame1(numBytesRead, numTruncatedBytes,
+			     presentationTime, durationInMicroseconds);
+    return;
+  }
+
+  // The frame was delivered asynchronously.  Handle it - and any packets that are due immediately after it -
+  // as a burst:
+  Boolean sinkWasDeleted = False;
+  sink->beginBurst(sinkWasDeleted);
   sink->afterGettingFrame1(numBytesRead, numTruncatedBytes,
 			   presentationTime, durationInMicroseconds);
+  if (sinkWasDeleted) return;
+  sink->finishBurst(sinkWasDeleted);
 }
 
 void MultiFramedRTPSink
@@ -362,7 +387,12 @@ Boolean MultiFramedRTPSink::isTooBigForAPacket(unsigned numBytes) const {
   return fOutBuf->isTooBigForAPacket(numBytes);
 }
 
-#define MAX_UDP_PACKET_SIZE 65536
+unsigned MultiFramedRTPSink::packetTrailerSize() const {
+#ifndef NO_OPENSSL
+  if (fCrypto != NULL) return SRTP_MKI_LENGTH + SRTP_AUTH_TAG_LENGTH;
+#endif
+  return 0;
+}
 
 void MultiFramedRTPSink::sendPacketIfNecessary() {
   if (fNumFramesUsedSoFar > 0) {
@@ -372,27 +402,35 @@ void MultiFramedRTPSink::sendPacketIfNecessary() {
 #endif
       if (fCrypto != NULL) { // Encrypt/tag the data before sending it:
 #ifndef NO_OPENSSL
-	// Hack: Because the MKI + authentication tag at the end of the packet would
-	// overwrite any following (still to be sent) frame data, we can't encrypt/tag
-	// the packet in place.  Instead, we have to make a copy (on the stack) of
-	// the packet, before encrypting/tagging/sending it:
-	if (fOutBuf->curPacketSize() + SRTP_MKI_LENGTH + SRTP_AUTH_TAG_LENGTH > MAX_UDP_PACKET_SIZE) {
-	  fprintf(stderr, "MultiFramedRTPSink::sendPacketIfNecessary(): Fatal error: packet size %d is too large for SRTP\n", fOutBuf->curPacketSize());
-	  exit(1);
-	}
-	u_int8_t packet[MAX_UDP_PACKET_SIZE];
-	memcpy(packet, fOutBuf->packet(), fOutBuf->curPacketSize());
-	unsigned newPacketSize;
-	
-	if (fCrypto->processOutgoingSRTPPacket(packet, fOutBuf->curPacketSize(), newPacketSize)) {
-	  if (!fRTPInterface.sendPacket(packet, newPacketSize)) {
+	// We encrypt/tag the packet in place.  The MKI + authentication tag get appended to it, in the
+	// room that "OutPacketBuffer::setTrailerSize()" reserved.  However, that room might also hold the start
+	// of (still to be sent) overflow frame data, so we save those bytes first, and restore them afterwards.
+	// (The packet itself isn't needed again once it's been sent.)
+	unsigned const trailerSize = packetTrailerSize();
+	if (fOutBuf->trailerSize() < trailerSize) {
+	  // This shouldn't happen (unless our max packet size is tiny); drop the packet rather than overrun the buffer:
+	  envir() << "MultiFramedRTPSink::sendPacketIfNecessary(): No room for the " << trailerSize
+		  << "-byte SRTP trailer; dropping a " << fOutBuf->curPacketSize() << "-byte packet\n";
+	} else {
+	  u_int8_t* packetEnd = fOutBuf->packet() + fOutBuf->curPacketSize();
+	  u_int8_t savedBytes[SRTP_MKI_LENGTH + SRTP_AUTH_TAG_LENGTH];
+	  memcpy(savedBytes, packetEnd, sizeof savedBytes);
+
+	  unsigned newPacketSize;
+	  Boolean sentOK = True;
+	  if (fCrypto->processOutgoingSRTPPacket(fOutBuf->packet(), fOutBuf->curPacketSize(), newPacketSize)) {
+	    sentOK = fRTPInterface.sendPacket(fOutBuf->packet(), newPacketSize, fCurPacketHasKeyData);
+	  }
+	  memcpy(packetEnd, savedBytes, sizeof savedBytes);
+
+	  if (!sentOK) {
 	    // if failure handler has been specified, call it
 	    if (fOnSendErrorFunc != NULL) (*fOnSendErrorFunc)(fOnSendErrorData);
 	  }
 	}
 #endif
       } else { // unencrypted
-	if (!fRTPInterface.sendPacket(fOutBuf->packet(), fOutBuf->curPacketSize())) {
+	if (!fRTPInterface.sendPacket(fOutBuf->packet(), fOutBuf->curPacketSize(), fCurPacketHasKeyData)) {
 	  // if failure handler has been specified, call it
 	  if (fOnSendErrorFunc != NULL) (*fOnSendErrorFunc)(fOnSendErrorData);
 	}
@@ -422,7 +460,8 @@ void MultiFramedRTPSink::sendPacketIfNecessary() {
   fNumFramesUsedSoFar = 0;
 
   if (fNoFramesLeft) {
-    // We're done:
+    // We're done.  (First, send anything that's still queued, because our 'after playing' handler might close us.)
+    endBatchedOutput();
     onSourceClosure();
   } else {
     // We have more frames left to send.  Figure out when the next frame
@@ -436,6 +475,12 @@ void MultiFramedRTPSink::sendPacketIfNecessary() {
       uSecondsToGo = 0;
     }
 
+    if (uSecondsToGo == 0 && fIsSendingBurst) {
+      // Have "sendBurst()" build the next packet right away, rather than returning to the event loop first:
+      fSendNextPacketImmediately = True;
+      return;
+    }
+
     // Delay this amount of time:
     nextTask() = envir().taskScheduler().scheduleDelayedTask(uSecondsToGo, (TaskFunc*)sendNext, this);
   }
@@ -444,7 +489,68 @@ void MultiFramedRTPSink::sendPacketIfNecessary() {
 // The following is called after each delay between packet sends:
 void MultiFramedRTPSink::sendNext(void* firstArg) {
   MultiFramedRTPSink* sink = (MultiFramedRTPSink*)firstArg;
-  sink->buildAndSendPacket(False);
+  sink->sendBurst(False);
+}
+
+void MultiFramedRTPSink::sendBurst(Boolean isFirstPacket) {
+  Boolean sinkWasDeleted = False;
+  beginBurst(sinkWasDeleted);
+  buildAndSendPacket(isFirstPacket);
+  if (sinkWasDeleted) return;
+  finishBurst(sinkWasDeleted);
+}
+
+void MultiFramedRTPSink::beginBurst(Boolean& sinkWasDeleted) {
+  // During a burst, we build and send packets for as long as each next packet is due immediately (e.g., the
+  // fragments of a large frame).  Meanwhile, our groupsock queues the packets, so that they all get sent at the end,
+  // using as few system calls as possible:
+  Groupsock* gs = fRTPInterface.gs();
+  if (gs != NULL && !gs->batchedOutput()) {
+    gs->setBatchedOutput(True);
+    fBatchedOutputGroupsock = gs;
+  }
+
+  fSinkWasDeletedFlag = &sinkWasDeleted;
+  fIsSendingBurst = True;
+  fSendNextPacketImmediately = False;
+}
+
+#define MAX_PACKETS_PER_BURST 64
+    // so that a very large frame can't stop us from handling other events for too long
+
+void MultiFramedRTPSink::finishBurst(Boolean& sinkWasDeleted) {
+  // Note: "sinkWasDeleted" is our caller's (stack) variable - the one that was passed to "beginBurst()".  We check it
+  // (rather than any member) after each call that might have deleted us.
+  unsigned numPacketsSent = 1;
+  while (fSendNextPacketImmediately && numPacketsSent < MAX_PACKETS_PER_BURST) {
+    fSendNextPacketImmediately = False;
+    buildAndSendPacket(False);
+    if (sinkWasDeleted) return;
+    ++numPacketsSent;
+  }
+  fIsSendingBurst = False;
+
+  if (!endBatchedOutput()) {
+    // if failure handler has been specified, call it
+    if (fOnSendErrorFunc != NULL) (*fOnSendErrorFunc)(fOnSendErrorData);
+    if (sinkWasDeleted) return;
+  }
+  fSinkWasDeletedFlag = NULL;
+
+  if (fSendNextPacketImmediately) {
+    // Let other events get handled before we continue:
+    nextTask() = envir().taskScheduler().scheduleDelayedTask(0, (TaskFunc*)sendNext, this);
+  }
+}
+
+Boolean MultiFramedRTPSink::endBatchedOutput() {
+  Groupsock* gs = fBatchedOutputGroupsock;
+  if (gs == NULL) return True;
+  fBatchedOutputGroupsock = NULL;
+
+  Boolean success = gs->flushBatchedOutput(envir());
+  gs->setBatchedOutput(False);
+  return success;
 }
 
 void MultiFramedRTPSink::ourHandleClosure(void* clientData) {
@@ -24,6 +24,11 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "GroupsockHelper.hh"
 #include <string.h>
 
+#ifndef MULTI_FRAMED_RTP_SOURCE_DEFAULT_MAX_PACKETS_PER_READ
+#define MULTI_FRAMED_RTP_SOURCE_DEFAULT_MAX_PACKETS_PER_READ 1
+#endif
+#define MULTI_FRAMED_RTP_SOURCE_MAX_PACKETS_PER_READ 64
+
 ////////// ReorderingPacketBuffer definition //////////
 
 class ReorderingPacketBuffer {
@@ -37,14 +42,21 @@ public:
   BufferedPacket* getNextCompletedPacket(Boolean& packetLossPreceded);
   void releaseUsedPacket(BufferedPacket* packet);
   void freePacket(BufferedPacket* packet) {
-    if (packet != fSavedPacket) {
-      delete packet;
-    } else {
+    if (packet == fSavedPacket) {
       fSavedPacketFree = True;
+    } else if (fNumFreePackets < fMaxNumFreePackets) {
+      // Keep the packet for reuse:
+      packet->nextPacket() = fFreePackets;
+      fFreePackets = packet;
+      ++fNumFreePackets;
+    } else {
+      delete packet;
     }
   }
   Boolean isEmpty() const { return fHeadPacket == NULL; }
 
+  void setMaxNumFreePackets(unsigned maxNumFreePackets);
+
   void setThresholdTime(unsigned uSeconds) { fThresholdTime = uSeconds; }
   void resetHaveSeenFirstPacket() { fHaveSeenFirstPacket = False; }
 
@@ -58,6 +70,9 @@ private:
   BufferedPacket* fSavedPacket;
       // to avoid calling new/free in the common case
   Boolean fSavedPacketFree;
+  BufferedPacket* fFreePackets;
+      // more packets that we keep for reuse (e.g., when several packets are read at once)
+  unsigned fNumFreePackets, fMaxNumFreePackets;
 };
 
 
@@ -68,9 +83,12 @@ MultiFramedRTPSource
 		       unsigned char rtpPayloadFormat,
 		       unsigned rtpTimestampFrequency,
 		       BufferedPacketFactory* packetFactory)
-  : RTPSource(env, RTPgs, rtpPayloadFormat, rtpTimestampFrequency) {
+  : RTPSource(env, RTPgs, rtpPayloadFormat, rtpTimestampFrequency),
+    fNumReadWakeups(0), fNumPacketsReadInBatches(0), fMaxPacketsReadPerWakeup(0) {
   reset();
   fReorderingBuffer = new ReorderingPacketBuffer(packetFactory);
+  fMaxPacketsPerRead = 1;
+  setMaxPacketsPerRead(MULTI_FRAMED_RTP_SOURCE_DEFAULT_MAX_PACKETS_PER_READ);
 
   // Try to use a big receive buffer for RTP:
   increaseReceiveBufferTo(env, RTPgs->socketNum(), 50*1024);
@@ -89,6 +107,17 @@ MultiFramedRTPSource::~MultiFramedRTPSource() {
   delete fReorderingBuffer;
 }
 
+void MultiFramedRTPSource::setMaxPacketsPerRead(unsigned maxPacketsPerRead) {
+  if (maxPacketsPerRead == 0) maxPacketsPerRead = 1;
+  if (maxPacketsPerRead > MULTI_FRAMED_RTP_SOURCE_MAX_PACKETS_PER_READ) {
+    maxPacketsPerRead = MULTI_FRAMED_RTP_SOURCE_MAX_PACKETS_PER_READ;
+  }
+  fMaxPacketsPerRead = maxPacketsPerRead;
+
+  // Keep enough free packets around to read each batch into, without having to allocate new ones:
+  fReorderingBuffer->setMaxNumFreePackets(fMaxPacketsPerRead - 1);
+}
+
 Boolean MultiFramedRTPSource
 ::processSpecialHeader(BufferedPacket* /*packet*/,
 		       unsigned& resultSpecialHeaderSize) {
@@ -227,6 +256,12 @@ void MultiFramedRTPSource::networkReadHandler(MultiFramedRTPSource* source, int
 }
 
 void MultiFramedRTPSource::networkReadHandler1() {
+  if (fMaxPacketsPerRead > 1 && fPacketReadInProgress == NULL && !fRTPInterface.nextReadIsFromTCP()) {
+    // Read all of the packets that are waiting (up to a limit) at once:
+    readPacketBatch();
+    return;
+  }
+
   BufferedPacket* bPacket = fPacketReadInProgress;
   if (bPacket == NULL) {
     // Normal case: Get a free BufferedPacket descriptor to hold the new network packet:
@@ -252,6 +287,52 @@ void MultiFramedRTPSource::networkReadHandler1() {
     } else {
       fPacketReadInProgress = NULL;
     }
+
+    readSuccess = processNewPacket(bPacket, fromAddress);
+  } while (0);
+  if (!readSuccess) fReorderingBuffer->freePacket(bPacket);
+
+  doGetNextFrame1();
+  // If we didn't get proper data this time, we'll get another chance
+}
+
+void MultiFramedRTPSource::readPacketBatch() {
+  BufferedPacket* packets[MULTI_FRAMED_RTP_SOURCE_MAX_PACKETS_PER_READ];
+  unsigned char* buffers[MULTI_FRAMED_RTP_SOURCE_MAX_PACKETS_PER_READ];
+  unsigned bufferSizes[MULTI_FRAMED_RTP_SOURCE_MAX_PACKETS_PER_READ];
+  unsigned bytesRead[MULTI_FRAMED_RTP_SOURCE_MAX_PACKETS_PER_READ];
+  struct sockaddr_storage fromAddresses[MULTI_FRAMED_RTP_SOURCE_MAX_PACKETS_PER_READ];
+
+  unsigned const numPackets = fMaxPacketsPerRead; // >= 2
+  unsigned i = 0;
+  do {
+    packets[i] = fReorderingBuffer->getFreePacket(this);
+    buffers[i] = packets[i]->prepareForBatchedRead(bufferSizes[i]);
+  } while (++i < numPackets);
+
+  int numPacketsRead = fRTPInterface.handleReadBatch(numPackets, buffers, bufferSizes, bytesRead, fromAddresses);
+  ++fNumReadWakeups;
+  if (numPacketsRead > 0) {
+    fNumPacketsReadInBatches += numPacketsRead;
+    if ((unsigned)numPacketsRead > fMaxPacketsReadPerWakeup) fMaxPacketsReadPerWakeup = numPacketsRead;
+  }
+
+  for (i = 0; i < numPackets; ++i) {
+    if ((int)i < numPacketsRead) {
+      packets[i]->noteBatchedReadDone(bytesRead[i]);
+      if (processNewPacket(packets[i], fromAddresses[i])) continue; // the packet was stored
+    }
+    fReorderingBuffer->freePacket(packets[i]);
+  }
+
+  doGetNextFrame1();
+}
+
+Boolean MultiFramedRTPSource
+::processNewPacket(BufferedPacket* bPacket, struct sockaddr_storage const& fromAddress) {
+  // Perform sanity checks on the RTP header, and - if OK - store the packet.
+  // Returns False if the packet was not stored (and so should be freed by the caller).
+  do {
 #ifdef TEST_LOSS
     setPacketReorderingThresholdTime(0);
        // don't wait for 'lost' packets to arrive out-of-order later
@@ -338,12 +419,10 @@ void MultiFramedRTPSource::networkReadHandler1() {
 			      timeNow);
     if (!fReorderingBuffer->storePacket(bPacket)) break;
 
-    readSuccess = True;
+    return True;
   } while (0);
-  if (!readSuccess) fReorderingBuffer->freePacket(bPacket);
 
-  doGetNextFrame1();
-  // If we didn't get proper data this time, we'll get another chance
+  return False;
 }
 
 
@@ -425,6 +504,13 @@ Boolean BufferedPacket::fillInData(RTPInterface& rtpInterface, struct sockaddr_s
   return True;
 }
 
+unsigned char* BufferedPacket::prepareForBatchedRead(unsigned& maxBytesToRead) {
+  reset();
+
+  maxBytesToRead = bytesAvailable();
+  return &fBuf[fTail];
+}
+
 void BufferedPacket
 ::assignMiscParams(unsigned short rtpSeqNo, unsigned rtpTimestamp,
 		   struct timeval presentationTime,
@@ -509,7 +595,8 @@ BufferedPacket* BufferedPacketFactory
 ReorderingPacketBuffer
 ::ReorderingPacketBuffer(BufferedPacketFactory* packetFactory)
   : fThresholdTime(100000) /* default reordering threshold: 100 ms */,
-    fHaveSeenFirstPacket(False), fHeadPacket(NULL), fTailPacket(NULL), fSavedPacket(NULL), fSavedPacketFree(True) {
+    fHaveSeenFirstPacket(False), fHeadPacket(NULL), fTailPacket(NULL), fSavedPacket(NULL), fSavedPacketFree(True),
+    fFreePackets(NULL), fNumFreePackets(0), fMaxNumFreePackets(0) {
   fPacketFactory = (packetFactory == NULL)
     ? (new BufferedPacketFactory)
     : packetFactory;
@@ -523,8 +610,22 @@ ReorderingPacketBuffer::~ReorderingPacketBuffer() {
 void ReorderingPacketBuffer::reset() {
   if (fSavedPacketFree) delete fSavedPacket; // because fSavedPacket is not in the list
   delete fHeadPacket; // will also delete fSavedPacket if it's in the list
+  delete fFreePackets; // will also delete the rest of the free list
   resetHaveSeenFirstPacket();
-  fHeadPacket = fTailPacket = fSavedPacket = NULL;
+  fHeadPacket = fTailPacket = fSavedPacket = fFreePackets = NULL;
+  fNumFreePackets = 0;
+}
+
+void ReorderingPacketBuffer::setMaxNumFreePackets(unsigned maxNumFreePackets) {
+  fMaxNumFreePackets = maxNumFreePackets;
+
+  while (fNumFreePackets > fMaxNumFreePackets) {
+    BufferedPacket* packet = fFreePackets;
+    fFreePackets = packet->nextPacket();
+    packet->nextPacket() = NULL;
+    delete packet;
+    --fNumFreePackets;
+  }
 }
 
 BufferedPacket* ReorderingPacketBuffer::getFreePacket(MultiFramedRTPSource* ourSource) {
@@ -536,6 +637,12 @@ BufferedPacket* ReorderingPacketBuffer::getFreePacket(MultiFramedRTPSource* ourS
   if (fSavedPacketFree == True) {
     fSavedPacketFree = False;
     return fSavedPacket;
+  } else if (fFreePackets != NULL) {
+    BufferedPacket* packet = fFreePackets;
+    fFreePackets = packet->nextPacket();
+    packet->nextPacket() = NULL;
+    --fNumFreePackets;
+    return packet;
   } else {
     return fPacketFactory->createNewPacket(ourSource);
   }
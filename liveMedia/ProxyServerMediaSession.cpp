@@ -27,12 +27,19 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #define MILLION 1000000
 #endif
 
+// The maximum length (in NAL units) of a 'group of pictures' that we cache (if "setGOPCacheSize()" was called).
+// This is also the maximum number of NAL units that a front-end client may lag behind the back-end stream:
+#ifndef PROXY_GOP_CACHE_MAX_NAL_UNITS
+#define PROXY_GOP_CACHE_MAX_NAL_UNITS 1000
+#endif
+
 // A "OnDemandServerMediaSubsession" subclass, used to implement a unicast RTSP server that's proxying another RTSP stream:
 
 class ProxyServerMediaSubsession: public OnDemandServerMediaSubsession {
 public:
   ProxyServerMediaSubsession(MediaSubsession& mediaSubsession,
-			     portNumBits initialPortNum, Boolean multiplexRTCPWithRTP);
+			     portNumBits initialPortNum, Boolean multiplexRTCPWithRTP,
+			     unsigned gopCacheSize = 0);
   virtual ~ProxyServerMediaSubsession();
 
   char const* codecName() const { return fCodecName; }
@@ -53,6 +60,9 @@ private:
   static void subsessionByeHandler(void* clientData);
   void subsessionByeHandler();
 
+  void createReplicator();
+  PresentationTimeSubsessionNormalizer* presentationTimeSubsessionNormalizer(FramedSource* inputSource);
+
   int verbosityLevel() const { return ((ProxyServerMediaSession*)fParentSession)->fVerbosityLevel; }
 
 private:
@@ -61,6 +71,12 @@ private:
   char const* fCodecName;  // copied from "fClientMediaSubsession" once it's been set up
   ProxyServerMediaSubsession* fNext; // used when we're part of a queue
   Boolean fHaveSetupStream;
+
+  // Used only if we cache the most recent 'group of pictures' (in which case each client gets its own input source - a
+  // replica of our (single) input source - and its own "RTPSink"):
+  unsigned fGOPCacheSize; // 0 iff we don't do this
+  StreamReplicator* fReplicator;
+  HashTable* fReplicaRTPSinks; // maps each client's input source to its "RTPSink"
 };
 
 
@@ -108,7 +124,7 @@ ProxyServerMediaSession
     fPresentationTimeSessionNormalizer(new PresentationTimeSessionNormalizer(envir())),
     fCreateNewProxyRTSPClientFunc(ourCreateNewProxyRTSPClientFunc),
     fTranscodingTable(transcodingTable),
-    fInitialPortNum(initialPortNum), fMultiplexRTCPWithRTP(multiplexRTCPWithRTP) {
+    fInitialPortNum(initialPortNum), fMultiplexRTCPWithRTP(multiplexRTCPWithRTP), fGOPCacheSize(0) {
   // Open a RTSP connection to the input stream, and send a "DESCRIBE" command.
   // We'll use the SDP description in the response to set ourselves up.
   fProxyRTSPClient
@@ -171,7 +187,7 @@ void ProxyServerMediaSession::continueAfterDESCRIBE(char const* sdpDescription)
       if (!allowProxyingForSubsession(*mss)) continue;
 
       ServerMediaSubsession* smss
-	= new ProxyServerMediaSubsession(*mss, fInitialPortNum, fMultiplexRTCPWithRTP);
+	= new ProxyServerMediaSubsession(*mss, fInitialPortNum, fMultiplexRTCPWithRTP, fGOPCacheSize);
       addSubsession(smss);
       if (fVerbosityLevel > 0) {
 	envir() << *this << " added new \"ProxyServerMediaSubsession\" for "
@@ -549,13 +565,23 @@ void ProxyRTSPClient::handleSubsessionTimeout() {
 
 //////// "ProxyServerMediaSubsession" implementation //////////
 
+static Boolean usesGOPCache(MediaSubsession const& mediaSubsession, unsigned gopCacheSize) {
+  // We cache 'groups of pictures' only for H.264 and H.265 video:
+  return gopCacheSize > 0
+    && (strcmp(mediaSubsession.codecName(), "H264") == 0 || strcmp(mediaSubsession.codecName(), "H265") == 0);
+}
+
 ProxyServerMediaSubsession
 ::ProxyServerMediaSubsession(MediaSubsession& mediaSubsession,
-			     portNumBits initialPortNum, Boolean multiplexRTCPWithRTP)
-  : OnDemandServerMediaSubsession(mediaSubsession.parentSession().envir(), True/*reuseFirstSource*/,
+			     portNumBits initialPortNum, Boolean multiplexRTCPWithRTP,
+			     unsigned gopCacheSize)
+  : OnDemandServerMediaSubsession(mediaSubsession.parentSession().envir(),
+				  !usesGOPCache(mediaSubsession, gopCacheSize)/*reuseFirstSource*/,
 				  initialPortNum, multiplexRTCPWithRTP),
     fClientMediaSubsession(mediaSubsession), fCodecName(strDup(mediaSubsession.codecName())),
-    fNext(NULL), fHaveSetupStream(False) {
+    fNext(NULL), fHaveSetupStream(False),
+    fGOPCacheSize(usesGOPCache(mediaSubsession, gopCacheSize) ? gopCacheSize : 0), fReplicator(NULL),
+    fReplicaRTPSinks(HashTable::create(ONE_WORD_HASH_KEYS)) {
 }
 
 UsageEnvironment& operator<<(UsageEnvironment& env, const ProxyServerMediaSubsession& psmss) { // used for debugging
@@ -567,6 +593,12 @@ ProxyServerMediaSubsession::~ProxyServerMediaSubsession() {
     envir() << *this << "::~ProxyServerMediaSubsession()\n";
   }
 
+  if (fReplicator != NULL) {
+    // (Our input source belongs to "fClientMediaSubsession", so don't let the replicator close it.)
+    fReplicator->detachInputSource();
+    Medium::close(fReplicator);
+  }
+  delete fReplicaRTPSinks;
   delete[] (char*)fCodecName;
 }
 
@@ -627,6 +659,8 @@ FramedSource* ProxyServerMediaSubsession::createNewStreamSource(unsigned clientS
 					 ::createNew(envir(), fClientMediaSubsession.readSource(),
 						     False, True/* leave PTs unmodified*/));
       }
+
+      if (fGOPCacheSize > 0) createReplicator();
     }
 
     if (fClientMediaSubsession.rtcpInstance() != NULL) {
@@ -679,13 +713,47 @@ FramedSource* ProxyServerMediaSubsession::createNewStreamSource(unsigned clientS
 
   estBitrate = fClientMediaSubsession.bandwidth();
   if (estBitrate == 0) estBitrate = 50; // kbps, estimate
+
+  if (fReplicator != NULL) {
+    // Give this client its own replica of our input source.  (Its "RTPSink" will need a 'framer' in front of this.):
+    FramedSource* replica = fReplicator->createStreamReplica();
+    if (strcmp(fCodecName, "H264") == 0) return H264VideoStreamDiscreteFramer::createNew(envir(), replica);
+    if (strcmp(fCodecName, "H265") == 0) return H265VideoStreamDiscreteFramer::createNew(envir(), replica);
+    return replica;
+  }
   return fClientMediaSubsession.readSource();
 }
 
-void ProxyServerMediaSubsession::closeStreamSource(FramedSource* /*inputSource*/) {
+void ProxyServerMediaSubsession::createReplicator() {
+  // Replicate our input source - one replica for each client - keeping a copy of its most recent 'group of pictures', for
+  // new clients.  A client that falls too far behind the others skips ahead to the next key frame:
+  fReplicator = StreamReplicator::createNew(envir(), fClientMediaSubsession.readSource(), False/*deleteWhenLastReplicaDies*/,
+					    OutPacketBuffer::maxSize);
+
+  Boolean const isH264 = strcmp(fCodecName, "H264") == 0;
+  if (isH264 || strcmp(fCodecName, "H265") == 0) { // (it might not be, if we're transcoding)
+    fReplicator->setSlowConsumerPolicy(REPLICATOR_DROP_UNTIL_KEY_FRAME, PROXY_GOP_CACHE_MAX_NAL_UNITS,
+				       isH264 ? StreamReplicator::isH264KeyFrame : StreamReplicator::isH265KeyFrame,
+				       isH264 ? StreamReplicator::isH264ParameterSet : StreamReplicator::isH265ParameterSet);
+    fReplicator->setGOPCache(fGOPCacheSize);
+  }
+}
+
+void ProxyServerMediaSubsession::closeStreamSource(FramedSource* inputSource) {
   if (verbosityLevel() > 0) {
     envir() << *this << "::closeStreamSource()\n";
   }
+  if (fReplicator != NULL) {
+    // Each client has its own input source (a replica of ours), so close it:
+    RTPSink* rtpSink = (RTPSink*)(fReplicaRTPSinks->Lookup((char const*)inputSource));
+    if (rtpSink != NULL) {
+      presentationTimeSubsessionNormalizer(inputSource)->removeRTPSink(rtpSink);
+      fReplicaRTPSinks->Remove((char const*)inputSource);
+    }
+    Medium::close(inputSource);
+
+    if (fReplicator->numReplicas() > 0) return; // other clients are still accessing the stream
+  }
   // Because there's only one input source for this 'subsession' (regardless of how many downstream clients are proxying it),
   // we don't close the input source here.  (Instead, we wait until *this* object gets deleted.)
   // However, because (as evidenced by this function having been called) we no longer have any clients accessing the stream,
@@ -822,20 +890,34 @@ RTPSink* ProxyServerMediaSubsession
   newSink->enableRTCPReports() = False;
 
   // Also tell our "PresentationTimeSubsessionNormalizer" object about the "RTPSink", so it can enable RTCP "SR" reports later:
-  PresentationTimeSubsessionNormalizer* ssNormalizer;
+  PresentationTimeSubsessionNormalizer* ssNormalizer = presentationTimeSubsessionNormalizer(inputSource);
+  if (fReplicator != NULL) {
+    ssNormalizer->addRTPSink(newSink);
+    fReplicaRTPSinks->Add((char const*)inputSource, newSink); // so we can tell the normalizer when the "RTPSink" goes away
+  } else {
+    ssNormalizer->setRTPSink(newSink);
+  }
+
+  return newSink;
+}
+
+PresentationTimeSubsessionNormalizer* ProxyServerMediaSubsession
+::presentationTimeSubsessionNormalizer(FramedSource* inputSource) {
+  if (fReplicator != NULL) {
+    // "inputSource" was made from a replica of our input source, so look at our input source instead:
+    inputSource = fReplicator->inputSource();
+  }
+
   if (strcmp(fCodecName, "H264") == 0 ||
       strcmp(fCodecName, "H265") == 0 ||
       strcmp(fCodecName, "MP4V-ES") == 0 ||
       strcmp(fCodecName, "MPV") == 0 ||
       strcmp(fCodecName, "DV") == 0) {
     // There was a separate 'framer' object in front of the "PresentationTimeSubsessionNormalizer", so go back one object to get it:
-    ssNormalizer = (PresentationTimeSubsessionNormalizer*)(((FramedFilter*)inputSource)->inputSource());
+    return (PresentationTimeSubsessionNormalizer*)(((FramedFilter*)inputSource)->inputSource());
   } else {
-    ssNormalizer = (PresentationTimeSubsessionNormalizer*)inputSource;
+    return (PresentationTimeSubsessionNormalizer*)inputSource;
   }
-  ssNormalizer->setRTPSink(newSink);
-
-  return newSink;
 }
 
 Groupsock* ProxyServerMediaSubsession
@@ -929,9 +1011,15 @@ void PresentationTimeSessionNormalizer
 
     // Because "ssNormalizer"s relayed presentation times are accurate from now on, enable RTCP "SR" reports for its "RTPSink":
     RTPSink* const rtpSink = ssNormalizer->fRTPSink;
-    if (rtpSink != NULL) { // sanity check; should always be true
+    if (rtpSink != NULL) {
       rtpSink->enableRTCPReports() = True;
     }
+
+    // Do the same for the "RTPSink"s (if any) that its frames are replicated to.  (We then no longer need to remember these.):
+    RTPSink* replicaRTPSink;
+    while ((replicaRTPSink = (RTPSink*)(ssNormalizer->fReplicaRTPSinks->RemoveNext())) != NULL) {
+      replicaRTPSink->enableRTCPReports() = True;
+    }
   }
 }
 
@@ -953,11 +1041,26 @@ PresentationTimeSubsessionNormalizer
 ::PresentationTimeSubsessionNormalizer(PresentationTimeSessionNormalizer& parent, FramedSource* inputSource, RTPSource* rtpSource,
 				       char const* codecName, PresentationTimeSubsessionNormalizer* next)
   : FramedFilter(parent.envir(), inputSource),
-    fParent(parent), fRTPSource(rtpSource), fRTPSink(NULL), fCodecName(codecName), fNext(next) {
+    fParent(parent), fRTPSource(rtpSource), fRTPSink(NULL), fReplicaRTPSinks(HashTable::create(ONE_WORD_HASH_KEYS)),
+    fCodecName(codecName), fNext(next) {
 }
 
 PresentationTimeSubsessionNormalizer::~PresentationTimeSubsessionNormalizer() {
   fParent.removePresentationTimeSubsessionNormalizer(this);
+  delete fReplicaRTPSinks;
+}
+
+void PresentationTimeSubsessionNormalizer::addRTPSink(RTPSink* rtpSink) {
+  if (fRTPSource->hasBeenSynchronizedUsingRTCP()) {
+    // Our relayed presentation times are already accurate, so RTCP "SR" reports can be enabled straight away:
+    rtpSink->enableRTCPReports() = True;
+  } else {
+    fReplicaRTPSinks->Add((char const*)rtpSink, rtpSink);
+  }
+}
+
+void PresentationTimeSubsessionNormalizer::removeRTPSink(RTPSink* rtpSink) {
+  fReplicaRTPSinks->Remove((char const*)rtpSink);
 }
 
 void PresentationTimeSubsessionNormalizer::afterGettingFrame(void* clientData, unsigned frameSize,
@@ -980,7 +980,7 @@ void RTCPInstance::sendBuiltPacket() {
     if (!fCrypto->processOutgoingSRTCPPacket(fOutBuf->packet(), reportSize, newReportSize)) return;
     reportSize = newReportSize;
   }
-  fRTCPInterface.sendPacket(fOutBuf->packet(), reportSize);
+  fRTCPInterface.sendPacket(fOutBuf->packet(), reportSize, True/*RTCP reports are small, but needed for sync*/);
   fOutBuf->resetOffset();
 
   fLastSentSize = IP_UDP_HDR_SIZE + reportSize;
@@ -60,6 +60,35 @@ static HashTable* socketHashTable(UsageEnvironment& env, Boolean createIfNotPres
   return (HashTable*)(ourTables->socketTable);
 }
 
+// RTP/RTCP-over-TCP data that's waiting to be written to a socket:
+class EgressRecord {
+public:
+  EgressRecord(u_int8_t const* framingHeader, unsigned framingHeaderSize,
+	       u_int8_t const* data, unsigned dataSize, Boolean isKeyData, Boolean mustNotBeDropped);
+  virtual ~EgressRecord();
+
+  Boolean canBeDropped() const { return fNumBytesSent == 0 && !fMustNotBeDropped; }
+
+public:
+  EgressRecord* fNext; EgressRecord* fPrev;
+  // Records that can be dropped are also kept in one of two (oldest-first) lists - one for 'key data', one for other data:
+  EgressRecord* fNextDroppable; EgressRecord* fPrevDroppable;
+  Boolean fIsOnDroppableList;
+  u_int8_t* fData;
+  unsigned fSize;
+  unsigned fNumBytesSent; // if > 0, we've started writing this record, so it can no longer be dropped
+  struct timeval fEnqueueTime;
+  Boolean fIsKeyData, fMustNotBeDropped;
+};
+
+static int sendToStreamSocket(UsageEnvironment& env, int socketNum, TLSState* tlsState,
+			      u_int8_t const* data, unsigned dataSize); // forward
+
+static Boolean isTLSWriteRetry(TLSState* tlsState, int sendResult) {
+  // True iff a (non-empty) write of the same data must be retried later, because "sendResult" (0) came from a TLS write:
+  return sendResult == 0 && tlsState != NULL && tlsState->isNeeded;
+}
+
 class SocketDescriptor {
 public:
   SocketDescriptor(UsageEnvironment& env, int socketNum, TLSState* tlsState);
@@ -75,10 +104,23 @@ public:
     fServerRequestAlternativeByteHandlerClientData = clientData;
   }
 
+  // Implementation of the egress queue:
+  Boolean egressQueueIsEmpty() const { return fEgressQueueHead == NULL; }
+  void enqueueEgressData(u_int8_t const* framingHeader, unsigned framingHeaderSize,
+			 u_int8_t const* data, unsigned dataSize, unsigned numBytesAlreadySent,
+			 TLSState* tlsState, Boolean isKeyData, Boolean mustNotBeDropped);
+  TCPEgressQueueStats const& egressQueueStats() const { return fEgressQueueStats; }
+
 private:
   static void tcpReadHandler(SocketDescriptor*, int mask);
   Boolean tcpReadHandler1(int mask);
 
+  void flushEgressQueue();
+  void enforceEgressQueueLimits();
+  void dequeueEgressRecord(EgressRecord* record);
+  void noteEgressRecordCannotBeDropped(EgressRecord* record);
+  void updateBackgroundHandling(Boolean isFirstRegistration = False);
+
 private:
   UsageEnvironment& fEnv;
   int fOurSocketNum;
@@ -89,6 +131,11 @@ private:
   u_int8_t fStreamChannelId, fSizeByte1;
   Boolean fReadErrorOccurred, fDeleteMyselfNext, fAreInReadHandlerLoop;
   enum { AWAITING_DOLLAR, AWAITING_STREAM_CHANNEL_ID, AWAITING_SIZE1, AWAITING_SIZE2, AWAITING_PACKET_DATA } fTCPReadingState;
+  EgressRecord* fEgressQueueHead; EgressRecord* fEgressQueueTail;
+  EgressRecord* fDroppableHead[2]; EgressRecord* fDroppableTail[2]; // indexed by 'is key data'
+  TLSState* fEgressTLSState;
+  Boolean fWantWritable; // iff we've asked to be told when our socket is writable
+  TCPEgressQueueStats fEgressQueueStats;
 };
 
 static SocketDescriptor*
@@ -180,7 +227,7 @@ void RTPInterface::addStreamSocket(int sockNum, unsigned char streamChannelId,
 
   unsigned destCount = 0;
   for (tcpStreamRecord* s = fTCPStreams; s != NULL; s = s->fNext) ++destCount;
-  static time_t lastSec = 0; static unsigned long pending = 0;
+  static thread_local time_t lastSec = 0; static thread_local unsigned long pending = 0;
   unsigned long n = rateLimitedLog(lastSec, pending, 5);
   if (n > 0) {
     envir() << "RTPInterface::addStreamSocket: added channel " << (int)streamChannelId
@@ -243,7 +290,7 @@ void RTPInterface::clearServerRequestAlternativeByteHandler(UsageEnvironment& en
   setServerRequestAlternativeByteHandler(env, socketNum, NULL, NULL);
 }
 
-Boolean RTPInterface::sendPacket(unsigned char* packet, unsigned packetSize) {
+Boolean RTPInterface::sendPacket(unsigned char* packet, unsigned packetSize, Boolean isKeyData) {
   Boolean success = True; // we'll return False instead if any of the sends fail
 
   // Normal case: Send as a UDP packet:
@@ -255,7 +302,7 @@ Boolean RTPInterface::sendPacket(unsigned char* packet, unsigned packetSize) {
     nextStream = stream->fNext; // Set this now, in case the following deletes "stream":
     if (!sendRTPorRTCPPacketOverTCP(packet, packetSize,
 				    stream->fStreamSocketNum, stream->fStreamChannelId,
-				    stream->fTLSState)) {
+				    stream->fTLSState, isKeyData)) {
       success = False;
     }
   }
@@ -339,6 +386,19 @@ Boolean RTPInterface::handleRead(unsigned char* buffer, unsigned bufferMaxSize,
   return readSuccess;
 }
 
+int RTPInterface::handleReadBatch(unsigned numBuffers, unsigned char* const* buffers, unsigned const* bufferMaxSizes,
+				  unsigned* bytesRead, struct sockaddr_storage* fromAddresses) {
+  int numPacketsRead = fGS->handleReadBatch(numBuffers, buffers, bufferMaxSizes, bytesRead, fromAddresses);
+
+  if (fAuxReadHandlerFunc != NULL) {
+    // Also pass the newly-read packet data to our auxilliary handler:
+    for (int i = 0; i < numPacketsRead; ++i) {
+      (*fAuxReadHandlerFunc)(fAuxReadHandlerClientData, buffers[i], bytesRead[i]);
+    }
+  }
+  return numPacketsRead;
+}
+
 void RTPInterface::stopNetworkReading() {
   // Normal case
   if (fGS != NULL) envir().taskScheduler().turnOffBackgroundReadHandling(fGS->socketNum());
@@ -352,151 +412,121 @@ void RTPInterface::stopNetworkReading() {
 
 ////////// Helper Functions - Implementation /////////
 
+#ifndef RTPINTERFACE_TCP_EGRESS_QUEUE_MAX_BYTES
+#define RTPINTERFACE_TCP_EGRESS_QUEUE_MAX_BYTES 1000000
+#endif
+#ifndef RTPINTERFACE_TCP_EGRESS_QUEUE_MAX_DELAY_MS
+#define RTPINTERFACE_TCP_EGRESS_QUEUE_MAX_DELAY_MS 1000
+#endif
+
+unsigned RTPInterface::tcpEgressQueueMaxBytes = RTPINTERFACE_TCP_EGRESS_QUEUE_MAX_BYTES;
+unsigned RTPInterface::tcpEgressQueueMaxDelayMs = RTPINTERFACE_TCP_EGRESS_QUEUE_MAX_DELAY_MS;
+
+Boolean RTPInterface
+::getTCPEgressQueueStats(UsageEnvironment& env, int socketNum, TCPEgressQueueStats& stats) {
+  SocketDescriptor* socketDescriptor = lookupSocketDescriptor(env, socketNum, NULL, False);
+  if (socketDescriptor == NULL) return False;
+
+  stats = socketDescriptor->egressQueueStats();
+  return True;
+}
+
+Boolean RTPInterface::appendToTCPEgressQueue(UsageEnvironment& env, int socketNum,
+					     u_int8_t const* data, unsigned dataSize) {
+  SocketDescriptor* socketDescriptor = lookupSocketDescriptor(env, socketNum, NULL, False);
+  if (socketDescriptor == NULL || socketDescriptor->egressQueueIsEmpty()) return False;
+
+  socketDescriptor->enqueueEgressData(NULL, 0, data, dataSize, 0, NULL, True, True);
+  return True;
+}
+
+// Writes data to a TCP socket, without blocking.  Returns the number of bytes written (possibly 0, if the
+// socket's OS send buffer is full), or -1 if the socket is no longer usable.
+// Note: If a TLS write returns 0, then the TLS library has already taken (and encrypted) the data, and so the next write
+// to the socket must be of the same data (though it may come from a different buffer):
+static int sendToStreamSocket(UsageEnvironment& env, int socketNum, TLSState* tlsState,
+			      u_int8_t const* data, unsigned dataSize) {
+  int sendResult = (tlsState != NULL && tlsState->isNeeded)
+    ? tlsState->write((char const*)data, dataSize)
+    : send(socketNum, (char const*)data, dataSize, MSG_NOSIGNAL/*flags*/);
+  if (sendResult < 0) {
+    return env.getErrno() == EAGAIN || env.getErrno() == EWOULDBLOCK ? 0 : -1;
+  }
+
+  return sendResult;
+}
+
 Boolean RTPInterface::sendRTPorRTCPPacketOverTCP(u_int8_t* packet, unsigned packetSize,
 						 int socketNum, unsigned char streamChannelId,
-						 TLSState* tlsState) {
+						 TLSState* tlsState, Boolean isKeyData) {
 #ifdef DEBUG_SEND
   fprintf(stderr, "sendRTPorRTCPPacketOverTCP: %d bytes over channel %d (socket %d)\n",
 	  packetSize, streamChannelId, socketNum); fflush(stderr);
 #endif
   // Send a RTP/RTCP packet over TCP, using the encoding defined in RFC 2326, section 10.12:
   //     $<streamChannelId><packetSize><packet>
-  // (If the initial "send()" of '$<streamChannelId><packetSize>' succeeds, then we force
-  // the subsequent "send()" for the <packet> data to succeed, even if we have to do so with
-  // a blocking "send()".)
-  Boolean framingOk = False;
-  do {
-    u_int8_t framingHeader[4];
-    framingHeader[0] = '$';
-    framingHeader[1] = streamChannelId;
-    framingHeader[2] = (u_int8_t) ((packetSize&0xFF00)>>8);
-    framingHeader[3] = (u_int8_t) (packetSize&0xFF);
-    if (!sendDataOverTCP(socketNum, tlsState, framingHeader, 4, False)) break;
-    framingOk = True;
-
-    if (!sendDataOverTCP(socketNum, tlsState, packet, packetSize, True)) break;
-#ifdef DEBUG_SEND
-    fprintf(stderr, "sendRTPorRTCPPacketOverTCP: completed\n"); fflush(stderr);
-#endif
-
+  // We never block.  If the socket's OS send buffer is full, then we queue whatever we couldn't send
+  // (in the socket's "SocketDescriptor"), to be written later, when the socket becomes writable.
+  u_int8_t framingHeader[4];
+  framingHeader[0] = '$';
+  framingHeader[1] = streamChannelId;
+  framingHeader[2] = (u_int8_t) ((packetSize&0xFF00)>>8);
+  framingHeader[3] = (u_int8_t) (packetSize&0xFF);
+
+  SocketDescriptor* socketDescriptor = lookupSocketDescriptor(envir(), socketNum, tlsState, False);
+  if (socketDescriptor != NULL && !socketDescriptor->egressQueueIsEmpty()) {
+    // Data is already waiting to be written to this socket, so queue this packet behind it:
+    socketDescriptor->enqueueEgressData(framingHeader, 4, packet, packetSize, 0, tlsState, isKeyData, False);
     return True;
-  } while (0);
-
-  {
-    // Failed before a full RTP/RTCP packet reached this destination. `framingOk`
-    // tells us where: False => 4-byte framing header was skipped (clean drop,
-    // socket still in sync); True => we wrote the framing header but the
-    // body couldn't be completed and the socket was closed inside sendDataOverTCP.
-    // Skip logging on EBADF/EPIPE — those are teardown races where the socket
-    // is already gone on one side and the extra send attempt is just cleanup
-    // noise, not a real drop we care about. Per-fd rate limit — each socket's
-    // drops throttle independently so a stalled destination doesn't mask drops
-    // on a different one.
+  }
+
+  // Normal case: Try to write the whole packet now:
+  unsigned numBytesSent = 0;
+  int sendResult = sendToStreamSocket(envir(), socketNum, tlsState, framingHeader, 4);
+  if (sendResult == 4) {
+    numBytesSent = 4;
+    sendResult = sendToStreamSocket(envir(), socketNum, tlsState, packet, packetSize);
+    if (sendResult > 0) numBytesSent += sendResult;
+  } else if (sendResult > 0) {
+    numBytesSent = sendResult;
+  }
+
+  if (sendResult < 0) {
+    // Because the "send()" call failed, assume that the socket is now unusable, so stop
+    // using it (for both RTP and RTCP).  Rate-limit globally (5s) to defend against
+    // reconnect loops that rapidly cycle sockets.  Skip EBADF/EPIPE teardown noise.
     int err = envir().getErrno();
     if (err != EBADF && err != EPIPE) {
-      static std::map<int, RateLimitEntry> tracker;
-      unsigned long n = rateLimitedLogPerKey(tracker, socketNum, 5);
+      static thread_local time_t lastSec = 0; static thread_local unsigned long pending = 0;
+      unsigned long n = rateLimitedLog(lastSec, pending, 5);
       if (n > 0) {
-	envir() << "RTPInterface::sendRTPorRTCPPacketOverTCP: dropping " << packetSize
-		<< "-byte packet on channel " << (int)streamChannelId
-		<< "/socket " << socketNum
-		<< " (" << (framingOk ? "body incomplete, socket closed" : "framing header skipped")
-		<< ", errno=" << err << ")";
-	if (n > 1) envir() << " (" << (unsigned)n << " events on this socket in last 5s)";
+	envir() << "RTPInterface::sendRTPorRTCPPacketOverTCP: send error on socket " << socketNum
+		<< " (errno=" << err << "). Closing socket.";
+	if (n > 1) envir() << " (" << (unsigned)n << " similar events in last 5s)";
 	envir() << "\n";
       }
     }
+    removeStreamSocket(socketNum, 0xFF);
+    return False;
   }
-  return False;
-}
-
-#ifndef RTPINTERFACE_BLOCKING_WRITE_TIMEOUT_MS
-#define RTPINTERFACE_BLOCKING_WRITE_TIMEOUT_MS 500
+  if (numBytesSent == 4 + packetSize) {
+#ifdef DEBUG_SEND
+    fprintf(stderr, "sendRTPorRTCPPacketOverTCP: completed\n"); fflush(stderr);
 #endif
+    return True;
+  }
 
-Boolean RTPInterface::sendDataOverTCP(int socketNum, TLSState* tlsState,
-				      u_int8_t const* data, unsigned dataSize,
-				      Boolean forceSendToSucceed) {
-  int sendResult = (tlsState != NULL && tlsState->isNeeded)
-    ? tlsState->write((char const*)data, dataSize)
-    : send(socketNum, (char const*)data, dataSize, MSG_NOSIGNAL/*flags*/);
-  if (sendResult < (int)dataSize) {
-    // The TCP send() failed - at least partially.
-
-    unsigned numBytesSentSoFar = sendResult < 0 ? 0 : (unsigned)sendResult;
-    if (numBytesSentSoFar > 0 || (forceSendToSucceed && envir().getErrno() == EAGAIN)) {
-      // The OS's TCP send buffer has filled up (because the stream's bitrate has exceeded
-      // the capacity of the TCP connection!).
-      // Force this data write to succeed, by blocking if necessary until it does:
-      unsigned numBytesRemainingToSend = dataSize - numBytesSentSoFar;
-      {
-	// TCP send buffer full — we had to fall back to a blocking send, which stalls the
-	// entire event loop (up to RTPINTERFACE_BLOCKING_WRITE_TIMEOUT_MS). Log so stalls
-	// that starve upstream reads are visible. Per-fd so a stalled consumer doesn't
-	// mask a different consumer also stalling.
-	static std::map<int, RateLimitEntry> tracker;
-	unsigned long n = rateLimitedLogPerKey(tracker, socketNum, 5);
-	if (n > 0) {
-	  envir() << "RTPInterface::sendDataOverTCP: TCP send buffer full on socket " << socketNum
-		  << " (blocking " << numBytesRemainingToSend << "/" << dataSize << " bytes"
-		  << ", force=" << (forceSendToSucceed ? "Y" : "N") << ")";
-	  if (n > 1) envir() << " (" << (unsigned)n << " events on this socket in last 5s)";
-	  envir() << "\n";
-	}
-      }
-      makeSocketBlocking(socketNum, RTPINTERFACE_BLOCKING_WRITE_TIMEOUT_MS);
-      sendResult = (tlsState != NULL && tlsState->isNeeded)
-	? tlsState->write((char const*)(&data[numBytesSentSoFar]), numBytesRemainingToSend)
-	: send(socketNum, (char const*)(&data[numBytesSentSoFar]), numBytesRemainingToSend, MSG_NOSIGNAL/*flags*/);
-      makeSocketNonBlocking(socketNum);
-      if ((unsigned)sendResult != numBytesRemainingToSend) {
-	// The blocking "send()" failed, or timed out.  In either case, we assume that the
-	// TCP connection has failed (or is 'hanging' indefinitely), and we stop using it
-	// (for both RTP and RTP).
-	// (If we kept using the socket here, the RTP or RTCP packet write would be in an
-	//  incomplete, inconsistent state.)
-	// Terminal — closes socket. Rate-limit globally (5s) to defend against
-	// reconnect loops that rapidly cycle sockets. Skip EBADF/EPIPE teardown noise.
-	int err = envir().getErrno();
-	if (err != EBADF && err != EPIPE) {
-	  static time_t lastSec = 0; static unsigned long pending = 0;
-	  unsigned long n = rateLimitedLog(lastSec, pending, 5);
-	  if (n > 0) {
-	    envir() << "RTPInterface::sendDataOverTCP: blocking send failed on socket " << socketNum
-		    << " (delivered " << sendResult << "/" << numBytesRemainingToSend << " bytes"
-		    << ", errno=" << err << "). Closing socket.";
-	    if (n > 1) envir() << " (" << (unsigned)n << " similar events in last 5s)";
-	    envir() << "\n";
-	  }
-	}
-	removeStreamSocket(socketNum, 0xFF);
-	return False;
-      }
-
-      return True;
-    } else if (sendResult < 0 && envir().getErrno() != EAGAIN) {
-      // Because the "send()" call failed, assume that the socket is now unusable, so stop
-      // using it (for both RTP and RTCP). Terminal — same reconnect-loop defense as above.
-      // Skip EBADF/EPIPE teardown noise.
-      int err = envir().getErrno();
-      if (err != EBADF && err != EPIPE) {
-	static time_t lastSec = 0; static unsigned long pending = 0;
-	unsigned long n = rateLimitedLog(lastSec, pending, 5);
-	if (n > 0) {
-	  envir() << "RTPInterface::sendDataOverTCP: send error on socket " << socketNum
-		  << " (errno=" << err << "). Closing socket.";
-	  if (n > 1) envir() << " (" << (unsigned)n << " similar events in last 5s)";
-	  envir() << "\n";
-	}
-      }
-      removeStreamSocket(socketNum, 0xFF);
-    }
-    // EAGAIN with 0 bytes sent and !forceSendToSucceed falls through silently —
-    // the caller (sendRTPorRTCPPacketOverTCP) logs the whole-packet drop with
-    // more context (packet size, channel, framingOk), so no duplicate log here.
-
+  // The socket's OS send buffer has filled up (because the stream's bitrate has exceeded the capacity of the
+  // TCP connection, at least for now).  Queue the rest of the packet:
+  if (socketDescriptor == NULL) {
+    // We have nowhere to queue the packet (this shouldn't happen).  If we've already written part of it, then the
+    // socket is now out of sync, so we stop using it:
+    if (numBytesSent > 0) removeStreamSocket(socketNum, 0xFF);
     return False;
   }
+  // (If a TLS write is pending, then the record must be written - unchanged - next, so it can't be dropped.)
+  socketDescriptor->enqueueEgressData(framingHeader, 4, packet, packetSize, numBytesSent, tlsState, isKeyData,
+				      isTLSWriteRetry(tlsState, sendResult));
 
   return True;
 }
@@ -505,12 +535,36 @@ SocketDescriptor::SocketDescriptor(UsageEnvironment& env, int socketNum, TLSStat
   : fEnv(env), fOurSocketNum(socketNum), fTLSState(tlsState),
     fSubChannelHashTable(HashTable::create(ONE_WORD_HASH_KEYS)),
    fServerRequestAlternativeByteHandler(NULL), fServerRequestAlternativeByteHandlerClientData(NULL),
-   fReadErrorOccurred(False), fDeleteMyselfNext(False), fAreInReadHandlerLoop(False), fTCPReadingState(AWAITING_DOLLAR) {
+   fReadErrorOccurred(False), fDeleteMyselfNext(False), fAreInReadHandlerLoop(False), fTCPReadingState(AWAITING_DOLLAR),
+   fEgressQueueHead(NULL), fEgressQueueTail(NULL), fEgressTLSState(tlsState), fWantWritable(False) {
+  fDroppableHead[0] = fDroppableHead[1] = fDroppableTail[0] = fDroppableTail[1] = NULL;
+  memset(&fEgressQueueStats, 0, sizeof fEgressQueueStats);
 }
 
 SocketDescriptor::~SocketDescriptor() {
   fDeleteMyselfNext = False;
-  fEnv.taskScheduler().turnOffBackgroundReadHandling(fOurSocketNum);
+
+  if (fEgressQueueHead != NULL) {
+    // Discard our queued data - except for data that we've already started to write, or that must not be dropped
+    // (e.g., RTSP responses).  Because the socket might continue to be used (e.g., for RTSP), we try to write this
+    // now - but without blocking.  (If the socket's OS send buffer is full, then the rest of it is lost.)
+    Boolean canWrite = !fReadErrorOccurred;
+    while (fEgressQueueHead != NULL) {
+      EgressRecord* record = fEgressQueueHead;
+      if (canWrite && !record->canBeDropped()) {
+	unsigned numBytesRemaining = record->fSize - record->fNumBytesSent;
+	if (sendToStreamSocket(fEnv, fOurSocketNum, fEgressTLSState,
+			       &record->fData[record->fNumBytesSent], numBytesRemaining) != (int)numBytesRemaining) {
+	  canWrite = False; // we can't write any more
+	}
+      }
+      fEgressQueueHead = record->fNext;
+      delete record;
+    }
+    fEgressQueueTail = NULL;
+  }
+
+  fEnv.taskScheduler().disableBackgroundHandling(fOurSocketNum);
   removeSocketDescription(fEnv, fOurSocketNum);
 
   if (fSubChannelHashTable != NULL) {
@@ -552,11 +606,8 @@ void SocketDescriptor::registerRTPInterface(unsigned char streamChannelId,
 			    rtpInterface);
 
   if (isFirstRegistration) {
-    // Arrange to handle reads on this TCP socket:
-    TaskScheduler::BackgroundHandlerProc* handler
-      = (TaskScheduler::BackgroundHandlerProc*)&tcpReadHandler;
-    fEnv.taskScheduler().
-      setBackgroundHandling(fOurSocketNum, SOCKET_READABLE|SOCKET_EXCEPTION, handler, this);
+    // Arrange to handle reads (and, if we have queued data, writes) on this TCP socket:
+    updateBackgroundHandling(True);
   }
 }
 
@@ -584,12 +635,18 @@ void SocketDescriptor
 }
 
 void SocketDescriptor::tcpReadHandler(SocketDescriptor* socketDescriptor, int mask) {
-  // Call the read handler until it returns false, with a limit to avoid starving other sockets
-  unsigned count = 2000;
   Boolean areInRecursiveCall = socketDescriptor->fAreInReadHandlerLoop;
 
   socketDescriptor->fAreInReadHandlerLoop = True;
-  while (!socketDescriptor->fDeleteMyselfNext && socketDescriptor->tcpReadHandler1(mask) && --count > 0) {}
+  if ((mask&SOCKET_WRITABLE) != 0) {
+    // Write as much of our queued data as we can:
+    socketDescriptor->flushEgressQueue();
+  }
+  if ((mask&(SOCKET_READABLE|SOCKET_EXCEPTION)) != 0) {
+    // Call the read handler until it returns false, with a limit to avoid starving other sockets
+    unsigned count = 2000;
+    while (!socketDescriptor->fDeleteMyselfNext && socketDescriptor->tcpReadHandler1(mask) && --count > 0) {}
+  }
   if (!areInRecursiveCall) {
     socketDescriptor->fAreInReadHandlerLoop = False;
     if (socketDescriptor->fDeleteMyselfNext) delete socketDescriptor;
@@ -724,6 +781,207 @@ Boolean SocketDescriptor::tcpReadHandler1(int mask) {
 }
 
 
+void SocketDescriptor
+::enqueueEgressData(u_int8_t const* framingHeader, unsigned framingHeaderSize,
+		    u_int8_t const* data, unsigned dataSize, unsigned numBytesAlreadySent,
+		    TLSState* tlsState, Boolean isKeyData, Boolean mustNotBeDropped) {
+  if (tlsState != NULL) fEgressTLSState = tlsState;
+
+  EgressRecord* record
+    = new EgressRecord(framingHeader, framingHeaderSize, data, dataSize, isKeyData, mustNotBeDropped);
+  record->fNumBytesSent = numBytesAlreadySent;
+  record->fPrev = fEgressQueueTail;
+  if (fEgressQueueTail == NULL) {
+    fEgressQueueHead = record;
+  } else {
+    fEgressQueueTail->fNext = record;
+  }
+  fEgressQueueTail = record;
+
+  if (record->canBeDropped()) {
+    unsigned i = isKeyData ? 1 : 0;
+    record->fPrevDroppable = fDroppableTail[i];
+    if (fDroppableTail[i] == NULL) {
+      fDroppableHead[i] = record;
+    } else {
+      fDroppableTail[i]->fNextDroppable = record;
+    }
+    fDroppableTail[i] = record;
+    record->fIsOnDroppableList = True;
+  }
+
+  ++fEgressQueueStats.numQueuedPackets;
+  fEgressQueueStats.numQueuedBytes += record->fSize - record->fNumBytesSent;
+  if (fEgressQueueStats.numQueuedBytes > fEgressQueueStats.maxQueuedBytes) {
+    fEgressQueueStats.maxQueuedBytes = fEgressQueueStats.numQueuedBytes;
+  }
+
+  enforceEgressQueueLimits();
+  updateBackgroundHandling();
+}
+
+void SocketDescriptor::flushEgressQueue() {
+  while (fEgressQueueHead != NULL) {
+    EgressRecord* record = fEgressQueueHead;
+    unsigned numBytesRemaining = record->fSize - record->fNumBytesSent;
+    int sendResult = sendToStreamSocket(fEnv, fOurSocketNum, fEgressTLSState,
+					&record->fData[record->fNumBytesSent], numBytesRemaining);
+    if (sendResult < 0) {
+      // The socket is no longer usable.  Stop using it (for all of our "RTPInterface"s):
+      int err = fEnv.getErrno();
+      if (err != EBADF && err != EPIPE) {
+	static thread_local time_t lastSec = 0; static thread_local unsigned long pending = 0;
+	unsigned long n = rateLimitedLog(lastSec, pending, 5);
+	if (n > 0) {
+	  fEnv << "RTPInterface: send error on socket " << fOurSocketNum
+	       << " while writing queued data (errno=" << err << "). Closing socket.";
+	  if (n > 1) fEnv << " (" << (unsigned)n << " similar events in last 5s)";
+	  fEnv << "\n";
+	}
+      }
+      fReadErrorOccurred = True;
+      fDeleteMyselfNext = True; // our caller ("tcpReadHandler()") will delete us
+      return;
+    }
+
+    record->fNumBytesSent += sendResult;
+    fEgressQueueStats.numQueuedBytes -= sendResult;
+    if (record->fNumBytesSent < record->fSize) {
+      // The socket's OS send buffer is full again.  We've now started writing this record (or, if we use TLS, have
+      // at least handed it to the TLS library), so it can no longer be dropped:
+      if (sendResult > 0 || isTLSWriteRetry(fEgressTLSState, sendResult)) noteEgressRecordCannotBeDropped(record);
+      break;
+    }
+
+    dequeueEgressRecord(record);
+    delete record;
+  }
+
+  enforceEgressQueueLimits(); // in case the data that's still queued has become too old
+  updateBackgroundHandling();
+}
+
+static long ageInMs(struct timeval const& enqueueTime, struct timeval const& timeNow) {
+  return (timeNow.tv_sec - enqueueTime.tv_sec)*1000 + (timeNow.tv_usec - enqueueTime.tv_usec)/1000;
+}
+
+void SocketDescriptor::enforceEgressQueueLimits() {
+  struct timeval timeNow;
+  gettimeofday(&timeNow, NULL);
+  long const maxDelayMs = (long)RTPInterface::tcpEgressQueueMaxDelayMs;
+
+  while (1) {
+    // Our oldest record that can be dropped is at the head of one of our two 'droppable' lists:
+    EgressRecord* oldest = fDroppableHead[0];
+    if (oldest == NULL || (fDroppableHead[1] != NULL && ageInMs(fDroppableHead[1]->fEnqueueTime, timeNow) > ageInMs(oldest->fEnqueueTime, timeNow))) {
+      oldest = fDroppableHead[1];
+    }
+    if (oldest == NULL) break; // there's nothing that we can drop
+
+    // If this record is too old to be worth sending, then drop it.  Otherwise, if we have too much data queued, then drop
+    // the oldest record - preferring one that's not 'key data':
+    EgressRecord* victim;
+    Boolean isTooOld = ageInMs(oldest->fEnqueueTime, timeNow) > maxDelayMs;
+    if (isTooOld) {
+      victim = oldest;
+    } else if (fEgressQueueStats.numQueuedBytes > RTPInterface::tcpEgressQueueMaxBytes) {
+      victim = fDroppableHead[0] != NULL ? fDroppableHead[0] : fDroppableHead[1];
+    } else {
+      break; // within limits
+    }
+
+    // Drop "victim":
+    ++fEgressQueueStats.numDroppedPackets;
+    if (victim->fIsKeyData) ++fEgressQueueStats.numDroppedKeyDataPackets;
+    fEgressQueueStats.numDroppedBytes += victim->fSize;
+    {
+      // Per-fd rate limit - each socket's drops throttle independently, so a stalled
+      // destination doesn't mask drops on a different one.
+      static thread_local std::map<int, RateLimitEntry> tracker;
+      unsigned long n = rateLimitedLogPerKey(tracker, fOurSocketNum, 5);
+      if (n > 0) {
+	fEnv << "RTPInterface: TCP egress queue on socket " << fOurSocketNum
+	     << " over its limit (" << fEgressQueueStats.numQueuedBytes << " bytes queued"
+	     << (isTooOld ? ", data too old" : "") << "): dropping " << victim->fSize
+	     << "-byte packet on channel " << (int)victim->fData[1]
+	     << (victim->fIsKeyData ? " (key data)" : "");
+	if (n > 1) fEnv << " (" << (unsigned)n << " drops on this socket in last 5s)";
+	fEnv << "\n";
+      }
+    }
+    dequeueEgressRecord(victim);
+    delete victim;
+  }
+}
+
+void SocketDescriptor::dequeueEgressRecord(EgressRecord* record) {
+  noteEgressRecordCannotBeDropped(record); // removes it from its 'droppable' list (if it's on one)
+
+  if (record->fPrev == NULL) {
+    fEgressQueueHead = record->fNext;
+  } else {
+    record->fPrev->fNext = record->fNext;
+  }
+  if (record->fNext == NULL) {
+    fEgressQueueTail = record->fPrev;
+  } else {
+    record->fNext->fPrev = record->fPrev;
+  }
+  record->fNext = record->fPrev = NULL;
+
+  --fEgressQueueStats.numQueuedPackets;
+  fEgressQueueStats.numQueuedBytes -= record->fSize - record->fNumBytesSent;
+}
+
+void SocketDescriptor::noteEgressRecordCannotBeDropped(EgressRecord* record) {
+  record->fMustNotBeDropped = True;
+  if (!record->fIsOnDroppableList) return;
+
+  unsigned i = record->fIsKeyData ? 1 : 0;
+  if (record->fPrevDroppable == NULL) {
+    fDroppableHead[i] = record->fNextDroppable;
+  } else {
+    record->fPrevDroppable->fNextDroppable = record->fNextDroppable;
+  }
+  if (record->fNextDroppable == NULL) {
+    fDroppableTail[i] = record->fPrevDroppable;
+  } else {
+    record->fNextDroppable->fPrevDroppable = record->fPrevDroppable;
+  }
+  record->fNextDroppable = record->fPrevDroppable = NULL;
+  record->fIsOnDroppableList = False;
+}
+
+void SocketDescriptor::updateBackgroundHandling(Boolean isFirstRegistration) {
+  Boolean wantWritable = fEgressQueueHead != NULL;
+  if (wantWritable == fWantWritable && !isFirstRegistration) return; // no change
+
+  fWantWritable = wantWritable;
+  TaskScheduler::BackgroundHandlerProc* handler
+    = (TaskScheduler::BackgroundHandlerProc*)&tcpReadHandler;
+  fEnv.taskScheduler().
+    setBackgroundHandling(fOurSocketNum, SOCKET_READABLE|SOCKET_EXCEPTION|(fWantWritable ? SOCKET_WRITABLE : 0),
+			  handler, this);
+}
+
+
+////////// EgressRecord implementation //////////
+
+EgressRecord::EgressRecord(u_int8_t const* framingHeader, unsigned framingHeaderSize,
+			   u_int8_t const* data, unsigned dataSize, Boolean isKeyData, Boolean mustNotBeDropped)
+  : fNext(NULL), fPrev(NULL), fNextDroppable(NULL), fPrevDroppable(NULL), fIsOnDroppableList(False),
+    fData(new u_int8_t[framingHeaderSize + dataSize]), fSize(framingHeaderSize + dataSize),
+    fNumBytesSent(0), fIsKeyData(isKeyData), fMustNotBeDropped(mustNotBeDropped) {
+  if (framingHeaderSize > 0) memcpy(fData, framingHeader, framingHeaderSize);
+  memcpy(&fData[framingHeaderSize], data, dataSize);
+  gettimeofday(&fEnqueueTime, NULL);
+}
+
+EgressRecord::~EgressRecord() {
+  delete[] fData;
+}
+
+
 ////////// tcpStreamRecord implementation //////////
 
 tcpStreamRecord
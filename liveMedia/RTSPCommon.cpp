@@ -353,7 +353,7 @@ Boolean RTSPOptionIsSupported(char const* commandName, char const* optionsRespon
 }
 
 char const* dateHeader() {
-  static char buf[200];
+  static thread_local char buf[200]; // per-thread, because RTSP servers may run in several threads (see "RTSPServerWorkerGroup")
 #if !defined(_WIN32_WCE)
   time_t tt = time(NULL);
   tm time_tm;
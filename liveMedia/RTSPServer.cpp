@@ -22,6 +22,7 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "RTSPCommon.hh"
 #include "RTSPRegisterSender.hh"
 #include "Base64.hh"
+#include "RTSPServerWorkerGroup.hh"
 #include <GroupsockHelper.hh>
 
 ////////// RTSPServer implementation //////////
@@ -183,7 +184,8 @@ RTSPServer::RTSPServer(UsageEnvironment& env,
     fPendingRegisterOrDeregisterRequests(HashTable::create(ONE_WORD_HASH_KEYS)),
     fRegisterOrDeregisterRequestCounter(0), fAuthDB(authDatabase),
     fAllowStreamingRTPOverTCP(True),
-    fOurConnectionsUseTLS(False), fWeServeSRTP(False) {
+    fOurConnectionsUseTLS(False), fWeServeSRTP(False),
+    fWorkerGroup(NULL), fWorkerIndex(0), fHLSSegmentStore(NULL) {
 }
 
 // A data structure that is used to implement "fTCPStreamingDatabase"
@@ -236,9 +238,19 @@ void RTSPServer::addServerMediaSession(ServerMediaSession* serverMediaSession) {
   if (serverMediaSession != NULL) {
     serverMediaSession->streamingUsesSRTP = fWeServeSRTP;
     serverMediaSession->streamingIsEncrypted = fWeEncryptSRTP;
+#ifndef NO_STD_LIB
+    if (fWorkerGroup != NULL) fWorkerGroup->noteStreamOwner(serverMediaSession->streamName(), fWorkerIndex);
+#endif
   }
 }
 
+void RTSPServer::noteServerMediaSessionRemoval(ServerMediaSession* serverMediaSession) {
+#ifndef NO_STD_LIB
+  // Other workers should no longer hand off connections for this stream to us:
+  if (fWorkerGroup != NULL) fWorkerGroup->forgetStreamOwner(serverMediaSession->streamName(), fWorkerIndex);
+#endif
+}
+
 void RTSPServer::incomingConnectionHandlerHTTPIPv4(void* instance, int /*mask*/) {
   RTSPServer* server = (RTSPServer*)instance;
   server->incomingConnectionHandlerHTTPIPv4();
@@ -334,7 +346,10 @@ RTSPServer::RTSPClientConnection
   : GenericMediaServer::ClientConnection(ourServer, clientSocket, clientAddr, useTLS),
     fOurRTSPServer(ourServer), fClientInputSocket(fOurSocket), fClientOutputSocket(fOurSocket),
     fPOSTSocketTLS(envir()), fAddressFamily(clientAddr.ss_family),
-    fIsActive(True), fRecursionCount(0), fCurrentCSeq(NULL), fOurSessionCookie(NULL), fScheduledDelayedTask(0) {
+    fIsActive(True), fRecursionCount(0), fCurrentCSeq(NULL), fOurSessionCookie(NULL), fScheduledDelayedTask(0),
+    fMayBeHandedOff(True),
+    fHTTPResponseBody(NULL), fHTTPResponseBodySize(0), fHTTPResponseBodyBytesSent(0),
+    fHTTPResponseBodySegment(NULL), fNumDeferredRequestBytes(0) {
   resetRequestBuffer();
 }
 
@@ -347,6 +362,7 @@ RTSPServer::RTSPClientConnection::~RTSPClientConnection() {
   
   closeSocketsRTSP();
   delete[] fCurrentCSeq;
+  clearHTTPResponseBody();
 }
 
 // Handler routines for specific RTSP commands:
@@ -683,11 +699,151 @@ Boolean RTSPServer::RTSPClientConnection
   return True;
 }
 
-void RTSPServer::RTSPClientConnection::handleHTTPCmd_StreamingGET(char const* /*urlSuffix*/, char const* /*fullRequestStr*/) {
+void RTSPServer::RTSPClientConnection::handleHTTPCmd_StreamingGET(char const* urlSuffix, char const* fullRequestStr) {
+  if (fOurRTSPServer.fHLSSegmentStore != NULL && strncmp(fullRequestStr, "GET ", 4) == 0
+      && fClientOutputSocket == fClientInputSocket
+      && fOurRTSPServer.fTCPStreamingDatabase->Lookup((char const*)fClientOutputSocket) == NULL) {
+    // We serve HLS streams from our "HLSSegmentStore".  (But not on a connection that's also being used for
+    // RTP/RTCP-over-TCP streaming, because then our socket's background handling isn't ours to change.)
+    handleHTTPCmd_HLSGET(urlSuffix);
+    return;
+  }
+
   // By default, we don't support requests to access streams via HTTP:
   handleHTTPCmd_notSupported();
 }
 
+void RTSPServer::RTSPClientConnection::handleHTTPCmd_HLSGET(char const* urlSuffix) {
+  HLSSegmentStore* store = fOurRTSPServer.fHLSSegmentStore;
+
+  // Ignore any query string:
+  char name[RTSP_PARAM_STRING_MAX];
+  unsigned nameSize = 0;
+  while (urlSuffix[nameSize] != '\0' && urlSuffix[nameSize] != '?' && nameSize < sizeof name - 1) {
+    name[nameSize] = urlSuffix[nameSize];
+    ++nameSize;
+  }
+  name[nameSize] = '\0';
+
+  if (nameSize > 5 && strcmp(&name[nameSize-5], ".m3u8") == 0) {
+    // A request for a stream's playlist.  Generate it now:
+    name[nameSize-5] = '\0';
+    char* playlist = store->generatePlaylist(name);
+    if (playlist != NULL) {
+      unsigned playlistSize = strlen(playlist);
+      snprintf((char*)fResponseBuffer, sizeof fResponseBuffer,
+	       "HTTP/1.1 200 OK\r\n"
+	       "%s"
+	       "Cache-Control: no-cache\r\n"
+	       "Access-Control-Allow-Origin: *\r\n"
+	       "Content-Type: application/vnd.apple.mpegurl\r\n"
+	       "Content-Length: %u\r\n"
+	       "\r\n",
+	       dateHeader(), playlistSize);
+      setHTTPResponseBody((unsigned char const*)playlist, playlistSize, NULL);
+#ifdef DEBUG
+      fprintf(stderr, "Handled HTTP \"GET\" request for HLS playlist \"%s.m3u8\"\n", name);
+#endif
+      return;
+    }
+  } else {
+    // A request for a segment:
+    HLSSegment* segment = store->lookupSegment(name);
+    if (segment != NULL) {
+      snprintf((char*)fResponseBuffer, sizeof fResponseBuffer,
+	       "HTTP/1.1 200 OK\r\n"
+	       "%s"
+	       "Cache-Control: max-age=%u\r\n" // a segment never changes
+	       "Access-Control-Allow-Origin: *\r\n"
+	       "Content-Type: video/mp2t\r\n"
+	       "Content-Length: %u\r\n"
+	       "\r\n",
+	       dateHeader(), store->windowDuration(), segment->size());
+      setHTTPResponseBody(segment->data(), segment->size(), segment);
+#ifdef DEBUG
+      fprintf(stderr, "Handled HTTP \"GET\" request for HLS segment \"%s\" (%u bytes)\n", name, segment->size());
+#endif
+      return;
+    }
+  }
+
+  // There's no such playlist or segment.  (Unlike "handleHTTPCmd_notFound()", we include a "Content-Length:" header,
+  // so that a client that's keeping the connection open for further requests won't wait for a body.)
+  snprintf((char*)fResponseBuffer, sizeof fResponseBuffer,
+	   "HTTP/1.1 404 Not Found\r\n"
+	   "%s"
+	   "Access-Control-Allow-Origin: *\r\n"
+	   "Content-Length: 0\r\n"
+	   "\r\n",
+	   dateHeader());
+}
+
+void RTSPServer::RTSPClientConnection
+::setHTTPResponseBody(unsigned char const* body, unsigned bodySize, HLSSegment* segment) {
+  clearHTTPResponseBody();
+
+  fHTTPResponseBody = body;
+  fHTTPResponseBodySize = bodySize;
+  fHTTPResponseBodyBytesSent = 0;
+  fHTTPResponseBodySegment = segment;
+}
+
+Boolean RTSPServer::RTSPClientConnection::sendHTTPResponseBody() {
+  // Write as much of the body as we can, without blocking:
+  while (fHTTPResponseBodyBytesSent < fHTTPResponseBodySize) {
+    char const* data = (char const*)&fHTTPResponseBody[fHTTPResponseBodyBytesSent];
+    unsigned numBytesToWrite = fHTTPResponseBodySize - fHTTPResponseBodyBytesSent;
+    int numBytesWritten = fOutputTLS->isNeeded
+      ? fOutputTLS->write(data, numBytesToWrite)
+      : send(fClientOutputSocket, data, numBytesToWrite, MSG_NOSIGNAL);
+    if (numBytesWritten <= 0) {
+      if (numBytesWritten < 0 && envir().getErrno() != EAGAIN && envir().getErrno() != EWOULDBLOCK) {
+	// The client has gone away (or something else went wrong).  Give up on this connection:
+	fIsActive = False;
+	break;
+      }
+      return False; // our socket's OS buffer is full; we'll continue when it becomes writable
+    }
+    fHTTPResponseBodyBytesSent += numBytesWritten;
+  }
+
+  clearHTTPResponseBody();
+  return True;
+}
+
+void RTSPServer::RTSPClientConnection::httpResponseBodyHandler(void* instance, int /*mask*/) {
+  RTSPClientConnection* connection = (RTSPClientConnection*)instance;
+  connection->httpResponseBodyHandler1();
+}
+
+void RTSPServer::RTSPClientConnection::httpResponseBodyHandler1() {
+  if (!sendHTTPResponseBody()) return; // we'll get called again when our socket is next writable
+
+  if (!fIsActive) {
+    handleRequestBytes(-1); // hack: terminates this connection
+    return;
+  }
+
+  // Resume handling requests on this connection - beginning with any that were pipelined behind the last one:
+  envir().taskScheduler().setBackgroundHandling(fClientInputSocket, SOCKET_READABLE|SOCKET_EXCEPTION,
+						incomingRequestHandler, this);
+  if (fNumDeferredRequestBytes > 0) {
+    unsigned numBytes = fNumDeferredRequestBytes;
+    fNumDeferredRequestBytes = 0;
+    handleRequestBytes(numBytes);
+  }
+}
+
+void RTSPServer::RTSPClientConnection::clearHTTPResponseBody() {
+  if (fHTTPResponseBodySegment != NULL) {
+    fHTTPResponseBodySegment->decrementReferenceCount();
+  } else {
+    delete[] (char*)fHTTPResponseBody;
+  }
+  fHTTPResponseBody = NULL; fHTTPResponseBodySegment = NULL;
+  fHTTPResponseBodySize = fHTTPResponseBodyBytesSent = 0;
+}
+
 void RTSPServer::RTSPClientConnection::resetRequestBuffer() {
   ClientConnection::resetRequestBuffer();
   
@@ -855,6 +1011,14 @@ void RTSPServer::RTSPClientConnection::handleRequestBytes(int newBytesRead) {
       // If there was a "Content-Length:" header, then make sure we've received all of the data that it specified:
       if (ptr + newBytesRead < tmpPtr + 2 + contentLength) break; // we still need more data; subsequent reads will give it to us 
       
+      // If our server is part of a "RTSPServerWorkerGroup", and this request is for a stream that's
+      // owned by another worker, then hand off this connection (including this request) to that worker:
+      if (fOurRTSPServer.fWorkerGroup != NULL && sessionIdStr[0] == '\0'
+	  && handOffToStreamOwner(cmdName, urlPreSuffix, urlSuffix)) {
+	fIsActive = False; // we no longer own our socket; this causes us to get deleted
+	break;
+      }
+
       // If the request included a "Session:" id, and it refers to a client session that's
       // current ongoing, then use this command to indicate 'liveness' on that client session:
       Boolean const requestIncludedSessionId = sessionIdStr[0] != '\0';
@@ -935,6 +1099,7 @@ void RTSPServer::RTSPClientConnection::handleRequestBytes(int newBytesRead) {
 	    areAuthenticated = False;
 	  }
 	}
+	fMayBeHandedOff = False; // because our socket might now be used for RTP/RTCP-over-TCP
 	if (clientSession != NULL) {
 	  clientSession->handleCmd_SETUP(this, urlPreSuffix, urlSuffix, (char const*)fRequestBuffer);
 	  playAfterSetup = clientSession->fStreamAfterSETUP;
@@ -1036,11 +1201,19 @@ void RTSPServer::RTSPClientConnection::handleRequestBytes(int newBytesRead) {
     fprintf(stderr, "sending response: %s", fResponseBuffer);
 #endif
     unsigned const numBytesToWrite = strlen((char*)fResponseBuffer);
-    if (fOutputTLS->isNeeded) {
+    if (RTPInterface::appendToTCPEgressQueue(envir(), fClientOutputSocket, fResponseBuffer, numBytesToWrite)) {
+      // RTP/RTCP-over-TCP data was waiting to be written to our socket, so our response got queued behind it.
+    } else if (fOutputTLS->isNeeded) {
         fOutputTLS->write((char const*)fResponseBuffer, numBytesToWrite);
     } else {
         send(fClientOutputSocket, (char const*)fResponseBuffer, numBytesToWrite, MSG_NOSIGNAL);
    }
+    if (fHTTPResponseBody != NULL && !sendHTTPResponseBody()) {
+      // Our response has a body that we couldn't send all of yet.  Send the rest when our socket becomes writable,
+      // and until then, don't read any more requests:
+      envir().taskScheduler().setBackgroundHandling(fClientOutputSocket, SOCKET_WRITABLE|SOCKET_EXCEPTION,
+						    httpResponseBodyHandler, this);
+    }
     
     if (playAfterSetup) {
       // The client has asked for streaming to commence now, rather than after a
@@ -1057,6 +1230,11 @@ void RTSPServer::RTSPClientConnection::handleRequestBytes(int newBytesRead) {
     if (numBytesRemaining > 0) {
       memmove(fRequestBuffer, &fRequestBuffer[requestSize], numBytesRemaining);
       newBytesRead = numBytesRemaining;
+      if (fHTTPResponseBody != NULL) {
+	// We're still sending the previous response's body, so handle this (pipelined) request later:
+	fNumDeferredRequestBytes = numBytesRemaining;
+	break;
+      }
     }
   } while (numBytesRemaining > 0);
   
@@ -1293,6 +1471,55 @@ void RTSPServer::RTSPClientConnection
   }
 }
 
+Boolean RTSPServer::RTSPClientConnection
+::handOffToStreamOwner(char const* cmdName, char const* urlPreSuffix, char const* urlSuffix) {
+#ifndef NO_STD_LIB
+  RTSPServerWorkerGroup* workerGroup = fOurRTSPServer.fWorkerGroup;
+  if (workerGroup == NULL || !fMayBeHandedOff) return False;
+
+  // Hand off only a 'fresh' connection (i.e., not one that's used for RTSP-over-HTTP tunneling, or TLS,
+  // or that is in the middle of handling another request).  Also, only "DESCRIBE" and "SETUP" name streams:
+  if (fClientInputSocket != fClientOutputSocket || fOurRTSPServer.fOurConnectionsUseTLS
+      || fRecursionCount > 1 || fScheduledDelayedTask > 0) return False;
+  if (strcmp(cmdName, "DESCRIBE") != 0 && strcmp(cmdName, "SETUP") != 0) return False;
+
+  // As in "RTSPClientSession::handleCmd_SETUP()", the stream name can be either "urlPreSuffix", or
+  // "urlPreSuffix/urlSuffix" (or just "urlSuffix", if "urlPreSuffix" is empty):
+  char urlTotalSuffix[2*RTSP_PARAM_STRING_MAX];
+  urlTotalSuffix[0] = '\0';
+  if (urlPreSuffix[0] != '\0') {
+    strcat(urlTotalSuffix, urlPreSuffix);
+    strcat(urlTotalSuffix, "/");
+  }
+  strcat(urlTotalSuffix, urlSuffix);
+  char const* streamNames[2] = { urlPreSuffix, urlTotalSuffix };
+
+  int ownerIndex = -1;
+  for (unsigned i = 0; i < 2; ++i) {
+    if (streamNames[i][0] == '\0') continue;
+    if (fOurRTSPServer.getServerMediaSession(streamNames[i]) != NULL) return False; // we have it ourself
+
+    if (ownerIndex < 0) ownerIndex = workerGroup->lookupStreamOwner(streamNames[i]);
+  }
+  if (ownerIndex < 0 || (unsigned)ownerIndex == fOurRTSPServer.fWorkerIndex) return False;
+
+  // Stop handling our socket before the other worker's thread starts to:
+  envir().taskScheduler().disableBackgroundHandling(fClientInputSocket);
+  if (!workerGroup->handOffConnection((unsigned)ownerIndex, fClientInputSocket, fClientAddr,
+				      fRequestBuffer, fRequestBytesAlreadySeen)) {
+    envir().taskScheduler().setBackgroundHandling(fClientInputSocket, SOCKET_READABLE|SOCKET_EXCEPTION,
+						  incomingRequestHandler, this);
+    return False;
+  }
+
+  // The socket now belongs to the other worker, so make sure that we don't close it:
+  fClientInputSocket = fClientOutputSocket = -1;
+  return True;
+#else
+  return False;
+#endif
+}
+
 
 ////////// RTSPServer::RTSPClientSession implementation //////////
 
@@ -2153,3 +2380,34 @@ GenericMediaServer::ClientSession*
 RTSPServer::createNewClientSession(u_int32_t sessionId) {
   return new RTSPClientSession(*this, sessionId);
 }
+
+void RTSPServer::setWorkerGroup(RTSPServerWorkerGroup* workerGroup, unsigned ourWorkerIndex) {
+  fWorkerGroup = workerGroup;
+  fWorkerIndex = ourWorkerIndex;
+
+#ifndef NO_STD_LIB
+  if (fWorkerGroup != NULL) {
+    // Note the streams that we already have:
+    ServerMediaSessionIterator iter(*this);
+    ServerMediaSession* serverMediaSession;
+    while ((serverMediaSession = iter.next()) != NULL) {
+      fWorkerGroup->noteStreamOwner(serverMediaSession->streamName(), fWorkerIndex);
+    }
+  }
+#endif
+}
+
+void RTSPServer
+::adoptHandedOffConnection(int clientSocket, struct sockaddr_storage const& clientAddr,
+			   unsigned char const* requestBytes, unsigned numRequestBytes) {
+  RTSPClientConnection* clientConnection
+    = (RTSPClientConnection*)createNewClientConnection(clientSocket, clientAddr);
+  if (clientConnection == NULL) return;
+  clientConnection->fMayBeHandedOff = False; // so that it doesn't get handed off again
+
+  // Handle the request bytes that the original worker had already read:
+  if (numRequestBytes > 0 && numRequestBytes < clientConnection->fRequestBufferBytesLeft) {
+    memmove(&clientConnection->fRequestBuffer[clientConnection->fRequestBytesAlreadySeen], requestBytes, numRequestBytes);
+    clientConnection->handleRequestBytes(numRequestBytes);
+  }
+}
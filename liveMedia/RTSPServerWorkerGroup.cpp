@@ -0,0 +1,222 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2026 Live Networks, Inc.  All rights reserved.
+// A group of "RTSPServer"s - each running in its own thread, with its own "UsageEnvironment" and
+// "TaskScheduler" - that share a single port, and that each own a disjoint set of streams.
+// Implementation
+
+#include "RTSPServerWorkerGroup.hh"
+
+#ifndef NO_STD_LIB
+#include <GroupsockHelper.hh>
+
+// A connection that's waiting to be picked up by another worker's thread:
+class RTSPServerWorkerGroup::HandOffRecord {
+public:
+  HandOffRecord(int clientSocket, struct sockaddr_storage const& clientAddr,
+		unsigned char const* requestBytes, unsigned numRequestBytes)
+    : fNext(NULL), fClientSocket(clientSocket), fClientAddr(clientAddr),
+      fRequestBytes(new unsigned char[numRequestBytes]), fNumRequestBytes(numRequestBytes) {
+    memmove(fRequestBytes, requestBytes, numRequestBytes);
+  }
+  virtual ~HandOffRecord() {
+    delete[] fRequestBytes;
+  }
+
+  HandOffRecord* fNext;
+  int fClientSocket;
+  struct sockaddr_storage fClientAddr;
+  unsigned char* fRequestBytes;
+  unsigned fNumRequestBytes;
+};
+
+RTSPServerWorkerGroup::RTSPServerWorkerGroup(unsigned numWorkers)
+  : fNumWorkers(numWorkers), fWorkers(new Worker[numWorkers]),
+    fStreamOwners(HashTable::create(STRING_HASH_KEYS)) {
+  for (unsigned i = 0; i < fNumWorkers; ++i) {
+    fWorkers[i].fServer = NULL;
+    fWorkers[i].fHandOffTrigger = 0;
+    fWorkers[i].fFirstPending = fWorkers[i].fLastPending = NULL;
+    fWorkers[i].fOurGroup = this;
+    fWorkers[i].fIndex = i;
+  }
+}
+
+RTSPServerWorkerGroup::~RTSPServerWorkerGroup() {
+  delete[] fWorkers;
+  delete fStreamOwners;
+}
+
+Boolean RTSPServerWorkerGroup::addWorker(unsigned workerIndex, RTSPServer& rtspServer) {
+  if (workerIndex >= fNumWorkers) return False;
+
+  // Note: We create the event trigger here (rather than in the constructor), because it must be created
+  // by the thread that runs the worker's event loop:
+  EventTriggerId handOffTrigger = rtspServer.envir().taskScheduler().createEventTrigger(incomingHandOffHandler);
+  if (handOffTrigger == 0) return False;
+
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    Worker& worker = fWorkers[workerIndex];
+    if (worker.fServer != NULL) {
+      rtspServer.envir().taskScheduler().deleteEventTrigger(handOffTrigger);
+      return False;
+    }
+    worker.fServer = &rtspServer;
+    worker.fHandOffTrigger = handOffTrigger;
+  }
+
+  rtspServer.setWorkerGroup(this, workerIndex); // also notes the owner of any streams that it already has
+  return True;
+}
+
+void RTSPServerWorkerGroup::removeWorker(unsigned workerIndex) {
+  if (workerIndex >= fNumWorkers) return;
+
+  RTSPServer* server;
+  EventTriggerId handOffTrigger;
+  HandOffRecord* pending;
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    Worker& worker = fWorkers[workerIndex];
+    server = worker.fServer;
+    handOffTrigger = worker.fHandOffTrigger;
+    pending = worker.fFirstPending;
+
+    worker.fServer = NULL;
+    worker.fHandOffTrigger = 0;
+    worker.fFirstPending = worker.fLastPending = NULL;
+
+    // Also forget the streams that this worker owned.  (We restart the iteration after each removal,
+    // because removing an entry might invalidate the iterator.)
+    Boolean removedOne;
+    do {
+      removedOne = False;
+      HashTable::Iterator* iter = HashTable::Iterator::create(*fStreamOwners);
+      char const* streamName;
+      void* value;
+      while ((value = iter->next(streamName)) != NULL) {
+	if ((uintptr_t)value == workerIndex+1) {
+	  fStreamOwners->Remove(streamName);
+	  removedOne = True;
+	  break;
+	}
+      }
+      delete iter;
+    } while (removedOne);
+  }
+  if (server == NULL) return;
+
+  server->setWorkerGroup(NULL, 0);
+  server->envir().taskScheduler().deleteEventTrigger(handOffTrigger);
+
+  // Close any connections that were handed off to this worker, but not yet picked up:
+  while (pending != NULL) {
+    HandOffRecord* next = pending->fNext;
+    ::closeSocket(pending->fClientSocket);
+    delete pending;
+    pending = next;
+  }
+}
+
+void RTSPServerWorkerGroup::noteStreamOwner(char const* streamName, unsigned workerIndex) {
+  if (streamName == NULL || workerIndex >= fNumWorkers) return;
+
+  std::lock_guard<std::mutex> lock(fMutex);
+  fStreamOwners->Add(streamName, (void*)(uintptr_t)(workerIndex+1));
+}
+
+void RTSPServerWorkerGroup::forgetStreamOwner(char const* streamName, unsigned workerIndex) {
+  if (streamName == NULL) return;
+
+  std::lock_guard<std::mutex> lock(fMutex);
+  if ((uintptr_t)(fStreamOwners->Lookup(streamName)) == workerIndex+1) fStreamOwners->Remove(streamName);
+}
+
+int RTSPServerWorkerGroup::lookupStreamOwner(char const* streamName) {
+  if (streamName == NULL) return -1;
+
+  std::lock_guard<std::mutex> lock(fMutex);
+  uintptr_t value = (uintptr_t)(fStreamOwners->Lookup(streamName));
+  if (value == 0 || fWorkers[value-1].fServer == NULL) return -1;
+
+  return (int)(value-1);
+}
+
+Boolean RTSPServerWorkerGroup
+::handOffConnection(unsigned toWorkerIndex, int clientSocket, struct sockaddr_storage const& clientAddr,
+		    unsigned char const* requestBytes, unsigned numRequestBytes) {
+  if (toWorkerIndex >= fNumWorkers) return False;
+
+  HandOffRecord* record = new HandOffRecord(clientSocket, clientAddr, requestBytes, numRequestBytes);
+  EventTriggerId handOffTrigger;
+  TaskScheduler* scheduler;
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    Worker& worker = fWorkers[toWorkerIndex];
+    if (worker.fServer == NULL) {
+      delete record;
+      return False;
+    }
+
+    if (worker.fLastPending == NULL) {
+      worker.fFirstPending = record;
+    } else {
+      worker.fLastPending->fNext = record;
+    }
+    worker.fLastPending = record;
+
+    handOffTrigger = worker.fHandOffTrigger;
+    scheduler = &worker.fServer->envir().taskScheduler();
+  }
+
+  // Note: Several threads might trigger this event concurrently.  That's OK, because we always use the same
+  // 'client data', and the handler empties the whole queue of pending connections each time it's called.
+  scheduler->triggerEvent(handOffTrigger, &fWorkers[toWorkerIndex]);
+  return True;
+}
+
+void RTSPServerWorkerGroup::incomingHandOffHandler(void* clientData) {
+  Worker* worker = (Worker*)clientData;
+  worker->fOurGroup->incomingHandOffHandler1(worker->fIndex);
+}
+
+void RTSPServerWorkerGroup::incomingHandOffHandler1(unsigned workerIndex) {
+  RTSPServer* server;
+  HandOffRecord* pending;
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    Worker& worker = fWorkers[workerIndex];
+    server = worker.fServer;
+    pending = worker.fFirstPending;
+    worker.fFirstPending = worker.fLastPending = NULL;
+  }
+
+  while (pending != NULL) {
+    HandOffRecord* next = pending->fNext;
+    if (server != NULL) {
+      server->adoptHandedOffConnection(pending->fClientSocket, pending->fClientAddr,
+				       pending->fRequestBytes, pending->fNumRequestBytes);
+    } else {
+      ::closeSocket(pending->fClientSocket);
+    }
+    delete pending;
+    pending = next;
+  }
+}
+
+#endif
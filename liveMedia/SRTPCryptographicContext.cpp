@@ -22,7 +22,6 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "SRTPCryptographicContext.hh"
 #ifndef NO_OPENSSL
 #include "HMAC_SHA1.hh"
-#include <openssl/evp.h>
 #endif
 
 #ifdef DEBUG
@@ -38,12 +37,22 @@ SRTPCryptographicContext
     fSRTCPIndex(0) {
   // Begin by doing a key derivation, to generate the keying data that we need:
   performKeyDerivation();
+
+  // Then set up the (long-lived) cipher and HMAC state for the derived keys:
+  initCryptoState(fDerivedKeys.srtp);
+  initCryptoState(fDerivedKeys.srtcp);
+  fDigestContext = EVP_MD_CTX_create();
 #else
   {
 #endif
 }
 
 SRTPCryptographicContext::~SRTPCryptographicContext() {
+#ifndef NO_OPENSSL
+  freeCryptoState(fDerivedKeys.srtp);
+  freeCryptoState(fDerivedKeys.srtcp);
+  if (fDigestContext != NULL) EVP_MD_CTX_destroy(fDigestContext);
+#endif
 }
 
 Boolean SRTPCryptographicContext
@@ -458,9 +467,7 @@ unsigned SRTPCryptographicContext
 			    u_int8_t* resultAuthenticationTag) {
   if (SRTP_AUTH_TAG_LENGTH > SHA1_DIGEST_LEN) return 0; // sanity check; shouldn't happen
   u_int8_t computedAuthTag[SHA1_DIGEST_LEN];
-  HMAC_SHA1(keysToUse.authKey, sizeof keysToUse.authKey,
-	    dataToAuthenticate, numBytesToAuthenticate,
-	    computedAuthTag);
+  computeAuthenticationDigest(keysToUse, dataToAuthenticate, numBytesToAuthenticate, computedAuthTag);
 
   for (unsigned i = 0; i < SRTP_AUTH_TAG_LENGTH; ++i) {
     resultAuthenticationTag[i] = computedAuthTag[i];
@@ -474,9 +481,7 @@ Boolean SRTPCryptographicContext
 			  u_int8_t const* dataToAuthenticate, unsigned numBytesToAuthenticate,
 			  u_int8_t const* authenticationTag) {
   u_int8_t computedAuthTag[SHA1_DIGEST_LEN];
-  HMAC_SHA1(keysToUse.authKey, sizeof keysToUse.authKey,
-	    dataToAuthenticate, numBytesToAuthenticate,
-	    computedAuthTag);
+  computeAuthenticationDigest(keysToUse, dataToAuthenticate, numBytesToAuthenticate, computedAuthTag);
 
   if (SRTP_AUTH_TAG_LENGTH > SHA1_DIGEST_LEN) return False; // sanity check
   for (unsigned i = 0; i < SRTP_AUTH_TAG_LENGTH; ++i) {
@@ -498,37 +503,80 @@ Boolean SRTPCryptographicContext
 
   iv[sizeof iv-8] ^= index>>40; iv[sizeof iv-7] ^= index>>32; iv[sizeof iv-6] ^= index>>24; iv[sizeof iv-5] ^= index>>16; iv[sizeof iv-4] ^= index>>8; iv[sizeof iv-3] ^= index;
 
-  // Now generate as many blocks of the keystream as we need, by repeatedly encrypting
-  // the IV using our cipher key.  (After each step, we increment the IV by 1.)
-  // We then XOR the keystream into the provided data, to do the en/decryption.
-  do {
-    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
-    if (ctx == NULL) break;
-    
-    if (EVP_EncryptInit(ctx, EVP_aes_128_ecb(), keys.cipherKey, NULL/*no IV*/) != 1) break;
-        // Note: We use ECB mode here, because we're using our "iv" as plaintext
+  // Now use AES in counter mode, with "iv" as the initial counter block, to generate the keystream
+  // and XOR it into the provided data (in place), to do the en/decryption.  (Counter mode increments
+  // the whole 16-byte counter block by 1 for each successive keystream block - as RFC 3711 requires.)
+  // Doing the whole payload in one call lets OpenSSL pipeline the AES rounds (e.g., using AES-NI).
+  if (keys.cipherContext == NULL) return; // "initCryptoState()" failed
+  if (EVP_EncryptInit_ex(keys.cipherContext, NULL, NULL, NULL, iv) != 1) return; // same key; new counter
+  int numBytesEncrypted;
+  EVP_EncryptUpdate(keys.cipherContext, data, &numBytesEncrypted, data, (int)numDataBytes);
+}
 
-    while (numDataBytes > 0) {
-      u_int8_t keyStream[SRTP_CIPHER_KEY_LENGTH];
-      int numBytesEncrypted;
-      if (EVP_EncryptUpdate(ctx, keyStream, &numBytesEncrypted, iv, SRTP_CIPHER_KEY_LENGTH) != 1) break;
-
-      unsigned numBytesToUse
-	= numDataBytes < numBytesEncrypted ? numDataBytes : numBytesEncrypted;
-      for (unsigned i = 0; i < numBytesToUse; ++i) data[i] ^= keyStream[i];
-      data += numBytesToUse;
-      numDataBytes -= numBytesToUse;
-
-      // Increment the IV by 1:
-      u_int8_t* ptr = &iv[sizeof iv];
-      do {
-	--ptr;
-	++*ptr;
-      } while (*ptr == 0x00);
-    }
+void SRTPCryptographicContext
+::computeAuthenticationDigest(derivedKeys& keysToUse,
+			      u_int8_t const* dataToAuthenticate, unsigned numBytesToAuthenticate,
+			      u_int8_t* resultDigest) {
+  if (keysToUse.authInnerContext == NULL || keysToUse.authOuterContext == NULL || fDigestContext == NULL) {
+    // "initCryptoState()" failed; compute the HMAC from scratch instead:
+    HMAC_SHA1(keysToUse.authKey, sizeof keysToUse.authKey,
+	      dataToAuthenticate, numBytesToAuthenticate,
+	      resultDigest);
+    return;
+  }
 
-    EVP_CIPHER_CTX_free(ctx);
-  } while (0);
+  // HMAC(K, m) = H((K^opad) || H((K^ipad) || m)), where the hashes of (K^ipad) and (K^opad) - the first
+  // block of each - were already done (by "initCryptoState()"):
+  u_int8_t innerDigest[SHA1_DIGEST_LEN];
+  EVP_MD_CTX_copy_ex(fDigestContext, keysToUse.authInnerContext);
+  EVP_DigestUpdate(fDigestContext, dataToAuthenticate, numBytesToAuthenticate);
+  EVP_DigestFinal_ex(fDigestContext, innerDigest, NULL);
+
+  EVP_MD_CTX_copy_ex(fDigestContext, keysToUse.authOuterContext);
+  EVP_DigestUpdate(fDigestContext, innerDigest, sizeof innerDigest);
+  EVP_DigestFinal_ex(fDigestContext, resultDigest, NULL);
+}
+
+void SRTPCryptographicContext::initCryptoState(derivedKeys& keys) {
+  // The cipher: AES-128 in counter mode, keyed once with our derived cipher key.
+  // (Each packet then supplies just its own initial counter block - see "cryptData()".)
+  keys.cipherContext = EVP_CIPHER_CTX_new();
+  if (keys.cipherContext != NULL
+      && EVP_EncryptInit_ex(keys.cipherContext, EVP_aes_128_ctr(), NULL, keys.cipherKey, NULL) != 1) {
+    EVP_CIPHER_CTX_free(keys.cipherContext); keys.cipherContext = NULL;
+  }
+
+  // The HMAC: SHA-1 states that have already hashed the key XORed with the inner and outer pads.
+  // (Our auth key is shorter than HMAC_BLOCK_SIZE, so it doesn't need hashing first.)
+  u_int8_t ipad[HMAC_BLOCK_SIZE];
+  u_int8_t opad[HMAC_BLOCK_SIZE];
+  unsigned i;
+  for (i = 0; i < sizeof keys.authKey; ++i) {
+    ipad[i] = keys.authKey[i]^0x36;
+    opad[i] = keys.authKey[i]^0x5c;
+  }
+  for (; i < HMAC_BLOCK_SIZE; ++i) {
+    ipad[i] = 0x36;
+    opad[i] = 0x5c;
+  }
+
+  keys.authInnerContext = EVP_MD_CTX_create();
+  keys.authOuterContext = EVP_MD_CTX_create();
+  if (keys.authInnerContext == NULL || keys.authOuterContext == NULL
+      || EVP_DigestInit_ex(keys.authInnerContext, EVP_sha1(), NULL) != 1
+      || EVP_DigestUpdate(keys.authInnerContext, ipad, sizeof ipad) != 1
+      || EVP_DigestInit_ex(keys.authOuterContext, EVP_sha1(), NULL) != 1
+      || EVP_DigestUpdate(keys.authOuterContext, opad, sizeof opad) != 1) {
+    if (keys.authInnerContext != NULL) { EVP_MD_CTX_destroy(keys.authInnerContext); keys.authInnerContext = NULL; }
+    if (keys.authOuterContext != NULL) { EVP_MD_CTX_destroy(keys.authOuterContext); keys.authOuterContext = NULL; }
+  }
+}
+
+void SRTPCryptographicContext::freeCryptoState(derivedKeys& keys) {
+  if (keys.cipherContext != NULL) EVP_CIPHER_CTX_free(keys.cipherContext);
+  if (keys.authInnerContext != NULL) EVP_MD_CTX_destroy(keys.authInnerContext);
+  if (keys.authOuterContext != NULL) EVP_MD_CTX_destroy(keys.authOuterContext);
+  keys.cipherContext = NULL; keys.authInnerContext = keys.authOuterContext = NULL;
 }
 
 void SRTPCryptographicContext::performKeyDerivation() {
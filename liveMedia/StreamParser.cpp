@@ -23,8 +23,6 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include <string.h>
 #include <stdlib.h>
 
-#define BANK_SIZE 600000
-
 void StreamParser::flushInput() {
   fCurParserIndex = fSavedParserIndex = 0;
   fSavedRemainingUnparsedBits = fRemainingUnparsedBits = 0;
@@ -43,16 +41,18 @@ StreamParser::StreamParser(FramedSource* inputSource,
     fSavedParserIndex(0), fSavedRemainingUnparsedBits(0),
     fCurParserIndex(0), fRemainingUnparsedBits(0),
     fTotNumValidBytes(0), fHaveSeenEOF(False) {
-  fBank[0] = new unsigned char[BANK_SIZE];
-  fBank[1] = new unsigned char[BANK_SIZE];
-  fCurBankNum = 0;
-  fCurBank = fBank[fCurBankNum];
+  fBankSize = STREAM_PARSER_INITIAL_BANK_SIZE;
+  fBank = new unsigned char[fBankSize];
+  fPeakBankUsage = 0;
 
   fLastSeenPresentationTime.tv_sec = 0; fLastSeenPresentationTime.tv_usec = 0;
 }
 
 StreamParser::~StreamParser() {
-  delete[] fBank[0]; delete[] fBank[1];
+#ifdef DEBUG
+  fprintf(stderr, "StreamParser[%p]: final bank size %u; peak bank usage %u\n", this, fBankSize, fPeakBankUsage);
+#endif
+  delete[] fBank;
 }
 
 void StreamParser::saveParserState() {
@@ -112,8 +112,104 @@ unsigned StreamParser::getBits(unsigned numBits) {
   }
 }
 
-unsigned StreamParser::bankSize() const {
-  return BANK_SIZE;
+////////// Start code scanning //////////
+
+// A 'start code scanner' returns the smallest "i" (with i+3 <= size) for which
+//     p[i] == 0 && p[i+1] == 0 && (p[i+2]&mask) == value
+// or "size" if there is none.
+typedef unsigned (startCodeScanner)(u_int8_t const* p, unsigned size, u_int8_t mask, u_int8_t value);
+
+static unsigned scanForStartCode_scalar(u_int8_t const* p, unsigned size, u_int8_t mask, u_int8_t value) {
+  unsigned i = 0;
+  while (i + 3 <= size) {
+    if (p[i+1] != 0) {
+      // Neither "i" nor "i+1" can begin a start code:
+      i += 2;
+    } else if (p[i] == 0 && (p[i+2]&mask) == value) {
+      return i;
+    } else {
+      ++i;
+    }
+  }
+
+  return size;
+}
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__) && defined(__GNUC__) && !defined(NO_SIMD_START_CODE_SCAN)
+#define HAVE_SIMD_START_CODE_SCAN 1
+#include <immintrin.h>
+
+// SSE2 (always present on x86-64): Test 16 positions at a time, using three overlapping unaligned loads.
+static unsigned scanForStartCode_sse2(u_int8_t const* p, unsigned size, u_int8_t mask, u_int8_t value) {
+  __m128i const zero = _mm_setzero_si128();
+  __m128i const maskV = _mm_set1_epi8((char)mask);
+  __m128i const valueV = _mm_set1_epi8((char)value);
+
+  unsigned i = 0;
+  for (; i + 16 + 2 <= size; i += 16) {
+    __m128i b0 = _mm_loadu_si128((__m128i const*)&p[i]);
+    __m128i b1 = _mm_loadu_si128((__m128i const*)&p[i+1]);
+    __m128i zeroPairs = _mm_and_si128(_mm_cmpeq_epi8(b0, zero), _mm_cmpeq_epi8(b1, zero));
+    if (_mm_movemask_epi8(zeroPairs) == 0) continue; // common case
+
+    __m128i b2 = _mm_loadu_si128((__m128i const*)&p[i+2]);
+    __m128i hits = _mm_and_si128(zeroPairs, _mm_cmpeq_epi8(_mm_and_si128(b2, maskV), valueV));
+    unsigned bits = (unsigned)_mm_movemask_epi8(hits);
+    if (bits != 0) return i + __builtin_ctz(bits);
+  }
+
+  return i + scanForStartCode_scalar(&p[i], size - i, mask, value);
+}
+
+// AVX2 (if the CPU has it): As above, but 32 positions at a time.
+__attribute__((target("avx2")))
+static unsigned scanForStartCode_avx2(u_int8_t const* p, unsigned size, u_int8_t mask, u_int8_t value) {
+  __m256i const zero = _mm256_setzero_si256();
+  __m256i const maskV = _mm256_set1_epi8((char)mask);
+  __m256i const valueV = _mm256_set1_epi8((char)value);
+
+  unsigned i = 0;
+  for (; i + 32 + 2 <= size; i += 32) {
+    __m256i b0 = _mm256_loadu_si256((__m256i const*)&p[i]);
+    __m256i b1 = _mm256_loadu_si256((__m256i const*)&p[i+1]);
+    __m256i zeroPairs = _mm256_and_si256(_mm256_cmpeq_epi8(b0, zero), _mm256_cmpeq_epi8(b1, zero));
+    if (_mm256_testz_si256(zeroPairs, zeroPairs)) continue; // common case
+
+    __m256i b2 = _mm256_loadu_si256((__m256i const*)&p[i+2]);
+    __m256i hits = _mm256_and_si256(zeroPairs, _mm256_cmpeq_epi8(_mm256_and_si256(b2, maskV), valueV));
+    unsigned bits = (unsigned)_mm256_movemask_epi8(hits);
+    if (bits != 0) return i + __builtin_ctz(bits);
+  }
+
+  return i + scanForStartCode_sse2(&p[i], size - i, mask, value);
+}
+#endif
+
+static startCodeScanner* chooseStartCodeScanner() {
+#ifdef HAVE_SIMD_START_CODE_SCAN
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) return scanForStartCode_avx2;
+  return scanForStartCode_sse2;
+#else
+  return scanForStartCode_scalar;
+#endif
+}
+
+static startCodeScanner* ourStartCodeScanner = chooseStartCodeScanner();
+
+Boolean StreamParser::findStartCode(unsigned char const*& ptr, unsigned& numBytes,
+				    u_int8_t lastByteMask, u_int8_t lastByteValue) {
+  ptr = nextToParse();
+  unsigned numValidBytes = fTotNumValidBytes - fCurParserIndex;
+
+  unsigned offset = (*ourStartCodeScanner)(ptr, numValidBytes, lastByteMask, lastByteValue);
+  if (offset < numValidBytes) {
+    numBytes = offset;
+    return True;
+  }
+
+  numBytes = numValidBytes > 3 ? numValidBytes - 3 : 0;
+  return False;
 }
 
 #define NO_MORE_BUFFERED_INPUT 1
@@ -125,34 +221,58 @@ void StreamParser::ensureValidBytes1(unsigned numBytesNeeded) {
   if (maxInputFrameSize > numBytesNeeded) numBytesNeeded = maxInputFrameSize;
 
   // First, check whether these new bytes would overflow the current
-  // bank.  If so, start using a new bank now.
-  if (fCurParserIndex + numBytesNeeded > BANK_SIZE) {
-    // Swap banks, but save any still-needed bytes from the old bank:
+  // bank.  If so, move any still-needed bytes to the start of the bank
+  // (discarding those before the saved parse position), growing the
+  // bank if these bytes would still fill more than half of it.
+  // (Growing like this keeps the amount of data that we move to no more
+  //  than the amount that we've read since the last move.)
+  if (fCurParserIndex + numBytesNeeded > fBankSize) {
     unsigned numBytesToSave = fTotNumValidBytes - fSavedParserIndex;
     unsigned char const* from = &curBank()[fSavedParserIndex];
+    unsigned newCurParserIndex = fCurParserIndex - fSavedParserIndex;
+
+    unsigned newBankSize = fBankSize;
+    while ((newCurParserIndex + numBytesNeeded > newBankSize || numBytesToSave > newBankSize/2)
+	   && newBankSize < STREAM_PARSER_MAX_BANK_SIZE) {
+      newBankSize *= 2;
+      if (newBankSize > STREAM_PARSER_MAX_BANK_SIZE) newBankSize = STREAM_PARSER_MAX_BANK_SIZE;
+    }
 
-    fCurBankNum = (fCurBankNum + 1)%2;
-    fCurBank = fBank[fCurBankNum];
-    memmove(curBank(), from, numBytesToSave);
-    fCurParserIndex = fCurParserIndex - fSavedParserIndex;
+    if (newBankSize != fBankSize) {
+#ifdef DEBUG
+      fprintf(stderr, "StreamParser[%p]: growing bank from %u to %u bytes (to hold %u + %u bytes)\n",
+	      this, fBankSize, newBankSize, newCurParserIndex, numBytesNeeded);
+#endif
+      unsigned char* newBank = new unsigned char[newBankSize];
+      memcpy(newBank, from, numBytesToSave);
+      delete[] fBank;
+      fBank = newBank;
+      fBankSize = newBankSize;
+    } else {
+      memmove(curBank(), from, numBytesToSave);
+    }
+    fCurParserIndex = newCurParserIndex;
     fSavedParserIndex = 0;
     fTotNumValidBytes = numBytesToSave;
   }
 
   // ASSERT: fCurParserIndex + numBytesNeeded > fTotNumValidBytes
-  //      && fCurParserIndex + numBytesNeeded <= BANK_SIZE
-  if (fCurParserIndex + numBytesNeeded > BANK_SIZE) {
+  //      && fCurParserIndex + numBytesNeeded <= fBankSize
+  if (fCurParserIndex + numBytesNeeded > fBankSize) {
     // If this happens, it means that we have too much saved parser state.
-    // To fix this, increase BANK_SIZE as appropriate.
+    // To fix this, increase STREAM_PARSER_MAX_BANK_SIZE as appropriate.
     fInputSource->envir() << "StreamParser internal error ("
 			  << fCurParserIndex << " + "
 			  << numBytesNeeded << " > "
-			  << BANK_SIZE << ")\n";
+			  << fBankSize << ")\n";
     fInputSource->envir().internalError();
   }
+  if (fCurParserIndex + numBytesNeeded - fSavedParserIndex > fPeakBankUsage) {
+    fPeakBankUsage = fCurParserIndex + numBytesNeeded - fSavedParserIndex;
+  }
 
   // Try to read as many new bytes as will fit in the current bank:
-  unsigned maxNumBytesToRead = BANK_SIZE - fTotNumValidBytes;
+  unsigned maxNumBytesToRead = fBankSize - fTotNumValidBytes;
   fInputSource->getNextFrame(&curBank()[fTotNumValidBytes],
 			     maxNumBytesToRead,
 			     afterGettingBytes, this,
@@ -172,11 +292,11 @@ void StreamParser::afterGettingBytes(void* clientData,
 
 void StreamParser::afterGettingBytes1(unsigned numBytesRead, struct timeval presentationTime) {
   // Sanity check: Make sure we didn't get too many bytes for our bank:
-  if (fTotNumValidBytes + numBytesRead > BANK_SIZE) {
+  if (fTotNumValidBytes + numBytesRead > fBankSize) {
     fInputSource->envir()
       << "StreamParser::afterGettingBytes() warning: read "
       << numBytesRead << " bytes; expected no more than "
-      << BANK_SIZE - fTotNumValidBytes << "\n";
+      << fBankSize - fTotNumValidBytes << "\n";
   }
 
   fLastSeenPresentationTime = presentationTime;
@@ -25,6 +25,15 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "FramedSource.hh"
 #endif
 
+// Input data is read into a single 'bank', which starts small, and grows (up to a limit) whenever the data that the parser
+// still needs - e.g., a large video frame that it's in the middle of parsing - won't otherwise fit:
+#ifndef STREAM_PARSER_INITIAL_BANK_SIZE
+#define STREAM_PARSER_INITIAL_BANK_SIZE 131072
+#endif
+#ifndef STREAM_PARSER_MAX_BANK_SIZE
+#define STREAM_PARSER_MAX_BANK_SIZE (32*1024*1024)
+#endif
+
 class StreamParser {
 public:
   virtual void flushInput();
@@ -100,6 +109,18 @@ protected: // we're a virtual base class
     fCurParserIndex += numBytes;
   }
 
+  Boolean findStartCode(unsigned char const*& ptr, unsigned& numBytes,
+			u_int8_t lastByteMask = 0xFF, u_int8_t lastByteValue = 0x01);
+      // Looks - from the current parse position, through the data that we've already read - for the first
+      // 3-byte 'start code': two 0 bytes, followed by a byte "b" for which (b&lastByteMask) == lastByteValue.
+      // (By default, this is 0x000001, as used by H.264, H.265 and MPEG-1/2/4 video.  H.263 uses 0x00008[0-3].)
+      // "ptr" is set to point to the current parse position.  If a start code was found, we return True,
+      // with "numBytes" set to the number of bytes that precede it.  Otherwise we return False, with "numBytes"
+      // set to the number of bytes that the caller can consume (e.g., using "skipBytes()") before reading more data
+      // and searching again.  (This is all but the last 3 bytes that we've read, because those might begin a
+      // start code, or - for H.264/5 - be the 0 byte that precedes one.)
+      // This function does not itself change the parse position, or read any data.
+
   void skipBits(unsigned numBits);
   unsigned getBits(unsigned numBits);
       // numBits <= 32; returns data into low-order bits of result
@@ -110,10 +131,12 @@ protected: // we're a virtual base class
 
   Boolean haveSeenEOF() const { return fHaveSeenEOF; }
 
-  unsigned bankSize() const;
+  unsigned bankSize() const { return fBankSize; } // the current size of our bank
+  unsigned peakBankUsage() const { return fPeakBankUsage; }
+      // the largest number of bytes that we've so far needed to keep in our bank at once
 
 private:
-  unsigned char* curBank() { return fCurBank; }
+  unsigned char* curBank() { return fBank; }
   unsigned char* nextToParse() { return &curBank()[fCurParserIndex]; }
   unsigned char* lastParsed() { return &curBank()[fCurParserIndex-1]; }
 
@@ -142,10 +165,10 @@ private:
   clientContinueFunc* fClientContinueFunc;
   void* fClientContinueClientData;
 
-  // Use a pair of 'banks', and swap between them as they fill up:
-  unsigned char* fBank[2];
-  unsigned char fCurBankNum;
-  unsigned char* fCurBank;
+  // Our 'bank'.  When it fills up, we move the data that we still need to its start (growing the bank if necessary):
+  unsigned char* fBank;
+  unsigned fBankSize; // <= STREAM_PARSER_MAX_BANK_SIZE
+  unsigned fPeakBankUsage;
 
   // The most recent 'saved' parse position:
   unsigned fSavedParserIndex; // <= fCurParserIndex
@@ -156,7 +179,7 @@ private:
   unsigned char fRemainingUnparsedBits; // in previous byte: [0,7]
 
   // The total number of valid bytes stored in the current bank:
-  unsigned fTotNumValidBytes; // <= BANK_SIZE
+  unsigned fTotNumValidBytes; // <= fBankSize
 
   // Whether we have seen EOF on the input source:
   Boolean fHaveSeenEOF;
@@ -19,13 +19,15 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 // Implementation.
 
 #include "StreamReplicator.hh"
+#include "H264or5VideoStreamFramer.hh"
 
 ////////// Definition of "StreamReplica": The class that implements each stream replica //////////
 
 class StreamReplica: public FramedSource {
 protected:
   friend class StreamReplicator;
-  StreamReplica(StreamReplicator& ourReplicator); // called only by "StreamReplicator::createStreamReplica()"
+  StreamReplica(StreamReplicator& ourReplicator, Boolean deliversFrameViews);
+      // called only by "StreamReplicator::createStreamReplica()"
   virtual ~StreamReplica();
 
 private: // redefined virtual functions:
@@ -34,39 +36,209 @@ private: // redefined virtual functions:
 
 private:
   static void copyReceivedFrame(StreamReplica* toReplica, StreamReplica* fromReplica);
+  void receiveSharedFrame(StreamReplicatorFrame* frame);
+
+  // Routines used to manage our queue of not-yet-delivered frames (if our replicator doesn't use lock-step delivery):
+  void pushFrame(StreamReplicatorFrame* frame);
+  StreamReplicatorFrame* popFrame();
+  unsigned flushQueue(); // returns the number of frames that were flushed
+  static void deliverQueuedFrame(void* clientData);
 
 private:
   StreamReplicator& fOurReplicator;
   int fFrameIndex; // 0 or 1, depending upon which frame we're currently requesting; could also be -1 if we've stopped playing
+  Boolean fDeliversFrameViews;
+  StreamReplicatorFrame* fDeliveredFrame; // used only if "fDeliversFrameViews"; not yet taken by our reader
 
   // Replicas that are currently awaiting data are kept in a (singly-linked) list:
   StreamReplica* fNext;
+
+  // Every replica is also kept in a (singly-linked) list of all of our replicator's replicas:
+  StreamReplica* fNextReplica;
+
+  // Used only if our replicator doesn't use lock-step delivery:
+  StreamReplicatorFrame** fQueue; // a ring buffer of (at most "maxLagInFrames") frames that we've not yet delivered
+  unsigned fQueueHead;
+  Boolean fIsAwaitingFrame; // our reader has asked for a frame, but our queue was empty
+  Boolean fIsSkippingUntilKeyFrame, fWasDetached;
+
+  // Statistics:
+  unsigned fNumFramesQueued, fMaxNumFramesQueued, fNumFramesDelivered, fNumFramesDropped;
 };
 
 
+////////// StreamReplicatorFrame implementation //////////
+
+StreamReplicatorFrame::StreamReplicatorFrame(StreamReplicator* ourReplicator, unsigned bufferSize)
+  : fOurReplicator(ourReplicator), fData(new unsigned char[bufferSize]), fBufferSize(bufferSize),
+    fFrameSize(0), fNumTruncatedBytes(0), fDurationInMicroseconds(0), fReferenceCount(0),
+    fNextAllocated(NULL), fNextFree(NULL) {
+  fPresentationTime.tv_sec = fPresentationTime.tv_usec = 0;
+}
+
+StreamReplicatorFrame::~StreamReplicatorFrame() {
+  delete[] fData;
+}
+
+void StreamReplicatorFrame::decrementReferenceCount() {
+  if (fReferenceCount == 0) return; // should not happen
+  if (--fReferenceCount > 0) return;
+
+  if (fOurReplicator != NULL) {
+    fOurReplicator->recycleFrame(this);
+  } else {
+    delete this;
+  }
+}
+
+
 ////////// StreamReplicator implementation //////////
 
-StreamReplicator* StreamReplicator::createNew(UsageEnvironment& env, FramedSource* inputSource, Boolean deleteWhenLastReplicaDies) {
-  return new StreamReplicator(env, inputSource, deleteWhenLastReplicaDies);
+StreamReplicator* StreamReplicator::createNew(UsageEnvironment& env, FramedSource* inputSource, Boolean deleteWhenLastReplicaDies,
+					      unsigned sharedFrameBufferSize) {
+  return new StreamReplicator(env, inputSource, deleteWhenLastReplicaDies, sharedFrameBufferSize);
 }
 
-StreamReplicator::StreamReplicator(UsageEnvironment& env, FramedSource* inputSource, Boolean deleteWhenLastReplicaDies)
+StreamReplicator::StreamReplicator(UsageEnvironment& env, FramedSource* inputSource, Boolean deleteWhenLastReplicaDies,
+				   unsigned sharedFrameBufferSize)
   : Medium(env),
     fInputSource(inputSource), fDeleteWhenLastReplicaDies(deleteWhenLastReplicaDies), fInputSourceHasClosed(False),
     fNumReplicas(0), fNumActiveReplicas(0), fNumDeliveriesMadeSoFar(0),
-    fFrameIndex(0), fPrimaryReplica(NULL), fReplicasAwaitingCurrentFrame(NULL), fReplicasAwaitingNextFrame(NULL) {
+    fFrameIndex(0), fPrimaryReplica(NULL), fReplicasAwaitingCurrentFrame(NULL), fReplicasAwaitingNextFrame(NULL),
+    fSharedFrameBufferSize(sharedFrameBufferSize), fCurrentFrame(NULL), fPrimaryReplicaHasCurrentFrame(False),
+    fAllocatedFrames(NULL), fFreeFrames(NULL),
+    fAllReplicas(NULL), fSlowConsumerPolicy(REPLICATOR_LOCK_STEP), fMaxLagInFrames(0), fKeyFrameTest(NULL),
+    fParameterSetTest(NULL),
+    fMaxGOPCacheBytes(0), fGOPCache(NULL), fNumCachedFrames(0), fNumCachedBytes(0),
+    fGOPCacheIsValid(False), fLastFrameWasKeyFrame(False) {
 }
 
 StreamReplicator::~StreamReplicator() {
   Medium::close(fInputSource);
+
+  // (Our cached frames are not part of our pool of shared frames; they get deleted when they're no longer referenced.)
+  clearGOPCache();
+  delete[] fGOPCache;
+
+  // Delete each of our shared frames - except those that are still referenced (by readers of replicas); these will
+  // get deleted when they're no longer referenced:
+  releaseCurrentFrame();
+  StreamReplicatorFrame* frame = fAllocatedFrames;
+  while (frame != NULL) {
+    StreamReplicatorFrame* nextFrame = frame->fNextAllocated;
+    if (frame->fReferenceCount == 0) {
+      delete frame;
+    } else {
+      frame->fOurReplicator = NULL;
+    }
+    frame = nextFrame;
+  }
 }
 
-FramedSource* StreamReplicator::createStreamReplica() {
+FramedSource* StreamReplicator::createStreamReplica(Boolean deliversFrameViews) {
+  if (deliversFrameViews && fSharedFrameBufferSize == 0) return NULL; // we can't deliver frames without copying them
+
   ++fNumReplicas;
-  return new StreamReplica(*this);
+  StreamReplica* replica = new StreamReplica(*this, deliversFrameViews);
+  replica->fNextReplica = fAllReplicas;
+  fAllReplicas = replica;
+
+  return replica;
+}
+
+StreamReplicatorFrame* StreamReplicator::takeDeliveredFrame(FramedSource* replica) {
+  StreamReplica* ourReplica = (StreamReplica*)replica;
+  if (ourReplica == NULL || !ourReplica->fDeliversFrameViews) return NULL;
+
+  StreamReplicatorFrame* frame = ourReplica->fDeliveredFrame;
+  ourReplica->fDeliveredFrame = NULL; // the caller now owns our reference to it
+  return frame;
+}
+
+Boolean StreamReplicator::setSlowConsumerPolicy(StreamReplicatorSlowConsumerPolicy policy, unsigned maxLagInFrames,
+					       StreamReplicatorKeyFrameTestFunc* keyFrameTest,
+					       StreamReplicatorKeyFrameTestFunc* parameterSetTest) {
+  if (fNumActiveReplicas > 0) return False; // too late; a replica is already reading
+  if (policy != REPLICATOR_LOCK_STEP && (fSharedFrameBufferSize == 0 || maxLagInFrames == 0)) return False;
+
+  fSlowConsumerPolicy = policy;
+  fMaxLagInFrames = policy == REPLICATOR_LOCK_STEP ? 0 : maxLagInFrames;
+  fKeyFrameTest = keyFrameTest;
+  fParameterSetTest = parameterSetTest;
+
+  // Discard any queues (and GOP cache) that were set up for an earlier setting:
+  for (StreamReplica* replica = fAllReplicas; replica != NULL; replica = replica->fNextReplica) {
+    delete[] replica->fQueue; replica->fQueue = NULL;
+  }
+  (void)setGOPCache(0);
+
+  return True;
+}
+
+Boolean StreamReplicator::setGOPCache(unsigned maxNumBytes) {
+  if (fNumActiveReplicas > 0) return False; // too late; a replica is already reading
+  if (maxNumBytes > 0 && (fSlowConsumerPolicy == REPLICATOR_LOCK_STEP || fKeyFrameTest == NULL)) return False;
+
+  clearGOPCache();
+  delete[] fGOPCache;
+  fGOPCache = maxNumBytes > 0 ? new StreamReplicatorFrame*[fMaxLagInFrames] : NULL;
+  fMaxGOPCacheBytes = maxNumBytes;
+  fGOPCacheIsValid = fLastFrameWasKeyFrame = False;
+
+  return True;
+}
+
+Boolean StreamReplicator::getReplicaStats(FramedSource* replica, StreamReplicaStats& stats) const {
+  StreamReplica* ourReplica;
+  for (ourReplica = fAllReplicas; ourReplica != NULL; ourReplica = ourReplica->fNextReplica) {
+    if (ourReplica == replica) break;
+  }
+  if (ourReplica == NULL) return False;
+
+  stats.numFramesQueued = ourReplica->fNumFramesQueued;
+  stats.maxNumFramesQueued = ourReplica->fMaxNumFramesQueued;
+  stats.numFramesDelivered = ourReplica->fNumFramesDelivered;
+  stats.numFramesDropped = ourReplica->fNumFramesDropped;
+  stats.wasDetached = ourReplica->fWasDetached;
+
+  return True;
+}
+
+static unsigned char const* skipStartCode(unsigned char const*& frame, unsigned& frameSize) {
+  if (frameSize >= 4 && frame[0] == 0 && frame[1] == 0 && frame[2] == 0 && frame[3] == 1) {
+    frame += 4; frameSize -= 4;
+  } else if (frameSize >= 3 && frame[0] == 0 && frame[1] == 0 && frame[2] == 1) {
+    frame += 3; frameSize -= 3;
+  }
+  return frame;
+}
+
+Boolean StreamReplicator::isH264KeyFrame(unsigned char const* frame, unsigned frameSize) {
+  skipStartCode(frame, frameSize);
+  return frameSize >= 1 && isH264or5KeyNALUnit(264, H264or5NALUnitType(264, frame[0]));
+}
+
+Boolean StreamReplicator::isH265KeyFrame(unsigned char const* frame, unsigned frameSize) {
+  skipStartCode(frame, frameSize);
+  return frameSize >= 1 && isH264or5KeyNALUnit(265, H264or5NALUnitType(265, frame[0]));
+}
+
+Boolean StreamReplicator::isH264ParameterSet(unsigned char const* frame, unsigned frameSize) {
+  skipStartCode(frame, frameSize);
+  return frameSize >= 1 && isH264or5ParameterSet(264, H264or5NALUnitType(264, frame[0]));
+}
+
+Boolean StreamReplicator::isH265ParameterSet(unsigned char const* frame, unsigned frameSize) {
+  skipStartCode(frame, frameSize);
+  return frameSize >= 1 && isH264or5ParameterSet(265, H264or5NALUnitType(265, frame[0]));
 }
 
 void StreamReplicator::getNextFrame(StreamReplica* replica) {
+  if (fSlowConsumerPolicy != REPLICATOR_LOCK_STEP) {
+    getNextFrameFromQueue(replica);
+    return;
+  }
+
   if (fInputSourceHasClosed) { // handle closure instead
     replica->handleClosure();
     return;
@@ -80,12 +252,12 @@ void StreamReplicator::getNextFrame(StreamReplica* replica) {
 
   if (fPrimaryReplica == NULL) {
     // This is the first replica to request the next unread frame.  Make it the 'primary' replica - meaning that we read the frame
-    // into its buffer, and then copy from this into the other replicas' buffers.
+    // into its buffer, and then copy from this into the other replicas' buffers.  (If the replica wants frame views, then we
+    // read the frame into a shared frame instead, but the 'primary' replica still completes each delivery.)
     fPrimaryReplica = replica;
 
-    // Arrange to read the next frame into this replica's buffer:
-    if (fInputSource != NULL) fInputSource->getNextFrame(fPrimaryReplica->fTo, fPrimaryReplica->fMaxSize,
-							 afterGettingFrame, this, onSourceClosure, this);
+    // Arrange to read the next frame into this replica's buffer (or into a shared frame):
+    readNextFrame();
   } else if (replica->fFrameIndex != fFrameIndex) {
     // This replica is already asking for the next frame (because it has already received the current frame).  Enqueue it:
     replica->fNext = fReplicasAwaitingNextFrame;
@@ -105,6 +277,11 @@ void StreamReplicator::getNextFrame(StreamReplica* replica) {
 void StreamReplicator::deactivateStreamReplica(StreamReplica* replicaBeingDeactivated) {
   if (replicaBeingDeactivated->fFrameIndex == -1) return; // this replica has already been deactivated (or was never activated at all)
 
+  if (fSlowConsumerPolicy != REPLICATOR_LOCK_STEP) {
+    deactivateQueuedStreamReplica(replicaBeingDeactivated);
+    return;
+  }
+
   // Assert: fNumActiveReplicas > 0
   if (fNumActiveReplicas == 0) fprintf(stderr, "StreamReplicator::deactivateStreamReplica() Internal Error!\n"); // should not happen
   --fNumActiveReplicas;
@@ -128,19 +305,31 @@ void StreamReplicator::deactivateStreamReplica(StreamReplica* replicaBeingDeacti
     }
 
     // Check whether the read into the old primary replica's buffer is still pending, or has completed:
-    if (fInputSource != NULL) {
+    if (fInputSource != NULL && !fPrimaryReplicaHasCurrentFrame) {
+      // The frame is being read into a shared frame, so it doesn't need to be moved.  But if the read is still pending,
+      // and there's no new primary replica, then stop it:
+      if (fInputSource->isCurrentlyAwaitingData() && fPrimaryReplica == NULL) {
+	fInputSource->stopGettingFrames();
+	releaseCurrentFrame();
+      }
+    } else if (fInputSource != NULL) {
       if (fInputSource->isCurrentlyAwaitingData()) {
 	// We have a pending read into the old primary replica's buffer.
 	// We need to stop it, and retry the read with a new primary (if available)
 	fInputSource->stopGettingFrames();
 
-	if (fPrimaryReplica != NULL) {
-	  fInputSource->getNextFrame(fPrimaryReplica->fTo, fPrimaryReplica->fMaxSize,
-				     afterGettingFrame, this, onSourceClosure, this);
-	}
+	if (fPrimaryReplica != NULL) readNextFrame();
       } else {
 	// The read into the old primary replica's buffer has already completed.  Copy the data to the new primary replica (if any):
-	if (fPrimaryReplica != NULL) {
+	if (fPrimaryReplica != NULL && fPrimaryReplica->fDeliversFrameViews) {
+	  // The new primary replica doesn't have a buffer of its own, so make a shared frame from the old primary's buffer,
+	  // and deliver that instead:
+	  StreamReplica* newPrimaryReplica = fPrimaryReplica;
+	  fPrimaryReplica = replicaBeingDeactivated;
+	  (void)currentFrameFromPrimaryReplica();
+	  fPrimaryReplica = newPrimaryReplica;
+	  fPrimaryReplicaHasCurrentFrame = False;
+	} else if (fPrimaryReplica != NULL) {
 	  StreamReplica::copyReceivedFrame(fPrimaryReplica, replicaBeingDeactivated);
 	} else {
 	  // We don't have a new primary replica, so we can't copy the received frame to any new replica that might ask for it.
@@ -198,6 +387,15 @@ void StreamReplicator::removeStreamReplica(StreamReplica* replicaBeingRemoved) {
   if (fNumReplicas == 0) fprintf(stderr, "StreamReplicator::removeStreamReplica() Internal Error!\n"); // should not happen
   --fNumReplicas;
 
+  // Remove it from our list of all replicas:
+  for (StreamReplica** r = &fAllReplicas; *r != NULL; r = &(*r)->fNextReplica) {
+    if (*r == replicaBeingRemoved) {
+      *r = replicaBeingRemoved->fNextReplica;
+      replicaBeingRemoved->fNextReplica = NULL;
+      break;
+    }
+  }
+
   // If this was the last replica, then delete ourselves (if we were set up to do so):
   if (fNumReplicas == 0 && fDeleteWhenLastReplicaDies) {
     Medium::close(this);
@@ -212,6 +410,21 @@ void StreamReplicator::afterGettingFrame(void* clientData, unsigned frameSize, u
 
 void StreamReplicator::afterGettingFrame(unsigned frameSize, unsigned numTruncatedBytes,
 					 struct timeval presentationTime, unsigned durationInMicroseconds) {
+  if (!fPrimaryReplicaHasCurrentFrame) {
+    // The frame was read into a shared frame.  Record its parameters; we'll deliver it (including to the primary replica) later:
+    fCurrentFrame->fFrameSize = frameSize;
+    fCurrentFrame->fNumTruncatedBytes = numTruncatedBytes;
+    fCurrentFrame->fPresentationTime = presentationTime;
+    fCurrentFrame->fDurationInMicroseconds = durationInMicroseconds;
+
+    if (fSlowConsumerPolicy != REPLICATOR_LOCK_STEP) {
+      queueReceivedFrame();
+    } else {
+      deliverReceivedFrame();
+    }
+    return;
+  }
+
   // The frame was read into our primary replica's buffer.  Update the primary replica's state, but don't complete delivery to it
   // just yet.  We do that later, after we're sure that we've delivered it to all other replicas.
   fPrimaryReplica->fFrameSize = frameSize;
@@ -231,6 +444,24 @@ void StreamReplicator::onSourceClosure() {
 
   // Signal the closure to each replica that is currently awaiting a frame:
   StreamReplica* replica;
+  if (fSlowConsumerPolicy != REPLICATOR_LOCK_STEP) {
+    // (Replicas that still have queued frames will be told about the closure once they've been given these frames.)
+    releaseCurrentFrame();
+    clearGOPCache();
+    fGOPCacheIsValid = False;
+    do {
+      // Note: We rescan our list after each closure, because the replica's reader might have deleted it (or another replica):
+      for (replica = fAllReplicas; replica != NULL; replica = replica->fNextReplica) {
+	if (replica->fIsAwaitingFrame) break;
+      }
+      if (replica != NULL) {
+	replica->fIsAwaitingFrame = False;
+	replica->handleClosure();
+      }
+    } while (replica != NULL);
+    return;
+  }
+
   while ((replica = fReplicasAwaitingCurrentFrame) != NULL) {
     fReplicasAwaitingCurrentFrame = replica->fNext;
     replica->fNext = NULL;
@@ -258,7 +489,11 @@ void StreamReplicator::deliverReceivedFrame() {
     
     // Assert: fPrimaryReplica != NULL
     if (fPrimaryReplica == NULL) fprintf(stderr, "StreamReplicator::deliverReceivedFrame() Internal Error 1!\n"); // shouldn't happen
-    StreamReplica::copyReceivedFrame(replica, fPrimaryReplica);
+    if (!fPrimaryReplicaHasCurrentFrame || replica->fDeliversFrameViews) {
+      replica->receiveSharedFrame(currentFrameFromPrimaryReplica());
+    } else {
+      StreamReplica::copyReceivedFrame(replica, fPrimaryReplica);
+    }
     replica->fFrameIndex = 1 - replica->fFrameIndex; // toggle it (0<->1), because this replica no longer awaits the current frame
     ++fNumDeliveriesMadeSoFar;
 
@@ -266,6 +501,7 @@ void StreamReplicator::deliverReceivedFrame() {
     if (!(fNumDeliveriesMadeSoFar < fNumActiveReplicas)) fprintf(stderr, "StreamReplicator::deliverReceivedFrame() Internal Error 2(%d,%d)!\n", fNumDeliveriesMadeSoFar, fNumActiveReplicas); // should not happen
 
     // Complete delivery to this replica:
+    ++replica->fNumFramesDelivered;
     FramedSource::afterGetting(replica);
   }
 
@@ -277,15 +513,21 @@ void StreamReplicator::deliverReceivedFrame() {
     fFrameIndex = 1 - fFrameIndex; // toggle it (0<->1) for the next frame
     fNumDeliveriesMadeSoFar = 0; // reset for the next frame
 
+    if (fCurrentFrame != NULL) {
+      // Give the shared frame to the 'primary' replica too (unless the frame is already in its buffer).
+      // We're now done with it ourself:
+      if (!fPrimaryReplicaHasCurrentFrame) replica->receiveSharedFrame(fCurrentFrame);
+      releaseCurrentFrame();
+    }
+
     if (fReplicasAwaitingNextFrame != NULL) {
       // One of the other replicas has already requested the next frame, so make it the next 'primary replica':
       fPrimaryReplica = fReplicasAwaitingNextFrame;
       fReplicasAwaitingNextFrame = fReplicasAwaitingNextFrame->fNext;
       fPrimaryReplica->fNext = NULL;
 
-      // Arrange to read the next frame into this replica's buffer:
-      if (fInputSource != NULL) fInputSource->getNextFrame(fPrimaryReplica->fTo, fPrimaryReplica->fMaxSize,
-							   afterGettingFrame, this, onSourceClosure, this);
+      // Arrange to read the next frame into this replica's buffer (or into a shared frame):
+      readNextFrame();
     }      
 
     // Move any other replicas that had already requested the next frame to the 'requesting current frame' list:
@@ -295,21 +537,328 @@ void StreamReplicator::deliverReceivedFrame() {
     fReplicasAwaitingNextFrame = NULL;
     
     // Complete delivery to the 'primary' replica (thereby completing all deliveries for this frame):
+    ++replica->fNumFramesDelivered;
     FramedSource::afterGetting(replica);
   }
 }
 
+void StreamReplicator::getNextFrameFromQueue(StreamReplica* replica) {
+  if (replica->fWasDetached) { // this replica fell too far behind, so it no longer gets frames
+    replica->handleClosure();
+    return;
+  }
+
+  if (replica->fFrameIndex == -1) {
+    // This replica had stopped playing (or had just been created), but is now actively reading.  Note this:
+    replica->fFrameIndex = 0;
+    ++fNumActiveReplicas;
+
+    // Give it our cached 'group of pictures' (if any) first, so that its reader can start decoding straight away:
+    for (unsigned i = 0; i < fNumCachedFrames; ++i) replica->pushFrame(fGOPCache[i]);
+  }
+
+  if (replica->fNumFramesQueued > 0) {
+    // This replica already has a frame waiting for it.  Deliver it (via the event loop, so that a reader that asks for
+    // each frame from within its 'after getting' function doesn't cause unbounded recursion):
+    replica->nextTask() = envir().taskScheduler().scheduleDelayedTask(0, StreamReplica::deliverQueuedFrame, replica);
+    return;
+  }
+
+  if (fInputSourceHasClosed) { // handle closure instead
+    replica->handleClosure();
+    return;
+  }
+
+  // This replica has to wait for the next incoming frame.  Read it now, unless another replica has already done so:
+  replica->fIsAwaitingFrame = True;
+  if (fInputSource != NULL && !fInputSource->isCurrentlyAwaitingData()) readNextFrame();
+}
+
+void StreamReplicator::deactivateQueuedStreamReplica(StreamReplica* replica) {
+  // Assert: fNumActiveReplicas > 0
+  if (fNumActiveReplicas == 0) fprintf(stderr, "StreamReplicator::deactivateQueuedStreamReplica() Internal Error!\n"); // should not happen
+  --fNumActiveReplicas;
+
+  replica->fFrameIndex = -1;
+  replica->fIsAwaitingFrame = replica->fIsSkippingUntilKeyFrame = False;
+  envir().taskScheduler().unscheduleDelayedTask(replica->nextTask());
+  replica->flushQueue();
+
+  if (fNumActiveReplicas == 0 && fInputSource != NULL) {
+    // Tell our source to stop too:
+    fInputSource->stopGettingFrames();
+    releaseCurrentFrame();
+
+    // Our cached frames (if any) will be stale by the time that a replica starts reading again, so discard them:
+    clearGOPCache();
+    fGOPCacheIsValid = fLastFrameWasKeyFrame = False;
+  }
+}
+
+void StreamReplicator::queueReceivedFrame() {
+  // Give the new frame to each active replica's queue, and deliver it to each replica that has been waiting for it:
+  StreamReplicatorFrame* frame = fCurrentFrame;
+  fCurrentFrame = NULL; // we keep our reference to it until we've queued it
+
+  if (fMaxGOPCacheBytes > 0) {
+    // Queue (and cache) a right-sized copy of the frame instead, and reuse its shared frame for the next read:
+    StreamReplicatorFrame* copy = compactCopy(frame);
+    frame->decrementReferenceCount();
+    frame = copy;
+
+    cacheFrame(frame);
+  }
+
+  Boolean someReplicaIsStillAwaitingAFrame = False;
+  for (StreamReplica* replica = fAllReplicas; replica != NULL; replica = replica->fNextReplica) {
+    if (replica->fFrameIndex == -1 || replica->fWasDetached) continue;
+
+    queueFrameForReplica(replica, frame);
+    if (replica->fIsAwaitingFrame) {
+      if (replica->fNumFramesQueued > 0) {
+	replica->fIsAwaitingFrame = False;
+	replica->nextTask() = envir().taskScheduler().scheduleDelayedTask(0, StreamReplica::deliverQueuedFrame, replica);
+      } else {
+	someReplicaIsStillAwaitingAFrame = True; // because it's skipping frames until the next key frame
+      }
+    }
+  }
+  frame->decrementReferenceCount();
+
+  if (someReplicaIsStillAwaitingAFrame) readNextFrame();
+}
+
+void StreamReplicator::queueFrameForReplica(StreamReplica* replica, StreamReplicatorFrame* frame) {
+  if (replica->fIsSkippingUntilKeyFrame) {
+    if (isKeyFrame(frame)) {
+      replica->fIsSkippingUntilKeyFrame = False;
+    } else if (!isParameterSet(frame)) {
+      ++replica->fNumFramesDropped;
+      return;
+    } // else keep the parameter set (but keep skipping), because the reader will need it to decode the next key frame
+  }
+
+  if (replica->fNumFramesQueued == fMaxLagInFrames) {
+    // This replica's reader has fallen too far behind.  Apply our policy:
+    switch (fSlowConsumerPolicy) {
+      case REPLICATOR_DROP_OLDEST: {
+	replica->popFrame()->decrementReferenceCount();
+	++replica->fNumFramesDropped;
+	break;
+      }
+      case REPLICATOR_DROP_UNTIL_KEY_FRAME: {
+	replica->fNumFramesDropped += flushQueueExceptParameterSets(replica, frame);
+	if (!isKeyFrame(frame)) {
+	  replica->fIsSkippingUntilKeyFrame = True;
+	  if (!isParameterSet(frame)) {
+	    ++replica->fNumFramesDropped;
+	    return;
+	  }
+	}
+	break;
+      }
+      default: { // REPLICATOR_DETACH
+	detachStreamReplica(replica);
+	++replica->fNumFramesDropped;
+	return;
+      }
+    }
+  }
+
+  replica->pushFrame(frame);
+}
+
+unsigned StreamReplicator::flushQueueExceptParameterSets(StreamReplica* replica, StreamReplicatorFrame* newFrame) {
+  // Drop each queued frame, except for parameter sets - e.g., a SPS and PPS that were queued just before the key frame
+  // that's now arriving ("newFrame").  Keep only one copy of each parameter set (the last one, which might be "newFrame"):
+  unsigned numFlushed = 0;
+  for (unsigned numToExamine = replica->fNumFramesQueued; numToExamine > 0; --numToExamine) {
+    StreamReplicatorFrame* frame = replica->popFrame();
+
+    Boolean keepIt = isParameterSet(frame);
+    for (unsigned i = 0; keepIt && i <= replica->fNumFramesQueued; ++i) {
+      StreamReplicatorFrame* laterFrame
+	= i < replica->fNumFramesQueued ? replica->fQueue[(replica->fQueueHead + i)%fMaxLagInFrames] : newFrame;
+      if (laterFrame->frameSize() == frame->frameSize() && memcmp(laterFrame->data(), frame->data(), frame->frameSize()) == 0) {
+	keepIt = False; // it's superseded by a later copy
+      }
+    }
+
+    if (keepIt) {
+      replica->pushFrame(frame); // moves it to the back of the queue, keeping the kept frames in order
+    } else {
+      ++numFlushed;
+    }
+    frame->decrementReferenceCount();
+  }
+
+  if (replica->fNumFramesQueued == fMaxLagInFrames) {
+    // Every queued frame was a distinct parameter set.  We still need to make room for "newFrame":
+    replica->popFrame()->decrementReferenceCount();
+    ++numFlushed;
+  }
+
+  return numFlushed;
+}
+
+void StreamReplicator::detachStreamReplica(StreamReplica* replica) {
+  replica->fWasDetached = True;
+  replica->fNumFramesDropped += replica->flushQueue();
+
+  if (replica->nextTask() != NULL) {
+    // The replica's reader was about to be given a queued frame.  Instead, tell it that the stream has closed:
+    envir().taskScheduler().unscheduleDelayedTask(replica->nextTask());
+    replica->nextTask() = envir().taskScheduler().scheduleDelayedTask(0, FramedSource::handleClosure, replica);
+  }
+  // Otherwise, the reader will be told about the closure when it next asks for a frame.
+}
+
+Boolean StreamReplicator::isKeyFrame(StreamReplicatorFrame* frame) const {
+  return fKeyFrameTest == NULL || (*fKeyFrameTest)(frame->data(), frame->frameSize());
+}
+
+Boolean StreamReplicator::isParameterSet(StreamReplicatorFrame* frame) const {
+  return fParameterSetTest != NULL && (*fParameterSetTest)(frame->data(), frame->frameSize());
+}
+
+void StreamReplicator::cacheFrame(StreamReplicatorFrame* frame) {
+  Boolean const frameIsKeyFrame = isKeyFrame(frame);
+  if (frameIsKeyFrame && !fLastFrameWasKeyFrame) {
+    // This frame begins a new 'group of pictures'.  Cache it (and the following frames) in place of the previous group.
+    // (But if it's not a parameter set itself, keep any cached parameter sets, because they're needed to decode it.):
+    clearGOPCache(!isParameterSet(frame));
+    fGOPCacheIsValid = True;
+  }
+  fLastFrameWasKeyFrame = frameIsKeyFrame;
+  if (!fGOPCacheIsValid) return;
+
+  if (fNumCachedFrames == fMaxLagInFrames || fNumCachedBytes + frame->frameSize() > fMaxGOPCacheBytes) {
+    // This group is too long to cache, so don't cache any more of it - and don't use what we've cached so far
+    // (except for any parameter sets):
+    clearGOPCache(True);
+    fGOPCacheIsValid = False;
+    return;
+  }
+
+  frame->incrementReferenceCount();
+  fGOPCache[fNumCachedFrames++] = frame;
+  fNumCachedBytes += frame->frameSize();
+}
+
+void StreamReplicator::clearGOPCache(Boolean keepParameterSets) {
+  unsigned numKept = 0;
+  fNumCachedBytes = 0;
+  for (unsigned i = 0; i < fNumCachedFrames; ++i) {
+    StreamReplicatorFrame* frame = fGOPCache[i];
+    if (keepParameterSets && isParameterSet(frame)) {
+      fGOPCache[numKept++] = frame;
+      fNumCachedBytes += frame->frameSize();
+    } else {
+      frame->decrementReferenceCount();
+    }
+  }
+  fNumCachedFrames = numKept;
+}
+
+void StreamReplicator::readNextFrame() {
+  if (fInputSource == NULL) return;
+
+  if (fSlowConsumerPolicy == REPLICATOR_LOCK_STEP && !fPrimaryReplica->fDeliversFrameViews) {
+    // Normal case: Read into the primary replica's buffer.  (If a replica that wants frame views asks for this frame,
+    // then we'll copy it into a shared frame at that point.):
+    releaseCurrentFrame(); // in case we made a shared frame for a previous read that got stopped
+    fPrimaryReplicaHasCurrentFrame = True;
+    fInputSource->getNextFrame(fPrimaryReplica->fTo, fPrimaryReplica->fMaxSize,
+			       afterGettingFrame, this, onSourceClosure, this);
+    return;
+  }
+
+  // Read into a shared frame:
+  if (fCurrentFrame == NULL) fCurrentFrame = newFrame(); // we hold a reference until we've delivered the frame to every replica
+  fPrimaryReplicaHasCurrentFrame = False;
+  fInputSource->getNextFrame(fCurrentFrame->fData, fCurrentFrame->fBufferSize,
+			     afterGettingFrame, this, onSourceClosure, this);
+}
+
+StreamReplicatorFrame* StreamReplicator::newFrame() {
+  // Reuse a free frame, if we can:
+  StreamReplicatorFrame* frame;
+  if (fFreeFrames != NULL) {
+    frame = fFreeFrames;
+    fFreeFrames = frame->fNextFree;
+    frame->fNextFree = NULL;
+  } else {
+    frame = new StreamReplicatorFrame(this, fSharedFrameBufferSize);
+    frame->fNextAllocated = fAllocatedFrames;
+    fAllocatedFrames = frame;
+  }
+  frame->incrementReferenceCount(); // the caller's reference
+
+  return frame;
+}
+
+StreamReplicatorFrame* StreamReplicator::currentFrameFromPrimaryReplica() {
+  // Return the current shared frame - first making it (by copying the primary replica's received frame), if needed:
+  if (fCurrentFrame == NULL) {
+    fCurrentFrame = newFrame();
+
+    unsigned numNewBytesToTruncate
+      = fCurrentFrame->fBufferSize < fPrimaryReplica->fFrameSize ? fPrimaryReplica->fFrameSize - fCurrentFrame->fBufferSize : 0;
+    fCurrentFrame->fFrameSize = fPrimaryReplica->fFrameSize - numNewBytesToTruncate;
+    fCurrentFrame->fNumTruncatedBytes = fPrimaryReplica->fNumTruncatedBytes + numNewBytesToTruncate;
+    memmove(fCurrentFrame->fData, fPrimaryReplica->fTo, fCurrentFrame->fFrameSize);
+    fCurrentFrame->fPresentationTime = fPrimaryReplica->fPresentationTime;
+    fCurrentFrame->fDurationInMicroseconds = fPrimaryReplica->fDurationInMicroseconds;
+  }
+
+  return fCurrentFrame;
+}
+
+StreamReplicatorFrame* StreamReplicator::compactCopy(StreamReplicatorFrame* frame) {
+  // Copy "frame" into a new frame whose buffer is just big enough for it.  (This new frame is not part of our pool of
+  // shared frames; instead, it deletes itself when it's no longer referenced.)
+  StreamReplicatorFrame* copy = new StreamReplicatorFrame(NULL, frame->fFrameSize);
+  memmove(copy->fData, frame->fData, frame->fFrameSize);
+  copy->fFrameSize = frame->fFrameSize;
+  copy->fNumTruncatedBytes = frame->fNumTruncatedBytes;
+  copy->fPresentationTime = frame->fPresentationTime;
+  copy->fDurationInMicroseconds = frame->fDurationInMicroseconds;
+  copy->incrementReferenceCount(); // the caller's reference
+
+  return copy;
+}
+
+void StreamReplicator::releaseCurrentFrame() {
+  if (fCurrentFrame == NULL) return;
+
+  StreamReplicatorFrame* frame = fCurrentFrame;
+  fCurrentFrame = NULL;
+  frame->decrementReferenceCount();
+}
+
+void StreamReplicator::recycleFrame(StreamReplicatorFrame* frame) {
+  // "frame" is no longer referenced, so it can be reused for a later frame:
+  frame->fNextFree = fFreeFrames;
+  fFreeFrames = frame;
+}
+
 
 ////////// StreamReplica implementation //////////
 
-StreamReplica::StreamReplica(StreamReplicator& ourReplicator)
+StreamReplica::StreamReplica(StreamReplicator& ourReplicator, Boolean deliversFrameViews)
   : FramedSource(ourReplicator.envir()),
     fOurReplicator(ourReplicator),
-    fFrameIndex(-1/*we haven't started playing yet*/), fNext(NULL) {
+    fFrameIndex(-1/*we haven't started playing yet*/), fDeliversFrameViews(deliversFrameViews), fDeliveredFrame(NULL),
+    fNext(NULL), fNextReplica(NULL),
+    fQueue(NULL), fQueueHead(0), fIsAwaitingFrame(False), fIsSkippingUntilKeyFrame(False), fWasDetached(False),
+    fNumFramesQueued(0), fMaxNumFramesQueued(0), fNumFramesDelivered(0), fNumFramesDropped(0) {
 }
 
 StreamReplica::~StreamReplica() {
+  if (fDeliveredFrame != NULL) fDeliveredFrame->decrementReferenceCount();
+  StreamReplicatorFrame** queue = fQueue; // because "removeStreamReplica()" might delete our replicator
   fOurReplicator.removeStreamReplica(this);
+  delete[] queue;
 }
 
 void StreamReplica::doGetNextFrame() {
@@ -331,3 +880,72 @@ void StreamReplica::copyReceivedFrame(StreamReplica* toReplica, StreamReplica* f
   toReplica->fPresentationTime = fromReplica->fPresentationTime;
   toReplica->fDurationInMicroseconds = fromReplica->fDurationInMicroseconds;
 }
+
+void StreamReplica::receiveSharedFrame(StreamReplicatorFrame* frame) {
+  if (fDeliversFrameViews) {
+    // Hand our reader a reference to the frame (replacing any earlier frame that it didn't take):
+    if (fDeliveredFrame != NULL) fDeliveredFrame->decrementReferenceCount();
+    frame->incrementReferenceCount();
+    fDeliveredFrame = frame;
+
+    fFrameSize = frame->frameSize();
+    fNumTruncatedBytes = frame->numTruncatedBytes();
+  } else {
+    // Copy the frame into our reader's buffer (truncating it, if necessary):
+    unsigned numNewBytesToTruncate = fMaxSize < frame->frameSize() ? frame->frameSize() - fMaxSize : 0;
+    fFrameSize = frame->frameSize() - numNewBytesToTruncate;
+    fNumTruncatedBytes = frame->numTruncatedBytes() + numNewBytesToTruncate;
+
+    memmove(fTo, frame->data(), fFrameSize);
+  }
+  fPresentationTime = frame->presentationTime();
+  fDurationInMicroseconds = frame->durationInMicroseconds();
+}
+
+void StreamReplica::pushFrame(StreamReplicatorFrame* frame) {
+  // Assert: fNumFramesQueued < fOurReplicator.fMaxLagInFrames
+  if (fQueue == NULL) fQueue = new StreamReplicatorFrame*[fOurReplicator.fMaxLagInFrames];
+
+  frame->incrementReferenceCount();
+  fQueue[(fQueueHead + fNumFramesQueued)%fOurReplicator.fMaxLagInFrames] = frame;
+  if (++fNumFramesQueued > fMaxNumFramesQueued) fMaxNumFramesQueued = fNumFramesQueued;
+}
+
+StreamReplicatorFrame* StreamReplica::popFrame() {
+  if (fNumFramesQueued == 0) return NULL;
+
+  StreamReplicatorFrame* frame = fQueue[fQueueHead];
+  fQueueHead = (fQueueHead + 1)%fOurReplicator.fMaxLagInFrames;
+  --fNumFramesQueued;
+
+  return frame; // the caller now owns our reference to it
+}
+
+unsigned StreamReplica::flushQueue() {
+  unsigned numFlushed = 0;
+  StreamReplicatorFrame* frame;
+  while ((frame = popFrame()) != NULL) {
+    frame->decrementReferenceCount();
+    ++numFlushed;
+  }
+  fQueueHead = 0;
+
+  return numFlushed;
+}
+
+void StreamReplica::deliverQueuedFrame(void* clientData) {
+  StreamReplica* replica = (StreamReplica*)clientData;
+  replica->nextTask() = NULL;
+
+  StreamReplicatorFrame* frame = replica->popFrame();
+  if (frame == NULL) {
+    // Our queued frames were dropped after this delivery was scheduled.  Ask for the next frame again:
+    replica->fOurReplicator.getNextFrame(replica);
+    return;
+  }
+
+  replica->receiveSharedFrame(frame);
+  frame->decrementReferenceCount(); // the queue's reference
+  ++replica->fNumFramesDelivered;
+  FramedSource::afterGetting(replica);
+}
@@ -74,11 +74,9 @@ void TLSState::nullify() {
 
 #ifndef NO_OPENSSL
 void TLSState::initLibrary() {
-  static Boolean SSLLibraryHasBeenInitialized = False;
-  if (!SSLLibraryHasBeenInitialized) {
-    (void)SSL_library_init();
-    SSLLibraryHasBeenInitialized = True;
-  }
+  // (Initializing a local static is thread-safe, so this is done only once, even if several threads get here at once.)
+  static Boolean const SSLLibraryHasBeenInitialized = (SSL_library_init(), True);
+  (void)SSLLibraryHasBeenInitialized;
 }
 
 void TLSState::reset() {
@@ -145,6 +143,10 @@ Boolean ClientTLSState::setup(int socketNum) {
     fCon = SSL_new(fCtx);
     if (fCon == NULL) break;
 
+    // Our socket is non-blocking, so after a write that returns SSL_ERROR_WANT_WRITE, we retry the write later -
+    // from a copy of the data (e.g., in a "RTPInterface" egress queue) - so allow this:
+    SSL_set_mode(fCon, SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER|SSL_MODE_ENABLE_PARTIAL_WRITE);
+
 #ifdef CLIENT_TLS_SETUP_EXTRA
     // (Note the comment in the "TLSState.hh" header file.)
     return setupExtra(socketNum);
@@ -252,6 +254,10 @@ Boolean ServerTLSState::setup(int socketNum) {
     fCon = SSL_new(fCtx);
     if (fCon == NULL) break;
 
+    // Our socket is non-blocking, so after a write that returns SSL_ERROR_WANT_WRITE, we retry the write later -
+    // from a copy of the data (e.g., in a "RTPInterface" egress queue) - so allow this:
+    SSL_set_mode(fCon, SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER|SSL_MODE_ENABLE_PARTIAL_WRITE);
+
     BIO* bio = BIO_new_socket(socketNum, BIO_NOCLOSE);
     SSL_set_bio(fCon, bio, bio);
 
@@ -25,6 +25,8 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "MediaSink.hh"
 #endif
 
+class StreamReplicator; // forward
+
 class FileSink: public MediaSink {
 public:
   static FileSink* createNew(UsageEnvironment& env, char const* fileName,
@@ -41,6 +43,11 @@ public:
 		       struct timeval presentationTime);
   // (Available in case a client wants to add extra data to the output file)
 
+  void readFrameViewsFrom(StreamReplicator* replicator) { fReplicator = replicator; }
+  // Call this (before "startPlaying()") if our source is a replica that was created by
+  // "replicator->createStreamReplica(True)".  Each frame is then written directly from the
+  // replicator's shared frame, rather than being copied into our own buffer first.
+
 protected:
   FileSink(UsageEnvironment& env, FILE* fid, unsigned bufferSize,
 	   char const* perFrameFileNamePrefix);
@@ -66,6 +73,7 @@ protected:
   char* fPerFrameFileNameBuffer; // used if "oneFilePerFrame" is True
   struct timeval fPrevPresentationTime;
   unsigned fSamePresentationTimeCounter;
+  StreamReplicator* fReplicator; // non-NULL iff we read frame views from a "StreamReplicator"
 };
 
 #endif
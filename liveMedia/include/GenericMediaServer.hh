@@ -88,6 +88,9 @@ protected:
   virtual ~GenericMediaServer();
   void cleanup(); // MUST be called in the destructor of any subclass of us
 
+  virtual void noteServerMediaSessionRemoval(ServerMediaSession* serverMediaSession);
+      // a hook that's called (by "removeServerMediaSession()") just before "serverMediaSession" is removed from our lookup table
+
   static int setUpOurSocket(UsageEnvironment& env, Port& ourPort, int domain);
 
   static void incomingConnectionHandlerIPv4(void*, int /*mask*/);
@@ -89,4 +89,12 @@ unsigned removeH264or5EmulationBytes(u_int8_t* to, unsigned toMaxSize,
 				     u_int8_t const* from, unsigned fromSize);
     // returns the size of the copy; it will be <= min(toMaxSize,fromSize)
 
+// General routines for classifying a (H.264 or H.265) NAL unit:
+u_int8_t H264or5NALUnitType(int hNumber, u_int8_t firstNALUnitHeaderByte);
+Boolean isH264or5ParameterSet(int hNumber, u_int8_t nal_unit_type);
+    // True iff the NAL unit is a VPS (H.265 only), SPS or PPS
+Boolean isH264or5KeyNALUnit(int hNumber, u_int8_t nal_unit_type);
+    // True iff the NAL unit is a parameter set, or (part of) a picture from which decoding can start
+    // - i.e., an IDR picture (H.264), or an IRAP picture (H.265)
+
 #endif
@@ -0,0 +1,99 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2026 Live Networks, Inc.  All rights reserved.
+// An in-memory store of HLS (Apple's "HTTP Live Streaming") segments - for one or more streams -
+// that a "RTSPServer" can serve directly over HTTP.
+// C++ header
+
+#ifndef _HLS_SEGMENT_STORE_HH
+#define _HLS_SEGMENT_STORE_HH
+
+#ifndef _MEDIA_HH
+#include "Media.hh"
+#endif
+
+class HLSSegmentStore; // forward
+
+// A read-only, reference-counted, Transport Stream segment.  The store holds one reference to each segment that's
+// within its window; anything else (e.g., a HTTP connection that's in the middle of sending it) that needs the segment
+// to stay around must hold its own.
+class HLSSegment {
+public:
+  char const* name() const { return fName; } // e.g., "stream042.ts"
+  unsigned sequenceNumber() const { return fSequenceNumber; }
+  unsigned char const* data() const { return fData; }
+  unsigned size() const { return fSize; }
+  double duration() const { return fDuration; } // in seconds
+
+  void incrementReferenceCount() { ++fReferenceCount; }
+  void decrementReferenceCount(); // When the count reaches 0, the segment is deleted
+
+private:
+  friend class HLSSegmentStore;
+  HLSSegment(char const* streamName, unsigned sequenceNumber,
+	     unsigned char* data, unsigned size, double duration);
+  virtual ~HLSSegment();
+
+private:
+  HLSSegment* fNext; // in our stream's window
+  char* fName;
+  unsigned fSequenceNumber;
+  unsigned char* fData;
+  unsigned fSize;
+  double fDuration;
+  unsigned fReferenceCount;
+};
+
+class HLSSegmentStore: public Medium {
+public:
+  static HLSSegmentStore* createNew(UsageEnvironment& env, unsigned windowDuration = 60/*seconds*/);
+      // "windowDuration" is how far back in time (at least) a client can seek in each stream.  Older segments are
+      // removed from the store (and are deleted once no HTTP connection is still sending them).
+
+  HLSSegment* addSegment(char const* streamName, unsigned char* data, unsigned size, double duration);
+      // Adds a new segment (of "duration" seconds) to the end of the named stream (which is created, if it doesn't
+      // already exist).  The segment takes ownership of "data", which must have been allocated using "new[]".
+      // Returns the new segment (but without adding a reference to it).
+      // Note: Because "RTSPServer" looks up playlists and segments using just the last component of the URL,
+      // "streamName" should not contain '/'.
+  void removeStream(char const* streamName);
+
+  // Used (e.g., by "RTSPServer") to serve the store's contents:
+  char* generatePlaylist(char const* streamName);
+      // Returns a (dynamically-allocated, '\0'-terminated) ".m3u8" playlist for the named stream's current window,
+      // or NULL if there's no such stream (or it has no segments yet).
+  HLSSegment* lookupSegment(char const* segmentName);
+      // Returns the named segment (with a reference added for the caller), or NULL if it's not (or no longer) in the store
+
+  unsigned windowDuration() const { return fWindowDuration; }
+
+protected:
+  HLSSegmentStore(UsageEnvironment& env, unsigned windowDuration);
+      // called only by createNew(), or by subclass constructors
+  virtual ~HLSSegmentStore();
+
+private:
+  class StreamState; // forward
+  void removeOldestSegment(StreamState* stream);
+
+private:
+  unsigned fWindowDuration;
+  HashTable* fStreams; // maps stream names to "StreamState"s
+  HashTable* fSegments; // maps segment names to "HLSSegment"s (for every segment within each stream's window)
+};
+
+#endif
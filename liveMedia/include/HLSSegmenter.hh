@@ -16,7 +16,7 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 // "liveMedia"
 // Copyright (c) 1996-2026 Live Networks, Inc.  All rights reserved.
 // A media sink that takes - as input - a MPEG Transport Stream, and outputs a series
-// of MPEG Transport Stream files, each representing a segment of the input stream,
+// of MPEG Transport Stream files (or in-memory "HLSSegment"s), each representing a segment of the input stream,
 // suitable for HLS (Apple's "HTTP Live Streaming").
 // C++ header
 
@@ -26,6 +26,9 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #ifndef _MEDIA_SINK_HH
 #include "MediaSink.hh"
 #endif
+#ifndef _HLS_SEGMENT_STORE_HH
+#include "HLSSegmentStore.hh"
+#endif
 
 class HLSSegmenter: public MediaSink {
 public:
@@ -35,9 +38,18 @@ public:
 				 unsigned segmentationDuration, char const* fileNamePrefix,
 				 onEndOfSegmentFunc* onEndOfSegmentFunc = NULL,
 				 void* onEndOfSegmentClientData = NULL);
+  static HLSSegmenter* createNew(UsageEnvironment& env,
+				 unsigned segmentationDuration,
+				 HLSSegmentStore& segmentStore, char const* streamName,
+				 onEndOfSegmentFunc* onEndOfSegmentFunc = NULL,
+				 void* onEndOfSegmentClientData = NULL);
+      // Alternatively, each segment is kept in memory, by adding it to the end of the named stream in
+      // "segmentStore", rather than writing it to a file.  (In this case, "segmentFileName" - in the
+      // "onEndOfSegmentFunc" call - is the name of the segment within the store.)
 
 private:
   HLSSegmenter(UsageEnvironment& env, unsigned segmentationDuration, char const* fileNamePrefix,
+	       HLSSegmentStore* segmentStore,
 	       onEndOfSegmentFunc* onEndOfSegmentFunc, void* onEndOfSegmentClientData);
     // called only by createNew()
   virtual ~HLSSegmenter();
@@ -46,6 +58,7 @@ private:
   void ourEndOfSegmentHandler(double segmentDuration);
 
   Boolean openNextOutputSegment();
+  char const* endCurrentSegment(double segmentDuration); // returns the name of the segment
 
   static void afterGettingFrame(void* clientData, unsigned frameSize,
                                 unsigned numTruncatedBytes,
@@ -63,7 +76,8 @@ private: // redefined virtual functions:
 
 private:
   unsigned fSegmentationDuration;
-  char const* fFileNamePrefix;
+  char const* fFileNamePrefix; // (if "fSegmentStore" is non-NULL, this is the stream name instead)
+  HLSSegmentStore* fSegmentStore; // non-NULL iff we keep segments in memory
   onEndOfSegmentFunc* fOnEndOfSegmentFunc;
   void* fOnEndOfSegmentClientData;
   Boolean fHaveConfiguredUpstreamSource;
@@ -71,6 +85,10 @@ private:
   char* fOutputSegmentFileName;
   FILE* fOutFid;
   unsigned char* fOutputFileBuffer;
+
+  // Used only if "fSegmentStore" is non-NULL - the contents of the current segment:
+  unsigned char* fSegmentData;
+  unsigned fSegmentDataSize, fSegmentDataMaxSize;
 };
 
 #endif
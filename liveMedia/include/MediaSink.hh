@@ -68,6 +68,11 @@ private:
 };
 
 // A data structure that a sink may use for an output packet:
+#ifndef OUT_PACKET_BUFFER_MAX_TRAILER_SIZE
+#define OUT_PACKET_BUFFER_MAX_TRAILER_SIZE 32
+    // the most that "setTrailerSize()" (below) can reserve
+#endif
+
 class OutPacketBuffer {
 public:
   OutPacketBuffer(unsigned preferredPacketSize, unsigned maxPacketSize,
@@ -97,15 +102,23 @@ public:
 
   void skipBytes(unsigned numBytes);
 
+  Boolean setTrailerSize(unsigned trailerSize);
+      // Reserves room for a "trailerSize"-byte trailer (e.g., a SRTP MKI and authentication tag) that will be
+      // appended to each packet - in place - after it's been built.  Packets will then be built no larger than
+      // the 'max packet size' minus "trailerSize", and there'll always be at least "trailerSize" bytes of buffer
+      // space after the end of each packet.  (Note, however, that this space may hold the start of overflow data.)
+      // Returns False (reserving nothing) if "trailerSize" > OUT_PACKET_BUFFER_MAX_TRAILER_SIZE.
+  unsigned trailerSize() const { return fTrailerSize; }
+
   Boolean isPreferredSize() const {return fCurOffset >= fPreferred;}
   Boolean wouldOverflow(unsigned numBytes) const {
-    return (fCurOffset+numBytes) > fMax;
+    return (fCurOffset+numBytes) > fMax - fTrailerSize;
   }
   unsigned numOverflowBytes(unsigned numBytes) const {
-    return (fCurOffset+numBytes) - fMax;
+    return (fCurOffset+numBytes) - (fMax - fTrailerSize);
   }
   Boolean isTooBigForAPacket(unsigned numBytes) const {
-    return numBytes > fMax;
+    return numBytes > fMax - fTrailerSize;
   }
 
   void setOverflowData(unsigned overflowDataOffset,
@@ -124,7 +137,7 @@ public:
   void resetOverflowData() { fOverflowDataOffset = fOverflowDataSize = 0; }
 
 private:
-  unsigned fPacketStart, fCurOffset, fPreferred, fMax, fLimit;
+  unsigned fPacketStart, fCurOffset, fPreferred, fMax, fLimit, fTrailerSize;
   unsigned char* fBuf;
 
   unsigned fOverflowDataOffset, fOverflowDataSize;
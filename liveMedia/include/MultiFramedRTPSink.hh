@@ -78,6 +78,8 @@ protected:
   Boolean isFirstFrameInPacket() const { return fNumFramesUsedSoFar == 0; }
   unsigned curFragmentationOffset() const { return fCurFragmentationOffset; }
   void setMarkerBit();
+  void setKeyDataInPacket() { fCurPacketHasKeyData = True; }
+      // a hint (used when sending RTP-over-TCP) that this packet should be among the last to be dropped
   void setTimestamp(struct timeval framePresentationTime);
   void setSpecialHeaderWord(unsigned word, /* 32 bits, in host order */
 			    unsigned wordPosition = 0);
@@ -89,7 +91,9 @@ protected:
 				   unsigned bytePosition = 0);
   void setFramePadding(unsigned numPaddingBytes);
   unsigned numFramesUsedSoFar() const { return fNumFramesUsedSoFar; }
-  unsigned ourMaxPacketSize() const { return fOurMaxPacketSize; }
+  unsigned ourMaxPacketSize() const { return fOurMaxPacketSize - packetTrailerSize(); }
+      // (This excludes any SRTP trailer, which gets appended to each packet after it's built.)
+  unsigned packetTrailerSize() const;
 
 public: // redefined virtual functions:
   virtual void stopPlaying();
@@ -98,11 +102,15 @@ protected: // redefined virtual functions:
   virtual Boolean continuePlaying();
 
 private:
+  void sendBurst(Boolean isFirstPacket);
+  void beginBurst(Boolean& sinkWasDeleted);
+  void finishBurst(Boolean& sinkWasDeleted);
   void buildAndSendPacket(Boolean isFirstPacket);
   void packFrame();
   void sendPacketIfNecessary();
   static void sendNext(void* firstArg);
   friend void sendNext(void*);
+  Boolean endBatchedOutput();
 
   static void afterGettingFrame(void* clientData,
 				unsigned numBytesRead, unsigned numTruncatedBytes,
@@ -132,6 +140,12 @@ private:
   unsigned fCurFrameSpecificHeaderSize; // size in bytes of cur frame-specific header
   unsigned fTotalFrameSpecificHeaderSizes; // size of all frame-specific hdrs in pkt
   unsigned fOurMaxPacketSize;
+  Boolean fCurPacketHasKeyData;
+
+  // State used while sending a 'burst' of packets that are all due immediately:
+  Boolean fIsSendingBurst, fSendNextPacketImmediately;
+  Boolean* fSinkWasDeletedFlag; // non-NULL only during a burst
+  Groupsock* fBatchedOutputGroupsock; // non-NULL iff we enabled batched output on our groupsock for this burst
 
   onSendErrorFunc* fOnSendErrorFunc;
   void* fOnSendErrorData;
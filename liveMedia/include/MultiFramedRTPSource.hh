@@ -30,6 +30,20 @@ class BufferedPacket; // forward
 class BufferedPacketFactory; // forward
 
 class MultiFramedRTPSource: public RTPSource {
+public:
+  // Batched reception: When packets arrive over UDP, each 'readable' event reads up to this many waiting packets
+  // at once (using a single "recvmmsg()" system call, where available).  A value of 1 disables batching.
+  // (The default is 1 - i.e., batching is off unless you ask for it - and the maximum is 64.  Note that each packet
+  // buffer takes 64 KBytes, and we keep enough of them around to read a whole batch.)
+  void setMaxPacketsPerRead(unsigned maxPacketsPerRead);
+  unsigned maxPacketsPerRead() const { return fMaxPacketsPerRead; }
+
+  // Statistics for batched reception:
+  unsigned numReadWakeups() const { return fNumReadWakeups; }
+  u_int64_t numPacketsReadInBatches() const { return fNumPacketsReadInBatches; }
+      // (so the average number of packets read per wakeup is numPacketsReadInBatches()/numReadWakeups())
+  unsigned maxPacketsReadPerWakeup() const { return fMaxPacketsReadPerWakeup; }
+
 protected:
   MultiFramedRTPSource(UsageEnvironment& env, Groupsock* RTPgs,
 		       unsigned char rtpPayloadFormat,
@@ -66,6 +80,8 @@ private:
 
   static void networkReadHandler(MultiFramedRTPSource* source, int /*mask*/);
   void networkReadHandler1();
+  void readPacketBatch();
+  Boolean processNewPacket(BufferedPacket* bPacket, struct sockaddr_storage const& fromAddress);
 
   Boolean fAreDoingNetworkReads;
   BufferedPacket* fPacketReadInProgress;
@@ -76,6 +92,11 @@ private:
 
   // A buffer to (optionally) hold incoming pkts that have been reorderered
   class ReorderingPacketBuffer* fReorderingBuffer;
+
+  unsigned fMaxPacketsPerRead;
+  unsigned fNumReadWakeups;
+  u_int64_t fNumPacketsReadInBatches;
+  unsigned fMaxPacketsReadPerWakeup;
 };
 
 
@@ -92,6 +113,9 @@ public:
   unsigned useCount() const { return fUseCount; }
 
   Boolean fillInData(RTPInterface& rtpInterface, struct sockaddr_storage& fromAddress, Boolean& packetReadWasIncomplete);
+  unsigned char* prepareForBatchedRead(unsigned& maxBytesToRead);
+  void noteBatchedReadDone(unsigned numBytesRead) { fTail += numBytesRead; }
+      // Used (instead of "fillInData()") when several packets are read at once
   void assignMiscParams(unsigned short rtpSeqNo, unsigned rtpTimestamp,
 			struct timeval presentationTime,
 			Boolean hasBeenSyncedUsingRTCP,
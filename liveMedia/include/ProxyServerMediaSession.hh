@@ -131,6 +131,13 @@ public:
   Boolean describeCompletedSuccessfully() const { return fClientMediaSession != NULL; }
     // This can be used - along with "describeCompletedFlag" - to check whether the back-end "DESCRIBE" completed *successfully*.
 
+  void setGOPCacheSize(unsigned maxNumBytes) { fGOPCacheSize = maxNumBytes; }
+    // If "maxNumBytes" is non-zero, then each H.264 or H.265 video track keeps a copy of the most recent 'group of pictures'
+    // (up to this size) from the back-end stream, and each new front-end client is first sent this - as a burst - so that it
+    // can start decoding straight away, rather than waiting for the back-end stream's next key frame.  (Each such client
+    // then gets its own "RTPSink", fed by a "StreamReplicator".)
+    // Call this before the back-end "DESCRIBE" completes - e.g., immediately after "createNew()".
+
 protected:
   ProxyServerMediaSession(UsageEnvironment& env, GenericMediaServer* ourMediaServer,
 			  char const* inputStreamURL, char const* streamName,
@@ -180,6 +187,7 @@ private:
   MediaTranscodingTable* fTranscodingTable;
   portNumBits fInitialPortNum;
   Boolean fMultiplexRTCPWithRTP;
+  unsigned fGOPCacheSize;
 };
 
 
@@ -194,6 +202,10 @@ class PresentationTimeSubsessionNormalizer: public FramedFilter {
 public:
   void setRTPSink(RTPSink* rtpSink) { fRTPSink = rtpSink; }
 
+  // Used instead of "setRTPSink()" if our frames are replicated to several "RTPSink"s:
+  void addRTPSink(RTPSink* rtpSink);
+  void removeRTPSink(RTPSink* rtpSink);
+
 private:
   friend class PresentationTimeSessionNormalizer;
   PresentationTimeSubsessionNormalizer(PresentationTimeSessionNormalizer& parent, FramedSource* inputSource, RTPSource* rtpSource,
@@ -217,6 +229,7 @@ private:
   PresentationTimeSessionNormalizer& fParent;
   RTPSource* fRTPSource;
   RTPSink* fRTPSink;
+  HashTable* fReplicaRTPSinks; // those (added by "addRTPSink()") that still need RTCP "SR" reports to be enabled
   char const* fCodecName;
   PresentationTimeSubsessionNormalizer* fNext;
 };
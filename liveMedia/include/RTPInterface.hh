@@ -43,6 +43,17 @@ typedef void ServerRequestAlternativeByteHandler(void* instance, u_int8_t reques
 // the same TCP connection.  A RTSP server implementation would supply a function like this - as a parameter to
 // "ServerMediaSubsession::startStream()".
 
+// Statistics about the queue of RTP/RTCP-over-TCP data that's waiting to be written to a TCP socket
+// (because the socket's OS send buffer is full):
+struct TCPEgressQueueStats {
+  unsigned numQueuedPackets;
+  unsigned numQueuedBytes;
+  unsigned maxQueuedBytes; // the 'high-water mark' of "numQueuedBytes"
+  unsigned numDroppedPackets; // because the queue exceeded one of its limits (see below)
+  unsigned numDroppedKeyDataPackets; // those of "numDroppedPackets" that were marked as 'key data'
+  u_int64_t numDroppedBytes;
+};
+
 class RTPInterface {
 public:
   RTPInterface(Medium* owner, Groupsock* gs);
@@ -57,7 +68,24 @@ public:
 						     ServerRequestAlternativeByteHandler* handler, void* clientData);
   static void clearServerRequestAlternativeByteHandler(UsageEnvironment& env, int socketNum);
 
-  Boolean sendPacket(unsigned char* packet, unsigned packetSize);
+  Boolean sendPacket(unsigned char* packet, unsigned packetSize, Boolean isKeyData = False);
+      // "isKeyData" is a hint that's used only when sending RTP/RTCP-over-TCP: If a socket's egress queue
+      // (see below) exceeds its limits, then packets that are not 'key data' are dropped first.
+
+  // When sending RTP/RTCP-over-TCP, we never block.  If a socket's OS send buffer is full, then we queue
+  // the data that we couldn't write, and write it later (when the socket becomes writable).  If this queue
+  // gets larger than "tcpEgressQueueMaxBytes" - or contains packets that are older than
+  // "tcpEgressQueueMaxDelayMs" - then whole packets are dropped from it.
+  // (These limits apply to each socket.  Set them before starting to stream.)
+  static unsigned tcpEgressQueueMaxBytes;
+  static unsigned tcpEgressQueueMaxDelayMs;
+  static Boolean getTCPEgressQueueStats(UsageEnvironment& env, int socketNum, TCPEgressQueueStats& stats);
+      // Returns False if "socketNum" is not being used for RTP/RTCP-over-TCP.
+  static Boolean appendToTCPEgressQueue(UsageEnvironment& env, int socketNum,
+					u_int8_t const* data, unsigned dataSize);
+      // If RTP/RTCP-over-TCP data is waiting to be written to "socketNum", then appends "data" (which will not
+      // be dropped) to the queue, and returns True.  Otherwise returns False; the caller should write "data" itself.
+      // (A RTSP server uses this to send responses on a connection that's also used for RTP/RTCP-over-TCP.)
   void startNetworkReading(TaskScheduler::BackgroundHandlerProc*
                            handlerProc);
   Boolean handleRead(unsigned char* buffer, unsigned bufferMaxSize,
@@ -72,6 +100,13 @@ public:
   // Otherwise (if "tcpSocketNum" >= 0), the packet was received (interleaved) over TCP, and
   //   "tcpStreamChannelId" will return the channel id.
 
+  Boolean nextReadIsFromTCP() const { return fNextTCPReadStreamSocketNum >= 0; }
+  int handleReadBatch(unsigned numBuffers, unsigned char* const* buffers, unsigned const* bufferMaxSizes,
+		      // out parameters:
+		      unsigned* bytesRead, struct sockaddr_storage* fromAddresses);
+      // Reads up to "numBuffers" waiting packets at once from our 'groupsock'.  (This must not be called
+      // if "nextReadIsFromTCP()".)  Returns the number of packets read, or -1 on error.
+
   void stopNetworkReading();
 
   UsageEnvironment& envir() const { return fOwner->envir(); }
@@ -91,9 +126,7 @@ private:
   // Helper functions for sending a RTP or RTCP packet over a TCP connection:
   Boolean sendRTPorRTCPPacketOverTCP(unsigned char* packet, unsigned packetSize,
 				     int socketNum, unsigned char streamChannelId,
-				     TLSState* tlsState);
-  Boolean sendDataOverTCP(int socketNum, TLSState* tlsState,
-			  u_int8_t const* data, unsigned dataSize, Boolean forceSendToSucceed);
+				     TLSState* tlsState, Boolean isKeyData);
 
 private:
   friend class SocketDescriptor;
@@ -27,6 +27,11 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #ifndef _DIGEST_AUTHENTICATION_HH
 #include "DigestAuthentication.hh"
 #endif
+#ifndef _HLS_SEGMENT_STORE_HH
+#include "HLSSegmentStore.hh"
+#endif
+
+class RTSPServerWorkerGroup; // forward
 
 class RTSPServer: public GenericMediaServer {
 public:
@@ -109,6 +114,12 @@ public:
       //  and http://images.apple.com/br/quicktime/pdf/QTSS_Modules.pdf
   portNumBits httpServerPortNum() const; // in host byte order.  (Returns 0 if not present.)
 
+  void setHLSSegmentStore(HLSSegmentStore* hlsSegmentStore) { fHLSSegmentStore = hlsSegmentStore; }
+      // Serves - in response to HTTP "GET" requests (on our RTSP port, or our HTTP port, if any) - the HLS streams
+      // in "hlsSegmentStore": "<stream-name>.m3u8" returns a playlist (generated afresh for each request), and each
+      // segment is returned under its name in the playlist.  (Pass NULL to stop doing this.)
+      // Note: The caller is responsible for reclaiming "hlsSegmentStore" (after reclaiming us).
+
   void setTLSState(char const* certFileName, char const* privKeyFileName,
 		   Boolean weServeSRTP = True, Boolean weEncryptSRTP = True);
 
@@ -210,18 +221,33 @@ public: // should be protected, but some old compilers complain otherwise
     virtual void handleHTTPCmd_TunnelingGET(char const* sessionCookie);
     virtual Boolean handleHTTPCmd_TunnelingPOST(char const* sessionCookie, unsigned char const* extraData, unsigned extraDataSize);
     virtual void handleHTTPCmd_StreamingGET(char const* urlSuffix, char const* fullRequestStr);
+    virtual void handleHTTPCmd_HLSGET(char const* urlSuffix);
+        // used to implement "handleHTTPCmd_StreamingGET()", if our server has a "HLSSegmentStore"
   protected:
     void resetRequestBuffer();
     void closeSocketsRTSP();
     static void handleAlternativeRequestByte(void*, u_int8_t requestByte);
     void handleAlternativeRequestByte1(u_int8_t requestByte);
     virtual Boolean authenticationOK(char const* cmdName, char const* urlSuffix, char const* fullRequestStr);
+    Boolean handOffToStreamOwner(char const* cmdName, char const* urlPreSuffix, char const* urlSuffix);
+      // used only if our server is part of a "RTSPServerWorkerGroup"
     void changeClientInputSocket(int newSocketNum, ServerTLSState const* newTLSState,
 				 unsigned char const* extraData, unsigned extraDataSize);
       // used to implement RTSP-over-HTTP tunneling
     static void continueHandlingREGISTER(ParamsForREGISTER* params);
     virtual void continueHandlingREGISTER1(ParamsForREGISTER* params);
 
+    // Support for HTTP responses whose body is too large for "fResponseBuffer" (e.g., HLS segments).
+    // The body is sent after the response in "fResponseBuffer", without blocking.  Until it has all been sent,
+    // we don't handle any more requests on this connection:
+    void setHTTPResponseBody(unsigned char const* body, unsigned bodySize, HLSSegment* segment);
+        // If "segment" is non-NULL, "body" is its data, and we take over a reference to it; otherwise, we take
+        // ownership of "body" (which must have been allocated using "new[]")
+    Boolean sendHTTPResponseBody(); // returns True iff the whole body has now been sent (or the send has failed)
+    static void httpResponseBodyHandler(void*, int /*mask*/);
+    void httpResponseBodyHandler1();
+    void clearHTTPResponseBody();
+
     // Shortcuts for setting up a RTSP response (prior to sending it):
     void setRTSPResponse(char const* responseStr);
     void setRTSPResponse(char const* responseStr, u_int32_t sessionId);
@@ -241,6 +267,11 @@ public: // should be protected, but some old compilers complain otherwise
     char* fOurSessionCookie; // used for optional RTSP-over-HTTP tunneling
     unsigned fBase64RemainderCount; // used for optional RTSP-over-HTTP tunneling (possible values: 0,1,2,3)
     unsigned fScheduledDelayedTask;
+    Boolean fMayBeHandedOff; // used only if our server is part of a "RTSPServerWorkerGroup"
+    unsigned char const* fHTTPResponseBody; // non-NULL while a HTTP response body remains to be sent
+    unsigned fHTTPResponseBodySize, fHTTPResponseBodyBytesSent;
+    HLSSegment* fHTTPResponseBodySegment; // if non-NULL, owns "fHTTPResponseBody"
+    unsigned fNumDeferredRequestBytes; // bytes of pipelined requests, held until the response body has been sent
   };
 
   // The state of an individual client session (using one or more sequential TCP connections) handled by a RTSP server:
@@ -302,6 +333,8 @@ public: // should be protected, but some old compilers complain otherwise
   };
 
 protected: // redefined virtual functions
+  virtual void noteServerMediaSessionRemoval(ServerMediaSession* serverMediaSession);
+
   // If you subclass "RTSPClientConnection", then you must also redefine this virtual function in order
   // to create new objects of your subclass:
   virtual ClientConnection* createNewClientConnection(int clientSocket, struct sockaddr_storage const& clientAddr);
@@ -321,11 +354,17 @@ private:
   void unnoteTCPStreamingOnSocket(int socketNum, RTSPClientSession* clientSession, unsigned trackNum);
   void stopTCPStreamingOnSocket(int socketNum);
 
+  // Used to implement "RTSPServerWorkerGroup":
+  void setWorkerGroup(RTSPServerWorkerGroup* workerGroup, unsigned ourWorkerIndex);
+  void adoptHandedOffConnection(int clientSocket, struct sockaddr_storage const& clientAddr,
+				unsigned char const* requestBytes, unsigned numRequestBytes);
+
 private:
   friend class RTSPClientConnection;
   friend class RTSPClientSession;
   friend class RegisterRequestRecord;
   friend class DeregisterRequestRecord;
+  friend class RTSPServerWorkerGroup;
   int fHTTPServerSocketIPv4, fHTTPServerSocketIPv6; // for optional RTSP-over-HTTP tunneling
   Port fHTTPServerPort; // ditto
   HashTable* fClientConnectionsForHTTPTunneling; // maps client-supplied 'session cookie' strings to "RTSPClientConnection"s
@@ -339,6 +378,9 @@ private:
   Boolean fOurConnectionsUseTLS; // by default, False
   Boolean fWeServeSRTP; // used only if "fOurConnectionsUseTLS" is True
   Boolean fWeEncryptSRTP; // used only if "fWeServeSRTP" is True
+  RTSPServerWorkerGroup* fWorkerGroup; // by default, NULL
+  unsigned fWorkerIndex; // used only if "fWorkerGroup" is non-NULL
+  HLSSegmentStore* fHLSSegmentStore; // by default, NULL
 };
 
 
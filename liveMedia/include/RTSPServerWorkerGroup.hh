@@ -0,0 +1,92 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2026 Live Networks, Inc.  All rights reserved.
+// A group of "RTSPServer"s - each running in its own thread, with its own "UsageEnvironment" and
+// "TaskScheduler" - that share a single port, and that each own a disjoint set of streams.
+// C++ header
+
+#ifndef _RTSP_SERVER_WORKER_GROUP_HH
+#define _RTSP_SERVER_WORKER_GROUP_HH
+
+#ifndef NO_STD_LIB
+
+#ifndef _RTSP_SERVER_HH
+#include "RTSPServer.hh"
+#endif
+#include <mutex>
+
+// How to use this:
+// - Create one "RTSPServerWorkerGroup" object (from any thread), specifying the number of worker threads.
+// - In each worker thread, create a "TaskScheduler" and "UsageEnvironment", and then - enclosed by a
+//   "ReusePort" object (see "GroupsockHelper.hh") - a "RTSPServer" on the common port.  Then call
+//   "addWorker()" (from that thread), add this worker's streams to its "RTSPServer" (as usual), and
+//   enter the event loop.
+// The kernel (using SO_REUSEPORT) distributes incoming connections among the worker threads.  If a
+// connection's first "DESCRIBE" or "SETUP" names a stream that's owned by a different worker, then the
+// connection (its socket, and the request bytes that we've read so far) is handed off to that worker's
+// thread (using "triggerEvent()"), which then handles the request - and the rest of the connection - itself.
+// Note: Connections that use TLS or RTSP-over-HTTP tunneling are not handed off; they can access only
+// the streams that are owned by the worker that accepted them.
+class RTSPServerWorkerGroup {
+public:
+  RTSPServerWorkerGroup(unsigned numWorkers);
+  virtual ~RTSPServerWorkerGroup();
+      // Note: Delete this only after each worker has called "removeWorker()".
+
+  unsigned numWorkers() const { return fNumWorkers; }
+
+  Boolean addWorker(unsigned workerIndex, RTSPServer& rtspServer);
+      // Must be called from the worker's own thread (i.e., the thread that runs "rtspServer"'s event loop).
+      // Returns False if "workerIndex" is out of range (or already in use), or if no event trigger is available.
+  void removeWorker(unsigned workerIndex);
+      // Must also be called from the worker's own thread - before its "RTSPServer" is closed.
+
+  // The following functions are thread-safe.  (Normally they're called only by "RTSPServer".)
+  void noteStreamOwner(char const* streamName, unsigned workerIndex);
+  void forgetStreamOwner(char const* streamName, unsigned workerIndex);
+      // Does nothing unless "streamName" is currently owned by worker "workerIndex"
+  int lookupStreamOwner(char const* streamName);
+      // Returns the index of the worker that owns "streamName", or -1 if there's no such worker.
+  Boolean handOffConnection(unsigned toWorkerIndex, int clientSocket, struct sockaddr_storage const& clientAddr,
+			    unsigned char const* requestBytes, unsigned numRequestBytes);
+      // Returns False (leaving "clientSocket" untouched) if the connection cannot be handed off.
+      // Otherwise the receiving worker takes ownership of "clientSocket".
+
+private:
+  static void incomingHandOffHandler(void* clientData);
+  void incomingHandOffHandler1(unsigned workerIndex);
+
+private:
+  class HandOffRecord; // forward
+
+  struct Worker {
+    RTSPServer* fServer; // NULL iff this worker is not active
+    EventTriggerId fHandOffTrigger;
+    HandOffRecord* fFirstPending; HandOffRecord* fLastPending;
+    RTSPServerWorkerGroup* fOurGroup; // used as the trigger's 'client data'
+    unsigned fIndex;
+  };
+
+  unsigned fNumWorkers;
+  Worker* fWorkers;
+  HashTable* fStreamOwners; // maps stream names to (1 + worker index)
+  std::mutex fMutex; // protects all of the above
+};
+
+#endif
+
+#endif
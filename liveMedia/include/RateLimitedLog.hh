@@ -10,6 +10,9 @@
 // Both return N>0 if the caller should log now (N = events accumulated since
 // the previous log, including this one), or 0 to suppress. Logs at most once
 // every `windowSecs` wall-clock seconds.
+//
+// Neither variant locks its state.  If the code that logs can run in more than
+// one thread (e.g., with "RTSPServerWorkerGroup"), declare the state 'thread_local'.
 
 #ifndef _RATE_LIMITED_LOG_HH
 #define _RATE_LIMITED_LOG_HH
@@ -23,6 +23,9 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #ifndef _MIKEY_HH
 #include "MIKEY.hh"
 #endif
+#ifndef NO_OPENSSL
+#include <openssl/evp.h>
+#endif
 
 class SRTPCryptographicContext {
 public:
@@ -63,6 +66,12 @@ private:
     u_int8_t cipherKey[SRTP_CIPHER_KEY_LENGTH];
     u_int8_t salt[SRTP_CIPHER_SALT_LENGTH];
     u_int8_t authKey[SRTP_AUTH_KEY_LENGTH];
+
+    // Long-lived OpenSSL state for these keys (set up once, by "initCryptoState()"), so that
+    // we don't have to set it up again - or redo the key expansion - for each packet:
+    EVP_CIPHER_CTX* cipherContext; // AES-128 in counter mode, already keyed with "cipherKey"
+    EVP_MD_CTX* authInnerContext; // SHA-1, having already hashed the HMAC inner pad ("authKey" XOR 0x36s)
+    EVP_MD_CTX* authOuterContext; // SHA-1, having already hashed the HMAC outer pad ("authKey" XOR 0x5Cs)
   };
 
   struct allDerivedKeys {
@@ -106,9 +115,17 @@ private:
 				  u_int8_t const* dataToAuthenticate, unsigned numBytesToAuthenticate,
 				  u_int8_t const* authenticationTag);
 
+  void computeAuthenticationDigest(derivedKeys& keysToUse,
+				   u_int8_t const* dataToAuthenticate, unsigned numBytesToAuthenticate,
+				   u_int8_t* resultDigest);
+      // computes the (full, SHA1_DIGEST_LEN-byte) HMAC-SHA1 digest of the data, using "keysToUse"'s 'auth key'
+
   void cryptData(derivedKeys& keys, u_int64_t index, u_int32_t ssrc,
 		 u_int8_t* data, unsigned numDataBytes);
 
+  void initCryptoState(derivedKeys& keys);
+  void freeCryptoState(derivedKeys& keys);
+
   void performKeyDerivation();
 
   void deriveKeysFromMaster(u_int8_t const* masterKey, u_int8_t const* salt,
@@ -136,6 +153,7 @@ private:
 
   // Derived (i.e., session) keys:
   allDerivedKeys fDerivedKeys;
+  EVP_MD_CTX* fDigestContext; // scratch state, used to compute each HMAC from a precomputed inner/outer state
 
   // State used for handling the reception of SRTP packets:
   Boolean fHaveReceivedSRTPPackets;
@@ -26,18 +26,120 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #endif
 
 class StreamReplica; // forward
+class StreamReplicator; // forward
+
+// A read-only, reference-counted frame, shared by replicas.  (Used only by a "StreamReplicator" that was created with a
+// non-zero "sharedFrameBufferSize".)
+class StreamReplicatorFrame {
+public:
+  unsigned char const* data() const { return fData; }
+  unsigned frameSize() const { return fFrameSize; }
+  unsigned numTruncatedBytes() const { return fNumTruncatedBytes; }
+  struct timeval const& presentationTime() const { return fPresentationTime; }
+  unsigned durationInMicroseconds() const { return fDurationInMicroseconds; }
+
+  void incrementReferenceCount() { ++fReferenceCount; }
+  void decrementReferenceCount();
+    // When the count reaches 0, the frame's buffer is reused for a later frame (or freed, if the replicator has gone away)
+
+private:
+  friend class StreamReplicator;
+  StreamReplicatorFrame(StreamReplicator* ourReplicator, unsigned bufferSize);
+  virtual ~StreamReplicatorFrame();
+
+private:
+  StreamReplicator* fOurReplicator; // NULL if the replicator has been deleted while we were still referenced
+  unsigned char* fData;
+  unsigned fBufferSize;
+  unsigned fFrameSize, fNumTruncatedBytes;
+  struct timeval fPresentationTime;
+  unsigned fDurationInMicroseconds;
+  unsigned fReferenceCount;
+  StreamReplicatorFrame* fNextAllocated; // links all frames that our replicator has allocated
+  StreamReplicatorFrame* fNextFree; // links frames that are available for reuse
+};
+
+// What a "StreamReplicator" does when one replica's reader falls behind the others:
+enum StreamReplicatorSlowConsumerPolicy {
+  REPLICATOR_LOCK_STEP, // (the default) each frame is delivered to every replica before the next frame is read,
+                        // so the slowest replica's reader paces all of the others
+  REPLICATOR_DROP_OLDEST, // a replica whose queue is full loses its oldest queued frame
+  REPLICATOR_DROP_UNTIL_KEY_FRAME, // a replica whose queue is full loses all of its queued frames (except for
+                                   // 'parameter sets'), and then skips frames until the next 'key frame'
+  REPLICATOR_DETACH // a replica whose queue is full is detached: its reader sees the stream as having closed
+};
+
+// A function that says whether a frame is a 'key frame' - i.e., one from which a replica's reader can resume
+// after frames have been dropped - or (when used as a 'parameter set test') whether a frame is one that the
+// reader needs in order to decode a later key frame:
+typedef Boolean (StreamReplicatorKeyFrameTestFunc)(unsigned char const* frame, unsigned frameSize);
+
+// Statistics for a single replica:
+struct StreamReplicaStats {
+  unsigned numFramesQueued; // the replica's current lag, in frames (always 0 with "REPLICATOR_LOCK_STEP")
+  unsigned maxNumFramesQueued; // the replica's largest lag so far
+  unsigned numFramesDelivered;
+  unsigned numFramesDropped;
+  Boolean wasDetached;
+};
 
 class StreamReplicator: public Medium {
 public:
-  static StreamReplicator* createNew(UsageEnvironment& env, FramedSource* inputSource, Boolean deleteWhenLastReplicaDies = True);
+  static StreamReplicator* createNew(UsageEnvironment& env, FramedSource* inputSource, Boolean deleteWhenLastReplicaDies = True,
+				     unsigned sharedFrameBufferSize = 0);
     // If "deleteWhenLastReplicaDies" is True (the default), then the "StreamReplicator" object is deleted when (and only when)
     //   all replicas have been deleted.  (In this case, you must *not* call "Medium::close()" on the "StreamReplicator" object,
     //   unless you never created any replicas from it to begin with.)
     // If "deleteWhenLastReplicaDies" is False, then the "StreamReplicator" object remains in existence, even when all replicas
     //   have been deleted.  (This allows you to create new replicas later, if you wish.)  In this case, you delete the
     //   "StreamReplicator" object by calling "Medium::close()" on it - but you must do so only when "numReplicas()" returns 0.
-
-  FramedSource* createStreamReplica();
+    // If "sharedFrameBufferSize" is non-zero, then replicas created with "createStreamReplica(True)" are given each
+    //   frame - without it being copied - as a reference-counted buffer of this size: a "StreamReplicatorFrame".
+    //   (A frame is read directly into such a buffer if the first replica that requested it was created this way.
+    //   Otherwise it is read - as usual - into that replica's buffer, and copied into a shared buffer only if some other
+    //   replica needs it that way.  So ordinary replicas never cost more copies than they would without shared frames.)
+
+  FramedSource* createStreamReplica(Boolean deliversFrameViews = False);
+    // If "deliversFrameViews" is True, then the replica's reader should call "getNextFrame()" with a NULL buffer
+    //   (and a 'maxSize' of 0), and then - in its 'after getting' function - call "takeDeliveredFrame()" to get the frame.
+    //   (This requires a non-zero "sharedFrameBufferSize"; otherwise, NULL is returned.)
+
+  StreamReplicatorFrame* takeDeliveredFrame(FramedSource* replica);
+    // Returns the frame most recently delivered to "replica" (which must have been created by "createStreamReplica(True)"),
+    // or NULL if there's none.  The caller then owns one reference to the frame, and must eventually call
+    // "decrementReferenceCount()" on it.
+
+  Boolean setSlowConsumerPolicy(StreamReplicatorSlowConsumerPolicy policy, unsigned maxLagInFrames = 30,
+				StreamReplicatorKeyFrameTestFunc* keyFrameTest = NULL,
+				StreamReplicatorKeyFrameTestFunc* parameterSetTest = NULL);
+    // Call this before any replica has started reading.  Any policy other than "REPLICATOR_LOCK_STEP" requires a non-zero
+    //   "sharedFrameBufferSize"; otherwise, False is returned.  With such a policy, the input source is read whenever any
+    //   replica's reader asks for a frame that it doesn't yet have, and each replica gets its own queue of (at most
+    //   "maxLagInFrames") frames that it has not yet been given.  The policy says what to do when this queue is full.
+    // "keyFrameTest" and "parameterSetTest" are used only by "REPLICATOR_DROP_UNTIL_KEY_FRAME".  (If "keyFrameTest" is
+    //   NULL, every frame is a 'key frame'.)  Frames that pass "parameterSetTest" are never skipped, and are kept - one copy
+    //   of each - when a queue is flushed, so that the reader can decode the key frame that it resumes from.
+  StreamReplicatorSlowConsumerPolicy slowConsumerPolicy() const { return fSlowConsumerPolicy; }
+
+  Boolean setGOPCache(unsigned maxNumBytes);
+    // Call this after "setSlowConsumerPolicy()" (with a policy other than "REPLICATOR_LOCK_STEP", and a "keyFrameTest"),
+    //   but before any replica has started reading; otherwise, False is returned.
+    // If "maxNumBytes" is non-zero, then we keep copies of the frames of the most recent 'group of pictures' - i.e., from
+    //   the most recent run of key frames (e.g., a SPS, PPS and IDR picture) onwards.  Whenever a replica starts reading,
+    //   its queue is first filled with these frames, so that its reader can start decoding straight away, rather than
+    //   waiting for the next key frame.  (Cached parameter sets are kept for a following group that doesn't repeat them.)
+    // A group that's more than "maxLagInFrames" frames, or "maxNumBytes" bytes, long is not cached.
+    // (With a GOP cache, each frame is queued (and cached) as a single, right-sized copy - rather than in a buffer of size
+    //  "sharedFrameBufferSize" - so that queued frames don't each tie up a full-size buffer.)
+
+  Boolean getReplicaStats(FramedSource* replica, StreamReplicaStats& stats) const;
+    // Returns False if "replica" was not created by us
+
+  // Key frame and parameter set tests for H.264 and H.265 NAL units (with or without a leading 'start code'):
+  static Boolean isH264KeyFrame(unsigned char const* frame, unsigned frameSize);
+  static Boolean isH265KeyFrame(unsigned char const* frame, unsigned frameSize);
+  static Boolean isH264ParameterSet(unsigned char const* frame, unsigned frameSize);
+  static Boolean isH265ParameterSet(unsigned char const* frame, unsigned frameSize);
 
   unsigned numReplicas() const { return fNumReplicas; }
 
@@ -47,7 +149,8 @@ public:
   void detachInputSource() { fInputSource = NULL; }
 
 protected:
-  StreamReplicator(UsageEnvironment& env, FramedSource* inputSource, Boolean deleteWhenLastReplicaDies);
+  StreamReplicator(UsageEnvironment& env, FramedSource* inputSource, Boolean deleteWhenLastReplicaDies,
+		   unsigned sharedFrameBufferSize);
     // called only by "createNew()"
   virtual ~StreamReplicator();
 
@@ -58,6 +161,27 @@ private:
   void deactivateStreamReplica(StreamReplica* replica);
   void removeStreamReplica(StreamReplica* replica);
 
+  // Routines used only if our slow-consumer policy is not "REPLICATOR_LOCK_STEP":
+  void getNextFrameFromQueue(StreamReplica* replica);
+  void deactivateQueuedStreamReplica(StreamReplica* replica);
+  void queueReceivedFrame();
+  void queueFrameForReplica(StreamReplica* replica, StreamReplicatorFrame* frame);
+  unsigned flushQueueExceptParameterSets(StreamReplica* replica, StreamReplicatorFrame* newFrame);
+  void detachStreamReplica(StreamReplica* replica);
+  Boolean isKeyFrame(StreamReplicatorFrame* frame) const;
+  Boolean isParameterSet(StreamReplicatorFrame* frame) const;
+  void cacheFrame(StreamReplicatorFrame* frame);
+  void clearGOPCache(Boolean keepParameterSets = False);
+
+  // Routines used to manage shared frames:
+  friend class StreamReplicatorFrame;
+  void readNextFrame();
+  StreamReplicatorFrame* newFrame();
+  StreamReplicatorFrame* currentFrameFromPrimaryReplica();
+  StreamReplicatorFrame* compactCopy(StreamReplicatorFrame* frame);
+  void releaseCurrentFrame();
+  void recycleFrame(StreamReplicatorFrame* frame);
+
 private:
   static void afterGettingFrame(void* clientData, unsigned frameSize,
                                 unsigned numTruncatedBytes,
@@ -80,5 +204,23 @@ private:
   StreamReplica* fPrimaryReplica; // the first replica that requests each frame.  We use its buffer when copying to the others.
   StreamReplica* fReplicasAwaitingCurrentFrame; // other than the 'primary' replica
   StreamReplica* fReplicasAwaitingNextFrame; // replicas that have already received the current frame, and have asked for the next
+
+  unsigned fSharedFrameBufferSize; // 0 iff we don't use shared frames
+  StreamReplicatorFrame* fCurrentFrame; // (if we use shared frames) the frame that's being read or delivered
+  Boolean fPrimaryReplicaHasCurrentFrame; // True iff the current frame is being read (or was read) into the primary replica's buffer
+  StreamReplicatorFrame* fAllocatedFrames;
+  StreamReplicatorFrame* fFreeFrames;
+
+  StreamReplica* fAllReplicas;
+  StreamReplicatorSlowConsumerPolicy fSlowConsumerPolicy;
+  unsigned fMaxLagInFrames;
+  StreamReplicatorKeyFrameTestFunc* fKeyFrameTest;
+  StreamReplicatorKeyFrameTestFunc* fParameterSetTest;
+
+  unsigned fMaxGOPCacheBytes; // 0 iff we don't cache the most recent 'group of pictures'
+  StreamReplicatorFrame** fGOPCache; // (at most "fMaxLagInFrames") right-sized copies of the most recent group's frames
+  unsigned fNumCachedFrames, fNumCachedBytes;
+  Boolean fGOPCacheIsValid; // False if the current group has been too long to cache
+  Boolean fLastFrameWasKeyFrame;
 };
 #endif
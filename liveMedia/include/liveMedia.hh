@@ -131,7 +131,9 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "OggFileServerDemux.hh"
 #include "MPEG2TransportStreamDemux.hh"
 #include "ProxyServerMediaSession.hh"
+#include "RTSPServerWorkerGroup.hh"
 #include "HLSSegmenter.hh"
+#include "HLSSegmentStore.hh"
 #include "MPEG2TransportStreamAccumulator.hh"
 
 #endif
@@ -24,7 +24,12 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 int main(int argc, char** argv) {
   // Begin by setting up our usage environment:
-  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  // (On Linux, we use an "epoll()"-based scheduler, so that we can handle many more sockets efficiently.)
+  TaskScheduler* scheduler = NULL;
+#ifdef HAVE_EPOLL_TASK_SCHEDULER
+  scheduler = EpollTaskScheduler::createNew();
+#endif
+  if (scheduler == NULL) scheduler = BasicTaskScheduler::createNew();
   UsageEnvironment* env = BasicUsageEnvironment::createNew(*scheduler);
 
   UserAuthenticationDatabase* authDB = NULL;
@@ -19,6 +19,11 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 #include "liveMedia.hh"
 #include "BasicUsageEnvironment.hh"
+#include "GroupsockHelper.hh"
+#ifndef NO_STD_LIB
+#include <thread>
+#include <future>
+#endif
 
 char const* progName;
 UsageEnvironment* env;
@@ -36,6 +41,17 @@ Boolean proxyREGISTERRequests = False;
 char* usernameForREGISTER = NULL;
 char* passwordForREGISTER = NULL;
 unsigned interPacketGapMaxTime = 10;
+unsigned numWorkerThreads = 1;
+
+// -w: the maximum number of worker threads that we allow.  (Each worker thread runs its own event loop
+// and "RTSPServer" - all sharing the same port - and proxies its own share of the back-end streams.)
+#define PROXY_MAX_WORKER_THREADS 64
+#ifndef NO_STD_LIB
+RTSPServerWorkerGroup* workerGroup = NULL;
+Boolean workerIsRunning[PROXY_MAX_WORKER_THREADS];
+  // Set (by the main thread - worker 0 - before it creates its own streams) for each worker thread that started
+  // successfully.  Worker 0 takes over the URLs of any worker thread that failed to start.
+#endif
 
 // -e: custom stream-name prefix exposed to downstream clients. When serving a
 // single rtsp:// URL the proxy publishes it as "rtsp://.../<prefix>"; for N
@@ -50,14 +66,97 @@ char const* streamNamePrefix = "proxyStream";
 char* clientAuthUsername = NULL;
 char* clientAuthPassword = NULL;
 
-static RTSPServer* createRTSPServer(Port port) {
+// -g: the maximum size (in kBytes) of the 'group of pictures' that we cache for each H.264/H.265 track, so that new
+// downstream clients can start decoding straight away.  0 (the default) means: don't cache.
+unsigned gopCacheKBytes = 0;
+
+static TaskScheduler* createTaskScheduler() {
+  // (On Linux, we use an "epoll()"-based scheduler, so that we can handle many more sockets efficiently.)
+  TaskScheduler* scheduler = NULL;
+#ifdef HAVE_EPOLL_TASK_SCHEDULER
+  scheduler = EpollTaskScheduler::createNew();
+#endif
+  if (scheduler == NULL) scheduler = BasicTaskScheduler::createNew();
+  return scheduler;
+}
+
+static RTSPServer* createRTSPServer(UsageEnvironment& ourEnv, Port port) {
+  // If we have several worker threads, then each one's server socket must be able to share the same port:
+  ReusePort* reusePort = numWorkerThreads > 1 ? new ReusePort(ourEnv) : NULL;
+
+  RTSPServer* rtspServer;
   if (proxyREGISTERRequests) {
-    return RTSPServerWithREGISTERProxying::createNew(*env, port, authDB, authDBForREGISTER, 65, streamRTPOverTCP, verbosityLevel, username, password);
+    rtspServer = RTSPServerWithREGISTERProxying::createNew(ourEnv, port, authDB, authDBForREGISTER, 65, streamRTPOverTCP, verbosityLevel, username, password);
   } else {
-    return RTSPServer::createNew(*env, port, authDB);
+    rtspServer = RTSPServer::createNew(ourEnv, port, authDB);
   }
+
+  delete reusePort;
+  return rtspServer;
 }
 
+// Create a proxy for each "rtsp://" URL specified on the command line (or, if we have several worker threads,
+// for each URL that's assigned - round-robin - to the worker thread "workerIndex").
+// Stream name is "<prefix>" for a single URL and "<prefix>-<i>" for many.
+// Buffer holds up to PROXY_STREAM_NAME_PREFIX_MAX + "-" + 10-digit index + NUL.
+static void createProxyStreams(UsageEnvironment& ourEnv, RTSPServer* rtspServer,
+			       int argc, char** argv, unsigned workerIndex) {
+  for (int i = 1; i < argc; ++i) {
+    unsigned urlWorkerIndex = (unsigned)(i-1)%numWorkerThreads;
+    Boolean urlIsOurs = urlWorkerIndex == workerIndex;
+#ifndef NO_STD_LIB
+    // Worker 0 also proxies the URLs of any worker thread that failed to start:
+    if (workerIndex == 0 && numWorkerThreads > 1 && !workerIsRunning[urlWorkerIndex]) urlIsOurs = True;
+#endif
+    if (!urlIsOurs) continue; // this URL is handled by another worker thread
+
+    char const* proxiedStreamURL = argv[i];
+    char streamName[PROXY_STREAM_NAME_PREFIX_MAX + 16];
+    if (argc == 2) {
+      snprintf(streamName, sizeof streamName, "%s", streamNamePrefix);
+    } else {
+      snprintf(streamName, sizeof streamName, "%s-%d", streamNamePrefix, i);
+    }
+    ProxyServerMediaSession* sms
+      = ProxyServerMediaSession::createNew(ourEnv, rtspServer,
+					   proxiedStreamURL, streamName,
+					   username, password, tunnelOverHTTPPortNum, verbosityLevel, -1, NULL, interPacketGapMaxTime);
+    sms->setGOPCacheSize(gopCacheKBytes*1000);
+    rtspServer->addServerMediaSession(sms);
+
+    char* proxyStreamURL = rtspServer->rtspURL(sms);
+    ourEnv << "RTSP stream, proxying the stream \"" << proxiedStreamURL << "\"\n";
+    ourEnv << "\tPlay this stream using the URL: " << proxyStreamURL << "\n";
+    delete[] proxyStreamURL;
+  }
+}
+
+#ifndef NO_STD_LIB
+// The body of each additional worker thread (i.e., other than the main thread, which is worker 0):
+// It reports (using "startupResult") whether it started successfully, before it creates its streams.
+static void runWorkerThread(unsigned workerIndex, int argc, char** argv, std::promise<bool>* startupResult) {
+  TaskScheduler* scheduler = createTaskScheduler();
+  UsageEnvironment* workerEnv = BasicUsageEnvironment::createNew(*scheduler);
+
+  RTSPServer* rtspServer = createRTSPServer(*workerEnv, rtspServerPortNum);
+  if (rtspServer == NULL) {
+    *workerEnv << "Worker thread " << workerIndex << ": Failed to create RTSP server: " << workerEnv->getResultMsg() << "\n";
+    startupResult->set_value(false);
+    return;
+  }
+  if (!workerGroup->addWorker(workerIndex, *rtspServer)) {
+    *workerEnv << "Worker thread " << workerIndex << ": Failed to join the worker group\n";
+    Medium::close(rtspServer);
+    startupResult->set_value(false);
+    return;
+  }
+  startupResult->set_value(true);
+  createProxyStreams(*workerEnv, rtspServer, argc, argv, workerIndex);
+
+  workerEnv->taskScheduler().doEventLoop(); // does not return
+}
+#endif
+
 void usage() {
   *env << "Usage: " << progName
        << " [-v|-V]"
@@ -68,6 +167,10 @@ void usage() {
        << " [-D <max-inter-packet-gap-time>]"
        << " [-e <stream-name-prefix>]"
        << " [-C <client-username> <client-password>]"
+       << " [-g <max-GOP-cache-kbytes>]"
+#ifndef NO_STD_LIB
+       << " [-w <num-worker-threads>]"
+#endif
        << " <rtsp-url-1> ... <rtsp-url-n>\n"
        << "  -e <stream-name-prefix>   Publish streams as <prefix> (single URL) or\n"
        << "                             <prefix>-1..-n (multiple). Max "
@@ -75,7 +178,16 @@ void usage() {
        << " chars. Default: \"proxyStream\".\n"
        << "  -C <user> <pass>          Require downstream RTSP clients to authenticate\n"
        << "                             with these credentials (digest auth). Separate\n"
-       << "                             from -u, which is for the back-end/proxied stream.\n";
+       << "                             from -u, which is for the back-end/proxied stream.\n"
+       << "  -g <max-GOP-cache-kbytes>  Cache each H.264/H.265 track's latest group of pictures\n"
+       << "                             (up to this size), and send it to each new client, so\n"
+       << "                             that it can start decoding immediately. Default: 0 (off).\n"
+#ifndef NO_STD_LIB
+       << "  -w <num-worker-threads>   Share the RTSP port among this many threads (max "
+       << PROXY_MAX_WORKER_THREADS << "),\n"
+       << "                             each proxying its own share of the streams. Default: 1.\n"
+#endif
+       ;
   exit(1);
 }
 
@@ -85,7 +197,7 @@ int main(int argc, char** argv) {
   OutPacketBuffer::maxSize = 2000000; // bytes
 
   // Begin by setting up our usage environment:
-  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  TaskScheduler* scheduler = createTaskScheduler();
   env = BasicUsageEnvironment::createNew(*scheduler);
 
   *env << "LIVE555 Proxy Server\n"
@@ -209,6 +321,35 @@ int main(int argc, char** argv) {
       break;
     }
 
+    case 'g': { // specify the maximum size of the 'group of pictures' to cache for each H.264/H.265 track
+      if (argc > 2 && argv[2][0] != '-') {
+        if (sscanf(argv[2], "%u", &gopCacheKBytes) == 1 && gopCacheKBytes <= 4000000) {
+          ++argv; --argc;
+          break;
+        }
+      }
+
+      // If we get here, the option was specified incorrectly:
+      usage();
+      break;
+    }
+
+#ifndef NO_STD_LIB
+    case 'w': { // specify the number of worker threads
+      if (argc > 2 && argv[2][0] != '-') {
+        if (sscanf(argv[2], "%u", &numWorkerThreads) == 1
+            && numWorkerThreads > 0 && numWorkerThreads <= PROXY_MAX_WORKER_THREADS) {
+          ++argv; --argc;
+          break;
+        }
+      }
+
+      // If we get here, the option was specified incorrectly:
+      usage();
+      break;
+    }
+#endif
+
     default: {
       usage();
       break;
@@ -257,47 +398,56 @@ int main(int argc, char** argv) {
   // and then with the default port number (554) if different,
   // and then with the alternative port number (8554):
   RTSPServer* rtspServer;
-  rtspServer = createRTSPServer(rtspServerPortNum);
+  rtspServer = createRTSPServer(*env, rtspServerPortNum);
   if (rtspServer == NULL) {
     if (rtspServerPortNum != 554) {
       *env << "Unable to create a RTSP server with port number " << rtspServerPortNum << ": " << env->getResultMsg() << "\n";
       *env << "Trying instead with the standard port numbers (554 and 8554)...\n";
 
       rtspServerPortNum = 554;
-      rtspServer = createRTSPServer(rtspServerPortNum);
+      rtspServer = createRTSPServer(*env, rtspServerPortNum);
     }
   }
   if (rtspServer == NULL) {
     rtspServerPortNum = 8554;
-    rtspServer = createRTSPServer(rtspServerPortNum);
+    rtspServer = createRTSPServer(*env, rtspServerPortNum);
   }
   if (rtspServer == NULL) {
     *env << "Failed to create RTSP server: " << env->getResultMsg() << "\n";
     exit(1);
   }
 
-  // Create a proxy for each "rtsp://" URL specified on the command line.
-  // Stream name is "<prefix>" for a single URL and "<prefix>-<i>" for many.
-  // Buffer holds up to PROXY_STREAM_NAME_PREFIX_MAX + "-" + 10-digit index + NUL.
-  for (i = 1; i < argc; ++i) {
-    char const* proxiedStreamURL = argv[i];
-    char streamName[PROXY_STREAM_NAME_PREFIX_MAX + 16];
-    if (argc == 2) {
-      snprintf(streamName, sizeof streamName, "%s", streamNamePrefix);
-    } else {
-      snprintf(streamName, sizeof streamName, "%s-%d", streamNamePrefix, i);
+#ifndef NO_STD_LIB
+  if (numWorkerThreads > 1) {
+    // The main thread is worker 0.  Start the other worker threads (now that we know our final port number).
+    // Each connection is accepted by whichever thread the kernel chooses, and - if necessary - is then handed off
+    // to the thread that proxies the requested stream:
+    workerGroup = new RTSPServerWorkerGroup(numWorkerThreads);
+    if (!workerGroup->addWorker(0, *rtspServer)) {
+      *env << "Failed to set up the worker group\n";
+      exit(1);
+    }
+    workerIsRunning[0] = True;
+
+    // Start the other worker threads, and wait until each has reported whether it started OK.  (Any worker
+    // thread that failed has its URLs proxied by us - worker 0 - instead.)
+    std::promise<bool>* startupResults = new std::promise<bool>[numWorkerThreads];
+    unsigned numRunning = 1;
+    for (unsigned w = 1; w < numWorkerThreads; ++w) {
+      std::future<bool> startedOK = startupResults[w].get_future();
+      std::thread(runWorkerThread, w, argc, argv, &startupResults[w]).detach();
+      workerIsRunning[w] = startedOK.get();
+      if (workerIsRunning[w]) ++numRunning;
+    }
+    delete[] startupResults; // each worker thread has already finished using its "std::promise"
+    *env << "(We use " << numRunning << " worker threads, sharing port " << rtspServerPortNum << ")\n";
+    if (numRunning < numWorkerThreads) {
+      *env << "(" << numWorkerThreads - numRunning << " worker threads failed to start; their streams are proxied by worker 0)\n";
     }
-    ServerMediaSession* sms
-      = ProxyServerMediaSession::createNew(*env, rtspServer,
-					   proxiedStreamURL, streamName,
-					   username, password, tunnelOverHTTPPortNum, verbosityLevel, -1, NULL, interPacketGapMaxTime);
-    rtspServer->addServerMediaSession(sms);
-
-    char* proxyStreamURL = rtspServer->rtspURL(sms);
-    *env << "RTSP stream, proxying the stream \"" << proxiedStreamURL << "\"\n";
-    *env << "\tPlay this stream using the URL: " << proxyStreamURL << "\n";
-    delete[] proxyStreamURL;
   }
+#endif
+
+  createProxyStreams(*env, rtspServer, argc, argv, 0);
 
   if (proxyREGISTERRequests) {
     *env << "(We handle incoming \"REGISTER\" requests on port " << rtspServerPortNum << ")\n";
@@ -306,6 +456,7 @@ int main(int argc, char** argv) {
   // Also, attempt to create a HTTP server for RTSP-over-HTTP tunneling.
   // Try first with the default HTTP port (80), and then with the alternative HTTP
   // port numbers (8000 and 8080).
+  // (Note: If we have several worker threads, then only worker 0's streams are available this way.)
 
   if (rtspServer->setUpTunnelingOverHTTP(80) || rtspServer->setUpTunnelingOverHTTP(8000) || rtspServer->setUpTunnelingOverHTTP(8080)) {
     *env << "\n(We use port " << rtspServer->httpServerPortNum() << " for optional RTSP-over-HTTP tunneling.)\n";
@@ -0,0 +1,82 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2026, Live Networks, Inc.  All rights reserved
+// A microbenchmark that measures the cost of scheduling ("scheduleDelayedTask()") and cancelling
+// ("unscheduleDelayedTask()") a delayed task, as a function of the number of tasks already pending.
+// main program
+
+#include "BasicUsageEnvironment.hh"
+#include "GroupsockHelper.hh" // for "our_random()"
+#include <stdlib.h>
+
+static void dummyTask(void* /*clientData*/) {}
+
+static double now() { // in seconds
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec/1000000.0;
+}
+
+static int64_t randomDelay() { // somewhere between 1 and 1000 seconds
+  return 1000000 + (int64_t)(our_random()%1000000000);
+}
+
+int main(int argc, char** argv) {
+  unsigned const numOps = 100000; // the number of schedule+cancel pairs timed at each depth
+  unsigned const depths[] = { 10, 100, 1000, 10000, 100000 };
+  unsigned const numDepths = sizeof depths/sizeof depths[0];
+
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  UsageEnvironment* env = BasicUsageEnvironment::createNew(*scheduler);
+
+  *env << "queue depth\tschedule (ns)\tcancel (ns)\n";
+  TaskToken* background = new TaskToken[depths[numDepths-1]];
+  TaskToken* tokens = new TaskToken[numOps];
+  for (unsigned d = 0; d < numDepths; ++d) {
+    // Fill the queue to the desired depth:
+    for (unsigned i = 0; i < depths[d]; ++i) {
+      background[i] = scheduler->scheduleDelayedTask(randomDelay(), dummyTask, NULL);
+    }
+
+    // Time scheduling "numOps" more tasks:
+    double startTime = now();
+    for (unsigned i = 0; i < numOps; ++i) {
+      tokens[i] = scheduler->scheduleDelayedTask(randomDelay(), dummyTask, NULL);
+    }
+    double scheduleTime = now() - startTime;
+
+    // Time cancelling them again, in a different order from the one in which they were scheduled:
+    for (unsigned i = numOps - 1; i > 0; --i) {
+      unsigned j = our_random()%(i+1);
+      TaskToken t = tokens[i]; tokens[i] = tokens[j]; tokens[j] = t;
+    }
+    startTime = now();
+    for (unsigned i = 0; i < numOps; ++i) {
+      scheduler->unscheduleDelayedTask(tokens[i]);
+    }
+    double cancelTime = now() - startTime;
+
+    char line[100];
+    snprintf(line, sizeof line, "%u\t\t%.1f\t\t%.1f\n", depths[d], scheduleTime*1e9/numOps, cancelTime*1e9/numOps);
+    *env << line;
+
+    for (unsigned i = 0; i < depths[d]; ++i) scheduler->unscheduleDelayedTask(background[i]);
+  }
+
+  delete[] tokens; delete[] background;
+  env->reclaim(); delete scheduler;
+  return 0;
+}
@@ -0,0 +1,154 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2026, Live Networks, Inc.  All rights reserved
+// A microbenchmark that compares the cost of "Add()", "Lookup()", "Remove()" and "RemoveNext()" for the two
+// "HashTable" implementations ("BasicHashTable" and "OpenAddressingHashTable"), as a function of
+// the number of entries, for both string keys (like stream names and session ids) and one-word
+// keys (like socket numbers and SSRCs).  It also checks that both implementations give the same results.
+// main program
+
+#include "BasicUsageEnvironment.hh"
+#include "GroupsockHelper.hh" // for "our_random()"
+#include <stdlib.h>
+
+static double now() { // in seconds
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec/1000000.0;
+}
+
+static UsageEnvironment* env;
+static Boolean allOK = True;
+
+static void check(Boolean condition, char const* what, unsigned numEntries, Boolean useOpenAddressing) {
+  if (condition) return;
+
+  *env << "FAILED: " << what << " (" << numEntries << " entries, "
+       << (useOpenAddressing ? "open addressing" : "chained") << ")\n";
+  allOK = False;
+}
+
+static void runOne(int keyType, char const* const* keys, unsigned numEntries, Boolean useOpenAddressing) {
+  HashTable* table = HashTable::create(keyType, useOpenAddressing);
+
+  // Time adding all of the entries.  (Each entry's value is its index + 1.)
+  double startTime = now();
+  for (unsigned i = 0; i < numEntries; ++i) {
+    table->Add(keys[i], (void*)(uintptr_t)(i+1));
+  }
+  double addTime = now() - startTime;
+  check(table->numEntries() == numEntries, "numEntries() after Add()", numEntries, useOpenAddressing);
+
+  // Time looking up every entry (in a different order from the one in which they were added),
+  // plus the same number of keys that aren't present:
+  unsigned* order = new unsigned[numEntries];
+  for (unsigned i = 0; i < numEntries; ++i) order[i] = i;
+  for (unsigned i = numEntries - 1; i > 0; --i) {
+    unsigned j = our_random()%(i+1);
+    unsigned t = order[i]; order[i] = order[j]; order[j] = t;
+  }
+  unsigned numFound = 0;
+  Boolean valuesOK = True;
+  startTime = now();
+  for (unsigned i = 0; i < numEntries; ++i) {
+    uintptr_t value = (uintptr_t)table->Lookup(keys[order[i]]);
+    if (value != order[i]+1) valuesOK = False;
+    if (table->Lookup(keys[numEntries+order[i]]) != NULL) ++numFound; // keys[numEntries...] were never added
+  }
+  double lookupTime = now() - startTime;
+  check(valuesOK, "Lookup() of a present key", numEntries, useOpenAddressing);
+  check(numFound == 0, "Lookup() of an absent key", numEntries, useOpenAddressing);
+
+  // Remove every other entry, then check that iteration sees exactly the others:
+  startTime = now();
+  for (unsigned i = 0; i < numEntries; i += 2) table->Remove(keys[order[i]]);
+  double removeTime = now() - startTime;
+  unsigned numIterated = 0;
+  Boolean iterationOK = True;
+  HashTable::Iterator* iter = HashTable::Iterator::create(*table);
+  char const* key;
+  void* value;
+  while ((value = iter->next(key)) != NULL) {
+    ++numIterated;
+    if (table->Lookup(key) != value) iterationOK = False;
+  }
+  delete iter;
+  check(iterationOK && numIterated == numEntries/2 && table->numEntries() == numEntries/2,
+	"iteration after Remove()", numEntries, useOpenAddressing);
+
+  // Finally, time emptying the table, the way that much of our code does:
+  startTime = now();
+  while (table->RemoveNext() != NULL) {}
+  double drainTime = now() - startTime;
+  check(table->IsEmpty(), "RemoveNext()", numEntries, useOpenAddressing);
+  delete table;
+  delete[] order;
+
+  char line[200];
+  snprintf(line, sizeof line, "%u\t\t%s\t%s\t%.1f\t\t%.1f\t\t%.1f\t\t%.1f\n",
+	   numEntries, keyType == STRING_HASH_KEYS ? "string  " : "one-word",
+	   useOpenAddressing ? "open   " : "chained",
+	   addTime*1e9/numEntries, lookupTime*1e9/(2*numEntries), removeTime*1e9/((numEntries+1)/2),
+	   drainTime*1e9/(numEntries/2));
+  *env << line;
+}
+
+int main(int argc, char** argv) {
+  unsigned const sizes[] = { 1000, 10000, 100000 };
+      // (Note: Emptying a large "BasicHashTable" using "RemoveNext()" takes time quadratic in its size, so we stop here.)
+  unsigned const numSizes = sizeof sizes/sizeof sizes[0];
+  unsigned const maxNumKeys = 2*sizes[numSizes-1]; // half are present; half are absent
+
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  env = BasicUsageEnvironment::createNew(*scheduler);
+
+  // Make the keys.  String keys look like stream names; one-word keys are random 32-bit values (like SSRCs).
+  char** stringKeys = new char*[maxNumKeys];
+  char const** oneWordKeys = new char const*[maxNumKeys];
+  for (unsigned i = 0; i < maxNumKeys; ++i) {
+    char name[30];
+    snprintf(name, sizeof name, "stream%u.264", i);
+    stringKeys[i] = strDup(name);
+    oneWordKeys[i] = (char const*)(uintptr_t)(((u_int32_t)our_random()<<16) ^ (u_int32_t)our_random() ^ (i<<1) ^ 1);
+  }
+  // (Make sure that the one-word keys are distinct, by replacing any duplicates with unused values:)
+  HashTable* seen = HashTable::create(ONE_WORD_HASH_KEYS);
+  for (unsigned i = 0; i < maxNumKeys; ++i) {
+    while (seen->Lookup(oneWordKeys[i]) != NULL) oneWordKeys[i] = (char const*)((uintptr_t)oneWordKeys[i] + 2);
+    seen->Add(oneWordKeys[i], (void*)1);
+  }
+  delete seen;
+
+  *env << "entries\t\tkey type\ttable\tadd (ns)\tlookup (ns)\tremove (ns)\tRemoveNext (ns)\n";
+  for (unsigned s = 0; s < numSizes; ++s) {
+    char const** keys = new char const*[2*sizes[s]];
+    for (int keyType = STRING_HASH_KEYS; keyType <= ONE_WORD_HASH_KEYS; ++keyType) {
+      for (unsigned i = 0; i < 2*sizes[s]; ++i) {
+	keys[i] = keyType == STRING_HASH_KEYS ? stringKeys[i] : oneWordKeys[i];
+      }
+      runOne(keyType, keys, sizes[s], False);
+      runOne(keyType, keys, sizes[s], True);
+    }
+    delete[] keys;
+  }
+
+  for (unsigned i = 0; i < maxNumKeys; ++i) delete[] stringKeys[i];
+  delete[] stringKeys; delete[] oneWordKeys;
+
+  *env << (allOK ? "All checks passed\n" : "Some checks FAILED\n");
+  env->reclaim(); delete scheduler;
+  return allOK ? 0 : 1;
+}
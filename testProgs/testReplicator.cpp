@@ -66,8 +66,10 @@ int main(int argc, char** argv) {
   // Then create a liveMedia 'source' object, encapsulating this groupsock:
   FramedSource* source = BasicUDPSource::createNew(*env, &inputGroupsock);
 
-  // And feed this into a 'stream replicator':
-  StreamReplicator* replicator = StreamReplicator::createNew(*env, source);
+  // And feed this into a 'stream replicator'.  (We give it a 'shared frame buffer', so that our file sink -
+  // below - can write each frame without it having to be copied into the sink's buffer first.):
+  unsigned const maxFrameSize = 65536; // allow for large UDP packets
+  StreamReplicator* replicator = StreamReplicator::createNew(*env, source, True, maxFrameSize);
 
   // Then create a network (UDP) 'sink' object to receive a replica of the input stream, and start it.
   // If you wish, you can duplicate this line - with different network addresses and ports - to create multiple output UDP streams:
@@ -106,11 +108,12 @@ void startReplicaUDPSink(StreamReplicator* replicator, char const* outputAddress
 }
 
 void startReplicaFileSink(StreamReplicator* replicator, char const* outputFileName) {
-  // Begin by creating an input stream from our replicator:
-  FramedSource* source = replicator->createStreamReplica();
+  // Begin by creating an input stream - one that delivers 'frame views' - from our replicator:
+  FramedSource* source = replicator->createStreamReplica(True);
 
   // Then create a 'file sink' object to receive thie replica stream:
-  MediaSink* sink = FileSink::createNew(*env, outputFileName);
+  FileSink* sink = FileSink::createNew(*env, outputFileName);
+  sink->readFrameViewsFrom(replicator);
 
   // Now, start playing, feeding the sink object from the source:
   sink->startPlaying(*source, NULL, NULL);
@@ -0,0 +1,125 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2026, Live Networks, Inc.  All rights reserved
+// A microbenchmark that measures how many RTP packets/second "SRTPCryptographicContext" can protect
+// (encrypt + authenticate) and unprotect (authenticate + decrypt), for several payload sizes.
+// It also checks that each packet round-trips intact, and prints a digest of all of the protected
+// packets.  (Because the keys are generated from a fixed random seed, this digest should be the same
+// for any build of the library, so it can be used to check that an optimization hasn't changed the output.)
+// main program
+
+#include "liveMedia.hh"
+#include "BasicUsageEnvironment.hh"
+#include "GroupsockHelper.hh" // for "our_srandom()"
+
+static double now() { // in seconds
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec/1000000.0;
+}
+
+#define RTP_HEADER_SIZE 12
+#define SRTP_TRAILER_SIZE (4+10) // MKI + authentication tag
+#define BATCH_SIZE 1000 // packets protected (then unprotected) at a time
+
+int main(int argc, char** argv) {
+  unsigned const payloadSizes[] = { 160, 500, 1400 };
+  unsigned const numPayloadSizes = sizeof payloadSizes/sizeof payloadSizes[0];
+  unsigned const numPacketsPerSize = 200000; // enough to cross a RTP sequence number rollover
+
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  UsageEnvironment* env = BasicUsageEnvironment::createNew(*scheduler);
+
+  our_srandom(1); // so that the keys (and thus the protected packets) are the same each time
+  MIKEYState* mikeyState = MIKEYState::createNew();
+  Boolean allOK = True;
+
+  *env << "payload (bytes)\tprotect (packets/s)\tunprotect (packets/s)\n";
+  u_int32_t digest = 2166136261U; // FNV-1a, over every protected packet
+  unsigned const maxPacketSize = RTP_HEADER_SIZE + payloadSizes[numPayloadSizes-1] + SRTP_TRAILER_SIZE;
+  u_int8_t* packets = new u_int8_t[BATCH_SIZE*maxPacketSize];
+  unsigned packetSizes[BATCH_SIZE];
+
+  for (unsigned s = 0; s < numPayloadSizes; ++s) {
+    unsigned const payloadSize = payloadSizes[s];
+    unsigned const rtpPacketSize = RTP_HEADER_SIZE + payloadSize;
+
+    // Each payload size gets new sender and receiver contexts (so each starts with sequence number 0):
+    SRTPCryptographicContext* sender = new SRTPCryptographicContext(*mikeyState);
+    SRTPCryptographicContext* receiver = new SRTPCryptographicContext(*mikeyState);
+    double protectTime = 0.0, unprotectTime = 0.0;
+
+    for (unsigned base = 0; base < numPacketsPerSize; base += BATCH_SIZE) {
+      // Fill in a batch of RTP packets:
+      for (unsigned i = 0; i < BATCH_SIZE; ++i) {
+	u_int8_t* pkt = &packets[i*maxPacketSize];
+	u_int16_t seqNum = (u_int16_t)(base + i);
+	pkt[0] = 0x80; pkt[1] = 96; pkt[2] = seqNum>>8; pkt[3] = (u_int8_t)seqNum;
+	pkt[4] = pkt[5] = pkt[6] = pkt[7] = 0; // timestamp
+	pkt[8] = 0x12; pkt[9] = 0x34; pkt[10] = 0x56; pkt[11] = 0x78; // SSRC
+	for (unsigned j = 0; j < payloadSize; ++j) pkt[RTP_HEADER_SIZE+j] = (u_int8_t)(j + base + i);
+      }
+
+      // Protect them:
+      double startTime = now();
+      for (unsigned i = 0; i < BATCH_SIZE; ++i) {
+	if (!sender->processOutgoingSRTPPacket(&packets[i*maxPacketSize], rtpPacketSize, packetSizes[i])) allOK = False;
+      }
+      protectTime += now() - startTime;
+
+      for (unsigned i = 0; i < BATCH_SIZE; ++i) {
+	u_int8_t const* pkt = &packets[i*maxPacketSize];
+	for (unsigned j = 0; j < packetSizes[i]; ++j) digest = (digest ^ pkt[j])*16777619U;
+      }
+
+      // Then unprotect them:
+      startTime = now();
+      for (unsigned i = 0; i < BATCH_SIZE; ++i) {
+	unsigned outPacketSize;
+	if (!receiver->processIncomingSRTPPacket(&packets[i*maxPacketSize], packetSizes[i], outPacketSize)
+	    || outPacketSize != rtpPacketSize) {
+	  allOK = False;
+	}
+      }
+      unprotectTime += now() - startTime;
+
+      // Check that we got back what we started with:
+      for (unsigned i = 0; i < BATCH_SIZE; ++i) {
+	u_int8_t const* pkt = &packets[i*maxPacketSize];
+	for (unsigned j = 0; j < payloadSize; ++j) {
+	  if (pkt[RTP_HEADER_SIZE+j] != (u_int8_t)(j + base + i)) { allOK = False; break; }
+	}
+      }
+    }
+
+    char line[200];
+    snprintf(line, sizeof line, "%u\t\t%.0f\t\t\t%.0f\n", payloadSize,
+	     numPacketsPerSize/protectTime, numPacketsPerSize/unprotectTime);
+    *env << line;
+
+    delete sender; delete receiver;
+  }
+
+  char digestStr[20];
+  snprintf(digestStr, sizeof digestStr, "%08x", digest);
+  *env << "digest of protected packets: " << digestStr << "\n";
+  *env << (allOK ? "All checks passed\n" : "Some checks FAILED\n");
+
+  delete[] packets;
+  delete mikeyState;
+  env->reclaim(); delete scheduler;
+  return allOK ? 0 : 1;
+}
@@ -0,0 +1,465 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2026, Live Networks, Inc.  All rights reserved
+// A test program for the "StreamReplicator" class.  It feeds a synthetic stream of frames to replicas of
+// different kinds (with and without 'shared frames'; ordinary replicas, and replicas that deliver 'frame views'),
+// and checks that every replica's reader gets every frame, intact.  It also checks what a slow reader gets
+// under each 'slow-consumer policy', and what a late-starting reader gets from a 'GOP cache'.
+// Exits with status 0 iff all checks pass.
+// main program
+
+#include "liveMedia.hh"
+#include "BasicUsageEnvironment.hh"
+#include <stdio.h>
+
+UsageEnvironment* env;
+static unsigned const numFrames = 500;
+static unsigned const maxFrameSize = 2000;
+static unsigned numFailures = 0;
+
+static void check(Boolean condition, char const* testName, char const* what) {
+  if (!condition) {
+    *env << testName << ": FAILED: " << what << "\n";
+    ++numFailures;
+  }
+}
+
+// The contents of synthetic frame #i.  If "useH264FramePattern" is True, then each frame is also a H.264 NAL unit;
+// each 'GOP' of "gopSize" frames begins with a SPS, PPS and IDR picture (with the same SPS and PPS each time):
+static Boolean useH264FramePattern = False;
+static unsigned const gopSize = 10;
+enum { SPS = 0x67, PPS = 0x68, IDR = 0x65, NON_IDR = 0x41 };
+
+static u_int8_t nalUnitHeader(unsigned i) {
+  switch (i%gopSize) {
+    case 0: return SPS;
+    case 1: return PPS;
+    case 2: return IDR;
+    default: return NON_IDR;
+  }
+}
+static Boolean isParameterSet(unsigned i) { return useH264FramePattern && i%gopSize < 2; }
+
+static unsigned frameSize(unsigned i) { return isParameterSet(i) ? 12 : 100 + (i*37)%(maxFrameSize-100); }
+static unsigned char frameByte(unsigned i, unsigned j) {
+  if (useH264FramePattern && j == 0) return nalUnitHeader(i);
+  return isParameterSet(i) ? (unsigned char)j : (unsigned char)(i*7 + j);
+}
+
+////////// A source that generates "numFrames" synthetic frames, and then closes //////////
+
+static Boolean sourceHasClosed;
+
+class SyntheticFrameSource: public FramedSource {
+public:
+  SyntheticFrameSource(UsageEnvironment& env)
+    : FramedSource(env), fNumFramesGenerated(0) {
+  }
+
+private:
+  virtual void doGetNextFrame() {
+    if (fNumFramesGenerated == numFrames) {
+      sourceHasClosed = True;
+      handleClosure();
+      return;
+    }
+
+    unsigned i = fNumFramesGenerated++;
+    unsigned size = frameSize(i);
+    if (size > fMaxSize) {
+      fNumTruncatedBytes = size - fMaxSize;
+      size = fMaxSize;
+    }
+    for (unsigned j = 0; j < size; ++j) fTo[j] = frameByte(i, j);
+    fFrameSize = size;
+    fPresentationTime.tv_sec = i; fPresentationTime.tv_usec = 0; // lets the reader check which frame it got
+
+    // Deliver the frame via the event loop (as a real source would):
+    nextTask() = envir().taskScheduler().scheduleDelayedTask(0, (TaskFunc*)FramedSource::afterGetting, this);
+  }
+
+private:
+  unsigned fNumFramesGenerated;
+};
+
+////////// A sink that checks each frame that it gets //////////
+
+// A sink checks that each frame is intact, and that it comes later in the stream than the frames before it.  It can be
+// made a 'slow' reader: one that - after its first frame - stalls for a while (or until the source has closed):
+
+class CheckingSink: public MediaSink {
+public:
+  CheckingSink(UsageEnvironment& env, StreamReplicator* viewReplicator = NULL)
+    : MediaSink(env), fViewReplicator(viewReplicator), fNumFramesReceived(0), fNumBadFrames(0),
+      fStallMilliseconds(0), fStallsUntilSourceCloses(False) {
+    fBuffer = new unsigned char[maxFrameSize];
+    fFrameData = new unsigned char const*[numFrames];
+    fFrameIndex = new unsigned[numFrames];
+  }
+  virtual ~CheckingSink() {
+    envir().taskScheduler().unscheduleDelayedTask(nextTask());
+    delete[] fFrameIndex;
+    delete[] fFrameData;
+    delete[] fBuffer;
+  }
+
+  void stall(unsigned milliseconds) { fStallMilliseconds = milliseconds; }
+  void stallUntilSourceCloses() { fStallsUntilSourceCloses = True; }
+
+  unsigned numFramesReceived() const { return fNumFramesReceived; }
+  unsigned numBadFrames() const { return fNumBadFrames; }
+  unsigned char const* frameData(unsigned k) const { return fFrameData[k]; } // where our k'th frame was read from
+  unsigned frameIndex(unsigned k) const { return fFrameIndex[k]; } // the stream position of our k'th frame
+
+private:
+  virtual Boolean continuePlaying() {
+    if (fSource == NULL) return False;
+
+    if (fViewReplicator != NULL) {
+      fSource->getNextFrame(NULL, 0, afterGettingFrame, this, onSourceClosure, this);
+    } else {
+      fSource->getNextFrame(fBuffer, maxFrameSize, afterGettingFrame, this, onSourceClosure, this);
+    }
+    return True;
+  }
+
+  static void afterGettingFrame(void* clientData, unsigned frameSize, unsigned numTruncatedBytes,
+				struct timeval presentationTime, unsigned /*durationInMicroseconds*/) {
+    ((CheckingSink*)clientData)->afterGettingFrame(frameSize, numTruncatedBytes, presentationTime);
+  }
+  void afterGettingFrame(unsigned size, unsigned numTruncatedBytes, struct timeval presentationTime) {
+    unsigned char const* data = fBuffer;
+    StreamReplicatorFrame* frame = NULL;
+    if (fViewReplicator != NULL) {
+      frame = fViewReplicator->takeDeliveredFrame(fSource);
+      data = frame == NULL ? NULL : frame->data();
+    }
+
+    unsigned k = fNumFramesReceived++;
+    unsigned i = (unsigned)presentationTime.tv_sec;
+    Boolean isGood = k < numFrames && i < numFrames && (k == 0 || i > fFrameIndex[k-1])
+      && data != NULL && numTruncatedBytes == 0 && size == frameSize(i);
+    for (unsigned j = 0; isGood && j < size; ++j) {
+      if (data[j] != frameByte(i, j)) isGood = False;
+    }
+    if (!isGood) ++fNumBadFrames;
+    if (k < numFrames) { fFrameData[k] = data; fFrameIndex[k] = i; }
+
+    if (frame != NULL) frame->decrementReferenceCount();
+
+    if (k == 0 && (fStallMilliseconds > 0 || fStallsUntilSourceCloses)) {
+      nextTask() = envir().taskScheduler().scheduleDelayedTask(fStallMilliseconds*1000, endStall, this);
+    } else {
+      continuePlaying();
+    }
+  }
+
+  static void endStall(void* clientData) {
+    CheckingSink* sink = (CheckingSink*)clientData;
+    sink->nextTask() = NULL;
+    if (sink->fStallsUntilSourceCloses && !sourceHasClosed) {
+      sink->nextTask() = sink->envir().taskScheduler().scheduleDelayedTask(5000, endStall, sink); // check again later
+      return;
+    }
+    sink->continuePlaying();
+  }
+
+private:
+  StreamReplicator* fViewReplicator;
+  unsigned char* fBuffer;
+  unsigned char const** fFrameData;
+  unsigned* fFrameIndex;
+  unsigned fNumFramesReceived, fNumBadFrames;
+  unsigned fStallMilliseconds;
+  Boolean fStallsUntilSourceCloses;
+};
+
+////////// The tests //////////
+
+static unsigned numSinksPlaying;
+static EventLoopWatchVariable doneFlag;
+
+static void afterPlaying(void* /*clientData*/) {
+  if (--numSinksPlaying == 0) doneFlag = ~0;
+}
+
+// Replicates our synthetic stream to "numReplicas" readers (starting them in order); replica #k delivers
+// frame views iff bit k of "viewReplicaMask" is set:
+static void testReplication(char const* testName, unsigned sharedFrameBufferSize,
+			    unsigned numReplicas, unsigned viewReplicaMask) {
+  StreamReplicator* replicator
+    = StreamReplicator::createNew(*env, new SyntheticFrameSource(*env), True, sharedFrameBufferSize);
+
+  unsigned const maxNumReplicas = 8;
+  FramedSource* replicas[maxNumReplicas];
+  CheckingSink* sinks[maxNumReplicas];
+  for (unsigned k = 0; k < numReplicas; ++k) {
+    Boolean deliversFrameViews = (viewReplicaMask&(1<<k)) != 0;
+    replicas[k] = replicator->createStreamReplica(deliversFrameViews);
+    sinks[k] = new CheckingSink(*env, deliversFrameViews ? replicator : NULL);
+  }
+
+  numSinksPlaying = numReplicas;
+  doneFlag = 0;
+  sourceHasClosed = False;
+  for (unsigned k = 0; k < numReplicas; ++k) sinks[k]->startPlaying(*replicas[k], afterPlaying, NULL);
+  env->taskScheduler().doEventLoop(&doneFlag);
+
+  unsigned firstViewReplica = numReplicas;
+  for (unsigned k = 0; k < numReplicas; ++k) {
+    check(sinks[k]->numFramesReceived() == numFrames, testName, "a replica didn't get every frame");
+    check(sinks[k]->numBadFrames() == 0, testName, "a replica got a damaged frame");
+
+    if ((viewReplicaMask&(1<<k)) == 0) continue;
+    if (firstViewReplica == numReplicas) { firstViewReplica = k; continue; }
+
+    // Frame views must be views of the same (shared) frame - i.e., not copies:
+    for (unsigned i = 0; i < numFrames && i < sinks[k]->numFramesReceived(); ++i) {
+      if (sinks[k]->frameData(i) != sinks[firstViewReplica]->frameData(i)) {
+	check(False, testName, "replicas that deliver frame views were given different copies of a frame");
+	break;
+      }
+    }
+  }
+
+  // Closing the last replica also deletes the replicator (and its input source):
+  for (unsigned k = 0; k < numReplicas; ++k) {
+    Medium::close(sinks[k]);
+    Medium::close(replicas[k]);
+  }
+
+  *env << testName << ": done\n";
+}
+
+// Checks that a "FileSink" that reads frame views writes the same output as one that reads ordinary frames:
+static void testFileSinkViews() {
+  char const* testName = "FileSink frame views";
+  char const* ordinaryFileName = "testStreamReplicator-ordinary.out";
+  char const* viewFileName = "testStreamReplicator-views.out";
+
+  StreamReplicator* replicator = StreamReplicator::createNew(*env, new SyntheticFrameSource(*env), True, maxFrameSize);
+  FramedSource* ordinaryReplica = replicator->createStreamReplica();
+  FramedSource* viewReplica = replicator->createStreamReplica(True);
+
+  FileSink* ordinarySink = FileSink::createNew(*env, ordinaryFileName, maxFrameSize);
+  FileSink* viewSink = FileSink::createNew(*env, viewFileName);
+  if (ordinarySink == NULL || viewSink == NULL) {
+    check(False, testName, "couldn't open an output file");
+    return;
+  }
+  viewSink->readFrameViewsFrom(replicator);
+
+  numSinksPlaying = 2;
+  doneFlag = 0;
+  sourceHasClosed = False;
+  ordinarySink->startPlaying(*ordinaryReplica, afterPlaying, NULL);
+  viewSink->startPlaying(*viewReplica, afterPlaying, NULL);
+  env->taskScheduler().doEventLoop(&doneFlag);
+
+  Medium::close(ordinarySink); Medium::close(viewSink); // closes the output files
+  Medium::close(ordinaryReplica); Medium::close(viewReplica);
+
+  // Compare the two files, and check their contents:
+  FILE* ordinaryFid = fopen(ordinaryFileName, "rb");
+  FILE* viewFid = fopen(viewFileName, "rb");
+  Boolean filesMatch = ordinaryFid != NULL && viewFid != NULL;
+  unsigned i = 0, j = 0;
+  while (filesMatch) {
+    int c1 = fgetc(ordinaryFid), c2 = fgetc(viewFid);
+    if (c1 != c2) filesMatch = False;
+    if (c1 == EOF || !filesMatch) break;
+
+    if (c1 != frameByte(i, j)) filesMatch = False;
+    if (++j == frameSize(i)) { ++i; j = 0; }
+  }
+  check(filesMatch && i == numFrames, testName, "the output files differ from each other, or from the input");
+  if (ordinaryFid != NULL) fclose(ordinaryFid);
+  if (viewFid != NULL) fclose(viewFid);
+  remove(ordinaryFileName); remove(viewFileName);
+
+  *env << testName << ": done\n";
+}
+
+// Replicates our synthetic stream to a fast reader and a slow reader, using "policy", and checks what each reader gets:
+static void testSlowConsumerPolicy(char const* testName, StreamReplicatorSlowConsumerPolicy policy) {
+  unsigned const maxLagInFrames = 11;
+  useH264FramePattern = policy == REPLICATOR_DROP_UNTIL_KEY_FRAME;
+
+  StreamReplicator* replicator = StreamReplicator::createNew(*env, new SyntheticFrameSource(*env), True, maxFrameSize);
+  if (!replicator->setSlowConsumerPolicy(policy, maxLagInFrames,
+					 StreamReplicator::isH264KeyFrame, StreamReplicator::isH264ParameterSet)) {
+    check(False, testName, "setSlowConsumerPolicy() failed");
+    Medium::close(replicator);
+    return;
+  }
+  FramedSource* fastReplica = replicator->createStreamReplica();
+  FramedSource* slowReplica = replicator->createStreamReplica(True);
+  CheckingSink* fastSink = new CheckingSink(*env);
+  CheckingSink* slowSink = new CheckingSink(*env, replicator);
+  if (policy == REPLICATOR_LOCK_STEP) {
+    slowSink->stall(50); // (it would wait forever for the source to close)
+  } else {
+    slowSink->stallUntilSourceCloses();
+  }
+
+  numSinksPlaying = 2;
+  doneFlag = 0;
+  sourceHasClosed = False;
+  fastSink->startPlaying(*fastReplica, afterPlaying, NULL);
+  slowSink->startPlaying(*slowReplica, afterPlaying, NULL);
+  env->taskScheduler().doEventLoop(&doneFlag);
+
+  StreamReplicaStats stats;
+  check(replicator->getReplicaStats(slowReplica, stats), testName, "getReplicaStats() failed");
+  unsigned numReceived = slowSink->numFramesReceived();
+
+  check(fastSink->numFramesReceived() == numFrames && fastSink->numBadFrames() == 0, testName,
+	"the fast reader didn't get every frame, intact");
+  check(slowSink->numBadFrames() == 0, testName, "the slow reader got a damaged (or out-of-order) frame");
+  check(stats.numFramesDelivered == numReceived, testName, "the slow reader's 'frames delivered' count is wrong");
+
+  switch (policy) {
+    case REPLICATOR_LOCK_STEP: {
+      check(numReceived == numFrames, testName, "the slow reader didn't get every frame");
+      break;
+    }
+    case REPLICATOR_DROP_OLDEST: {
+      // The slow reader gets its first frame, and then the last "maxLagInFrames" frames:
+      check(numReceived == 1 + maxLagInFrames && slowSink->frameIndex(numReceived-1) == numFrames-1, testName,
+	    "the slow reader didn't get the most recent frames");
+      check(stats.numFramesDropped == numFrames - numReceived && stats.maxNumFramesQueued == maxLagInFrames, testName,
+	    "the slow reader's 'frames dropped' or 'max frames queued' count is wrong");
+      break;
+    }
+    case REPLICATOR_DROP_UNTIL_KEY_FRAME: {
+      // Everything that the slow reader gets must be decodable: After a gap, it must get no non-IDR picture until it
+      // has got an IDR picture, and it must have got a SPS and a PPS before each IDR picture:
+      Boolean haveSPS = False, havePPS = False, needIDR = False, isDecodable = True;
+      for (unsigned k = 0; k < numReceived; ++k) {
+	unsigned i = slowSink->frameIndex(k);
+	if (k > 0 && i != slowSink->frameIndex(k-1) + 1) needIDR = True;
+	switch (nalUnitHeader(i)) {
+	  case SPS: { haveSPS = True; break; }
+	  case PPS: { havePPS = True; break; }
+	  case IDR: {
+	    if (!haveSPS || !havePPS) isDecodable = False;
+	    needIDR = False;
+	    break;
+	  }
+	  default: {
+	    if (needIDR) isDecodable = False;
+	    break;
+	  }
+	}
+      }
+      check(numReceived < numFrames, testName, "the slow reader wasn't made to drop frames");
+      check(isDecodable, testName, "the slow reader got a frame that it can't decode");
+      check(stats.numFramesDelivered + stats.numFramesDropped == numFrames, testName,
+	    "the slow reader's 'frames dropped' count is wrong");
+      break;
+    }
+    case REPLICATOR_DETACH: {
+      check(numReceived == 1 && stats.wasDetached, testName, "the slow reader wasn't detached");
+      break;
+    }
+  }
+
+  Medium::close(fastSink); Medium::close(slowSink);
+  Medium::close(fastReplica); Medium::close(slowReplica); // also deletes the replicator
+  useH264FramePattern = False;
+
+  *env << testName << ": done\n";
+}
+
+// Checks that - with a GOP cache - a reader that starts part way through a 'group of pictures' is first given all
+// of that group (from its SPS onwards), and then every later frame:
+static unsigned const lateStartFrame = 255;
+static CheckingSink* earlySink;
+static CheckingSink* lateSink;
+static FramedSource* lateReplica;
+
+static void startLateSink(void* /*clientData*/) {
+  if (earlySink->numFramesReceived() < lateStartFrame) { // not yet
+    env->taskScheduler().scheduleDelayedTask(0, startLateSink, NULL);
+    return;
+  }
+  lateSink->startPlaying(*lateReplica, afterPlaying, NULL);
+}
+
+static void testGOPCache() {
+  char const* testName = "GOP cache";
+  useH264FramePattern = True;
+
+  StreamReplicator* replicator = StreamReplicator::createNew(*env, new SyntheticFrameSource(*env), True, maxFrameSize);
+  if (!replicator->setSlowConsumerPolicy(REPLICATOR_DROP_UNTIL_KEY_FRAME, 3*gopSize,
+					 StreamReplicator::isH264KeyFrame, StreamReplicator::isH264ParameterSet)
+      || !replicator->setGOPCache(gopSize*maxFrameSize)) {
+    check(False, testName, "setSlowConsumerPolicy() or setGOPCache() failed");
+    Medium::close(replicator);
+    useH264FramePattern = False;
+    return;
+  }
+  FramedSource* earlyReplica = replicator->createStreamReplica();
+  lateReplica = replicator->createStreamReplica(True);
+  earlySink = new CheckingSink(*env);
+  lateSink = new CheckingSink(*env, replicator);
+
+  numSinksPlaying = 2;
+  doneFlag = 0;
+  sourceHasClosed = False;
+  earlySink->startPlaying(*earlyReplica, afterPlaying, NULL);
+  env->taskScheduler().scheduleDelayedTask(0, startLateSink, NULL);
+  env->taskScheduler().doEventLoop(&doneFlag);
+
+  check(earlySink->numFramesReceived() == numFrames && earlySink->numBadFrames() == 0, testName,
+	"the early reader didn't get every frame, intact");
+  unsigned numReceived = lateSink->numFramesReceived();
+  unsigned firstFrame = numReceived == 0 ? 0 : lateSink->frameIndex(0);
+  check(lateSink->numBadFrames() == 0, testName, "the late reader got a damaged (or out-of-order) frame");
+  check(numReceived > 0 && firstFrame%gopSize == 0 && firstFrame <= lateStartFrame && firstFrame + gopSize > lateStartFrame,
+	testName, "the late reader wasn't given the start of the current 'group of pictures'");
+  check(numReceived == numFrames - firstFrame, testName, "the late reader didn't get every frame after its first");
+
+  Medium::close(earlySink); Medium::close(lateSink);
+  Medium::close(earlyReplica); Medium::close(lateReplica); // also deletes the replicator
+  useH264FramePattern = False;
+
+  *env << testName << ": done\n";
+}
+
+int main(int /*argc*/, char** /*argv*/) {
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  env = BasicUsageEnvironment::createNew(*scheduler);
+
+  testReplication("no shared frames", 0, 3, 0x0);
+  testReplication("shared frames, ordinary replicas only", maxFrameSize, 3, 0x0);
+  testReplication("shared frames, ordinary replica first", maxFrameSize, 4, 0xC);
+  testReplication("shared frames, view replica first", maxFrameSize, 4, 0x3);
+  testReplication("shared frames, view replicas only", maxFrameSize, 3, 0x7);
+  testFileSinkViews();
+  testSlowConsumerPolicy("lock-step", REPLICATOR_LOCK_STEP);
+  testSlowConsumerPolicy("drop oldest", REPLICATOR_DROP_OLDEST);
+  testSlowConsumerPolicy("drop until key frame", REPLICATOR_DROP_UNTIL_KEY_FRAME);
+  testSlowConsumerPolicy("detach", REPLICATOR_DETACH);
+  testGOPCache();
+
+  if (numFailures > 0) {
+    *env << numFailures << " check(s) FAILED\n";
+    return 1;
+  }
+  *env << "All checks passed\n";
+  return 0;
+}
@@ -0,0 +1,205 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2026, Live Networks, Inc.  All rights reserved
+// A benchmark for the start code search in our H.264 and H.265 video stream parsers.  It builds a synthetic
+// 'Annex B' byte stream in memory - NAL units of random sizes, separated by a mix of 3-byte and 4-byte start codes -
+// and feeds it through a "H264VideoStreamFramer" (or "H265VideoStreamFramer"), timing how quickly the stream is
+// split into NAL units, and checking that each NAL unit comes out intact.  It also checks that NAL units that are
+// several MBytes long (like the IDR frames of 4K video) come out intact.
+// main program
+
+#include "liveMedia.hh"
+#include "BasicUsageEnvironment.hh"
+#include "GroupsockHelper.hh" // for "our_random()"
+
+static double now() { // in seconds
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec/1000000.0;
+}
+
+#define STREAM_SIZE (64*1024*1024)
+#define MAX_NAL_UNIT_SIZE 5000000
+#define MAX_NUM_NAL_UNITS (STREAM_SIZE/4)
+
+static UsageEnvironment* env;
+
+////////// The synthetic stream //////////
+
+static u_int8_t* stream;
+static unsigned streamSize;
+static unsigned* nalStart; // the offset (within "stream") of each NAL unit
+static unsigned* nalSize;
+static unsigned numNALUnits;
+
+// Builds a stream of H.264 or H.265 NAL units.  The payload bytes are random, except that - if "zeroRich" - about
+// 1 byte in 16 begins a run of zero bytes.  (As in a real encoder's output, 'emulation prevention' bytes (0x03) keep
+// "0x000000" - "0x000003" from appearing inside a NAL unit, and no NAL unit ends with a zero byte.)
+static void makeStream(unsigned hNumber, Boolean zeroRich, unsigned maxPayloadSize) {
+  streamSize = 0;
+  numNALUnits = 0;
+
+  while (numNALUnits < MAX_NUM_NAL_UNITS) {
+    // Most NAL units are large (like slices), but some are tiny (like parameter sets and SEIs):
+    unsigned payloadSize = our_random()%4 == 0 ? our_random()%16 : our_random()%maxPayloadSize;
+    if (streamSize + 4 + 2 + 2*payloadSize + 1 + 8 > STREAM_SIZE) break; // (allows for emulation prevention bytes)
+
+    // The start code (always 4 bytes for the first NAL unit):
+    if (numNALUnits == 0 || our_random()%2 == 0) stream[streamSize++] = 0;
+    stream[streamSize++] = 0; stream[streamSize++] = 0; stream[streamSize++] = 1;
+    nalStart[numNALUnits] = streamSize;
+
+    // The NAL unit header (a non-IDR or IDR slice):
+    Boolean isIDR = our_random()%30 == 0;
+    if (hNumber == 264) {
+      stream[streamSize++] = isIDR ? 0x65 : 0x41;
+    } else {
+      stream[streamSize++] = isIDR ? (19<<1) : (1<<1);
+      stream[streamSize++] = 0x01;
+    }
+
+    // The payload:
+    unsigned numZeros = 0; // the number of consecutive zero bytes that we've just output
+    for (unsigned i = 0; i < payloadSize; ++i) {
+      u_int8_t byte = (u_int8_t)our_random();
+      if (zeroRich && (byte&0x0F) == 0) {
+	for (unsigned j = byte>>5; j > 0 && i < payloadSize; --j, ++i) { // a run of up to 7 zero bytes
+	  if (numZeros == 2) { stream[streamSize++] = 0x03; numZeros = 0; }
+	  stream[streamSize++] = 0; ++numZeros;
+	}
+	byte = (u_int8_t)our_random();
+      }
+      if (numZeros == 2 && byte <= 3) { stream[streamSize++] = 0x03; numZeros = 0; }
+      stream[streamSize++] = byte;
+      numZeros = byte == 0 ? numZeros+1 : 0;
+    }
+    if (stream[streamSize-1] == 0) stream[streamSize++] = 0x80; // like a "rbsp_stop_one_bit"
+
+    nalSize[numNALUnits] = streamSize - nalStart[numNALUnits];
+    ++numNALUnits;
+  }
+
+  // End with a (4-byte) 'filler data' NAL unit.  We don't count this one, because the framer doesn't deliver the
+  // NAL unit that's ended by EOF (rather than by a start code):
+  stream[streamSize++] = 0; stream[streamSize++] = 0; stream[streamSize++] = 0; stream[streamSize++] = 1;
+  if (hNumber == 264) {
+    stream[streamSize++] = 12; stream[streamSize++] = 0xFF;
+  } else {
+    stream[streamSize++] = 38<<1; stream[streamSize++] = 0x01;
+  }
+  stream[streamSize++] = 0xFF; stream[streamSize++] = 0x80;
+}
+
+////////// A sink that checks each NAL unit that it gets //////////
+
+class CheckingSink: public MediaSink {
+public:
+  CheckingSink(UsageEnvironment& env)
+    : MediaSink(env), fNumNALUnitsReceived(0), fNumBadNALUnits(0) {
+    fBuffer = new unsigned char[MAX_NAL_UNIT_SIZE];
+  }
+  virtual ~CheckingSink() {
+    delete[] fBuffer;
+  }
+
+  unsigned numNALUnitsReceived() const { return fNumNALUnitsReceived; }
+  unsigned numBadNALUnits() const { return fNumBadNALUnits; }
+
+private:
+  virtual Boolean continuePlaying() {
+    if (fSource == NULL) return False;
+
+    fSource->getNextFrame(fBuffer, MAX_NAL_UNIT_SIZE, afterGettingFrame, this, onSourceClosure, this);
+    return True;
+  }
+
+  static void afterGettingFrame(void* clientData, unsigned frameSize, unsigned numTruncatedBytes,
+				struct timeval /*presentationTime*/, unsigned /*durationInMicroseconds*/) {
+    ((CheckingSink*)clientData)->afterGettingFrame(frameSize, numTruncatedBytes);
+  }
+  void afterGettingFrame(unsigned size, unsigned numTruncatedBytes) {
+    unsigned k = fNumNALUnitsReceived++;
+    if (k >= numNALUnits || numTruncatedBytes > 0 || size != nalSize[k]
+	|| memcmp(fBuffer, &stream[nalStart[k]], size) != 0) {
+      ++fNumBadNALUnits;
+    }
+
+    continuePlaying();
+  }
+
+private:
+  unsigned char* fBuffer;
+  unsigned fNumNALUnitsReceived, fNumBadNALUnits;
+};
+
+////////// The tests //////////
+
+static EventLoopWatchVariable doneFlag;
+
+static void afterPlaying(void* /*clientData*/) {
+  doneFlag = ~0;
+}
+
+static Boolean runOne(unsigned hNumber, Boolean zeroRich, unsigned maxPayloadSize = 50000) {
+  makeStream(hNumber, zeroRich, maxPayloadSize);
+
+  ByteStreamMemoryBufferSource* source
+    = ByteStreamMemoryBufferSource::createNew(*env, stream, streamSize, False/*don't delete the buffer*/);
+  FramedSource* framer = hNumber == 264
+    ? (FramedSource*)H264VideoStreamFramer::createNew(*env, source)
+    : (FramedSource*)H265VideoStreamFramer::createNew(*env, source);
+  CheckingSink* sink = new CheckingSink(*env);
+
+  double startTime = now();
+  doneFlag = 0;
+  sink->startPlaying(*framer, afterPlaying, NULL);
+  env->taskScheduler().doEventLoop(&doneFlag);
+  double elapsedTime = now() - startTime;
+
+  Boolean isOK = sink->numNALUnitsReceived() == numNALUnits && sink->numBadNALUnits() == 0;
+  char line[200];
+  snprintf(line, sizeof line, "H.%u\t%s\t%u\t\t%.0f\t\t%.0f\t\t%s\n",
+	   hNumber, maxPayloadSize > 50000 ? "huge     " : zeroRich ? "zero-rich" : "random   ", numNALUnits,
+	   streamSize/elapsedTime/1000000, numNALUnits/elapsedTime, isOK ? "OK" : "FAILED");
+  *env << line;
+
+  Medium::close(sink);
+  Medium::close(framer); // also closes "source"
+  return isOK;
+}
+
+int main(int argc, char** argv) {
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  env = BasicUsageEnvironment::createNew(*scheduler);
+
+  stream = new u_int8_t[STREAM_SIZE];
+  nalStart = new unsigned[MAX_NUM_NAL_UNITS];
+  nalSize = new unsigned[MAX_NUM_NAL_UNITS];
+  our_srandom(1);
+
+  Boolean allOK = True;
+  *env << "codec\tpayload\t\tNAL units\tMBytes/s\tNAL units/s\tcheck\n";
+  for (unsigned hNumber = 264; hNumber <= 265; ++hNumber) {
+    if (!runOne(hNumber, False)) allOK = False;
+    if (!runOne(hNumber, True)) allOK = False;
+    if (!runOne(hNumber, False, 4000000)) allOK = False; // NAL units of up to 4 MBytes
+  }
+
+  delete[] nalSize; delete[] nalStart; delete[] stream;
+  *env << (allOK ? "All checks passed\n" : "Some checks FAILED\n");
+  env->reclaim(); delete scheduler;
+  return allOK ? 0 : 1;
+}